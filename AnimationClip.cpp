@@ -0,0 +1,189 @@
+#include <math.h>
+#include <string.h>
+#include <vector>
+#include "VectorSIMD.h"
+#include "AnimationClip.h"
+
+AnimationClip::AnimationClip(int numChannels, float duration, bool looping, float sampleRate) {
+    if (numChannels < 1) numChannels = 1;
+    if (numChannels > kMaxClipChannels) numChannels = kMaxClipChannels;
+    if (duration < 0.0f) duration = 0.0f;
+    if (sampleRate <= 0.0f) sampleRate = 100.0f;
+
+#ifdef VECTOR_SIMD_WIDTH
+    int width = VECTOR_SIMD_WIDTH;
+#else
+    int width = 1;
+#endif
+    this->numChannels = numChannels;
+    rowStride = (numChannels + width - 1) / width * width;
+    this->duration = duration;
+    this->looping = looping && duration > 0.0f;
+    this->sampleRate = sampleRate;
+    numRows = 0;
+    rows = NULL;
+    channelMask = new unsigned int[rowStride];
+    memset(channelMask, 0, rowStride * sizeof(unsigned int));
+}
+
+AnimationClip::~AnimationClip() {
+    delete[] rows;
+    delete[] channelMask;
+}
+
+void AnimationClip::AddTrack(int channel, int numKeys, const float* times, const float* values) {
+    if (channel < 0 || channel >= numChannels || numKeys < 1)
+        return;
+
+    Track track;
+    track.channel = channel;
+    track.times.assign(times, times + numKeys);
+    track.values.assign(values, values + numKeys);
+    tracks.push_back(track);
+    channelMask[channel] = 0xFFFFFFFFu;
+}
+
+void AnimationClip::Build() {
+    delete[] rows;
+    numRows = (int)floorf(duration * sampleRate + 0.5f) + 1;
+    rows = new float[numRows * rowStride];
+    memset(rows, 0, numRows * rowStride * sizeof(float));
+
+    for (size_t i = 0; i < tracks.size(); i++) {
+        const Track& track = tracks[i];
+        int numKeys = (int)track.times.size();
+        int key = 0;
+
+        // Rows go forward in time, so the key pair only ever moves forward too
+        for (int r = 0; r < numRows; r++) {
+            float t = r / sampleRate;
+            float value;
+
+            while (key < numKeys - 1 && track.times[key + 1] <= t)
+                key++;
+            if (t <= track.times[0])
+                value = track.values[0];
+            else if (key == numKeys - 1)
+                value = track.values[numKeys - 1];
+            else {
+                float span = track.times[key + 1] - track.times[key];
+                float s = span > 0.0f ? (t - track.times[key]) / span : 0.0f;
+                value = track.values[key] + (track.values[key + 1] - track.values[key]) * s;
+            }
+            rows[r * rowStride + track.channel] = value;
+        }
+    }
+}
+
+void AnimationClip::Sample(float time, float* pose) const {
+    if (!rows)
+        return;
+
+    if (looping) {
+        time = fmodf(time, duration);
+        if (time < 0.0f)
+            time += duration;
+    }
+    else if (time < 0.0f)
+        time = 0.0f;
+    else if (time > duration)
+        time = duration;
+
+    float position = time * sampleRate;
+    int i0 = (int)position;
+    int i1 = i0 + 1;
+    float f = position - i0;
+    if (i1 >= numRows) {
+        i0 = i1 = numRows - 1;
+        f = 0.0f;
+    }
+    const float* a = rows + i0 * rowStride;
+    const float* b = rows + i1 * rowStride;
+
+#ifdef VECTOR_SIMD_WIDTH
+    vfloat vf = VSet(f);
+    for (int c = 0; c < rowStride; c += VECTOR_SIMD_WIDTH) {
+        vfloat va = VLoad(a + c);
+        vfloat v = VAdd(va, VMul(VSub(VLoad(b + c), va), vf));
+        vfloat mask = VLoad((const float*)(channelMask + c));
+        VStore(pose + c, VSelect(mask, v, VLoad(pose + c)));
+    }
+#else
+    for (int c = 0; c < rowStride; c++) {
+        if (channelMask[c])
+            pose[c] = a[c] + (b[c] - a[c]) * f;
+    }
+#endif
+}
+
+void InitClipPlayback(ClipPlayback& playback) {
+    playback.clip = NULL;
+    playback.time = 0.0f;
+    playback.fadeFrom = NULL;
+    playback.fadeFromTime = 0.0f;
+    playback.fadeElapsed = 0.0f;
+    playback.fadeDuration = 0.0f;
+}
+
+void PlayClip(ClipPlayback& playback, const AnimationClip* clip, float startTime, float fadeSeconds) {
+    // A fade that is still running is cut short, the old target is faded out from where it is
+    if (fadeSeconds > 0.0f && playback.clip) {
+        playback.fadeFrom = playback.clip;
+        playback.fadeFromTime = playback.time;
+        playback.fadeElapsed = 0.0f;
+        playback.fadeDuration = fadeSeconds;
+    }
+    else
+        playback.fadeFrom = NULL;
+
+    playback.clip = clip;
+    playback.time = startTime;
+}
+
+static float WrapClipTime(const AnimationClip* clip, float time) {
+    if (clip && clip->IsLooping() && time >= clip->GetDuration())
+        time = fmodf(time, clip->GetDuration());
+    return time;
+}
+
+void AdvanceClip(ClipPlayback& playback, float seconds) {
+    playback.time = WrapClipTime(playback.clip, playback.time + seconds);
+    if (playback.fadeFrom) {
+        playback.fadeFromTime = WrapClipTime(playback.fadeFrom, playback.fadeFromTime + seconds);
+        playback.fadeElapsed += seconds;
+        if (playback.fadeElapsed >= playback.fadeDuration)
+            playback.fadeFrom = NULL;
+    }
+}
+
+bool IsClipFading(const ClipPlayback& playback) {
+    return playback.fadeFrom != NULL;
+}
+
+void EvaluateClip(const ClipPlayback& playback, float* pose) {
+    if (!playback.fadeFrom) {
+        if (playback.clip)
+            playback.clip->Sample(playback.time, pose);
+        return;
+    }
+
+    float from[kMaxClipChannels];
+    memcpy(from, pose, sizeof(from));
+    playback.fadeFrom->Sample(playback.fadeFromTime, from);
+    if (playback.clip)
+        playback.clip->Sample(playback.time, pose);
+    BlendPoses(from, pose, playback.fadeElapsed / playback.fadeDuration, pose, kMaxClipChannels);
+}
+
+void BlendPoses(const float* a, const float* b, float t, float* result, int count) {
+    int i = 0;
+#ifdef VECTOR_SIMD_WIDTH
+    vfloat vt = VSet(t);
+    for (; i + VECTOR_SIMD_WIDTH <= count; i += VECTOR_SIMD_WIDTH) {
+        vfloat va = VLoad(a + i);
+        VStore(result + i, VAdd(va, VMul(VSub(VLoad(b + i), va), vt)));
+    }
+#endif
+    for (; i < count; i++)
+        result[i] = a[i] + (b[i] - a[i]) * t;
+}
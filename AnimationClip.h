@@ -0,0 +1,81 @@
+#ifndef ANIMATIONCLIP_H
+#define ANIMATIONCLIP_H
+
+#include <vector>
+
+// Most channels a clip can have, and so the longest pose the functions below work on
+const int kMaxClipChannels = 32;
+
+// A keyframe animation of a fixed number of float channels, such as joint
+// angles. Tracks are given as linear keyframes and Build() resamples them to
+// one row of every channel per sample step, padded to the SIMD width. So
+// sampling a pose at any time is an index computation and a lerp of two
+// rows across all channels at once: O(channels) however many keys the clip
+// has or how long it has been playing. Keyframes that fall on sample times
+// are reproduced exactly.
+class AnimationClip {
+private:
+    struct Track {
+        int channel;
+        std::vector<float> times;   // seconds, ascending
+        std::vector<float> values;
+    };
+
+    int numChannels;
+    int rowStride;          // floats per row, numChannels rounded up to the SIMD width
+    float duration;         // seconds
+    bool looping;
+    float sampleRate;       // rows per second
+    int numRows;
+    float* rows;            // numRows * rowStride, built by Build()
+    unsigned int* channelMask;  // per row float, all bits set for channels with a track
+    std::vector<Track> tracks;
+
+public:
+    AnimationClip(int numChannels, float duration, bool looping, float sampleRate = 100.0f);
+    ~AnimationClip();
+
+    // Keys are linearly interpolated and held before the first and after the last
+    void AddTrack(int channel, int numKeys, const float* times, const float* values);
+    void Build();  // Call after the last AddTrack()
+
+    int GetNumChannels() const { return numChannels; }
+    int GetRowStride() const { return rowStride; }
+    float GetDuration() const { return duration; }
+    bool IsLooping() const { return looping; }
+
+    // Writes the channels with a track at time seconds into pose, which must
+    // hold GetRowStride() floats; the other channels keep their values.
+    // Looping clips wrap time, others clamp it to [0, duration].
+    void Sample(float time, float* pose) const;
+};
+
+// Where one model is in its animation: the clip it plays and, for a while
+// after PlayClip() with a fade, the clip it is cross-fading out of
+struct ClipPlayback {
+    const AnimationClip* clip;      // NULL for none
+    float time;                     // seconds into clip
+    const AnimationClip* fadeFrom;  // NULL when not fading
+    float fadeFromTime;             // seconds into fadeFrom
+    float fadeElapsed;
+    float fadeDuration;
+};
+
+void InitClipPlayback(ClipPlayback& playback);
+
+// Starts clip at startTime, fading from the current clip over fadeSeconds (0 to cut)
+void PlayClip(ClipPlayback& playback, const AnimationClip* clip, float startTime, float fadeSeconds);
+
+// Moves playback on, wrapping the time of looping clips so it stays small
+void AdvanceClip(ClipPlayback& playback, float seconds);
+
+bool IsClipFading(const ClipPlayback& playback);
+
+// Writes the pose at the playback's time into pose, kMaxClipChannels floats.
+// Channels neither clip has a track for keep their values.
+void EvaluateClip(const ClipPlayback& playback, float* pose);
+
+// result = a + (b - a) * t for count floats, vectorized; result may alias a or b
+void BlendPoses(const float* a, const float* b, float t, float* result, int count);
+
+#endif  // ANIMATIONCLIP_H
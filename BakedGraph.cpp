@@ -0,0 +1,115 @@
+#ifdef _WIN32
+#include <windows.h>
+#endif
+#include <GL/gl.h>
+#include <math.h>
+#include <vector>
+#include "VECTOR3D.h"
+#include "MATRIX4X4.h"
+#include "Frustum.h"
+#include "SceneGraph.h"
+#include "PrimitiveCache.h"
+#include "BakedGraph.h"
+#include "Profiler.h"
+
+// Appends mesh transformed by m to the arrays, normals through the cofactor matrix
+static void AppendMesh(const PrimitiveMesh* mesh, const MATRIX4X4& m, std::vector<GLfloat>& vertices,
+    std::vector<GLuint>& indices) {
+    const float* e = m.entries;
+    VECTOR3D a(e[0], e[1], e[2]), b(e[4], e[5], e[6]), c(e[8], e[9], e[10]);
+    VECTOR3D na = b.CrossProduct(c), nb = c.CrossProduct(a), nc = a.CrossProduct(b);
+    if (a.DotProduct(na) < 0.0f) {
+        na = -na;
+        nb = -nb;
+        nc = -nc;
+    }
+
+    GLuint first = (GLuint)(vertices.size() / 6);
+    const GLfloat* src = mesh->vertices;
+    for (int v = 0; v < mesh->numVertices; v++, src += 6) {
+        float x = src[0], y = src[1], z = src[2];
+        VECTOR3D n = na * src[3] + nb * src[4] + nc * src[5];
+        n.Normalize();
+        vertices.push_back(e[0] * x + e[4] * y + e[8] * z + e[12]);
+        vertices.push_back(e[1] * x + e[5] * y + e[9] * z + e[13]);
+        vertices.push_back(e[2] * x + e[6] * y + e[10] * z + e[14]);
+        vertices.push_back(n.x);
+        vertices.push_back(n.y);
+        vertices.push_back(n.z);
+    }
+    for (int i = 0; i < mesh->numIndices; i++)
+        indices.push_back(first + mesh->indices[i]);
+}
+
+void BakedGraph::Build(const SceneGraph& graph, const PrimitiveMesh** meshes) {
+    int numNodes = graph.GetNumNodes();
+    std::vector<int> frame(numNodes);        // joint node each node is fixed relative to, -1 for root space
+    std::vector<MATRIX4X4> relative(numNodes);  // node's matrix relative to that joint node
+
+    groups.clear();
+    for (int i = 0; i < numNodes; i++) {
+        const SceneNode& node = graph.GetNode(i);
+
+        // A joint node starts a new rigid frame, its own rotation included
+        if (node.joint >= 0) {
+            frame[i] = i;
+            relative[i].LoadIdentity();
+            continue;
+        }
+        if (node.parent >= 0) {
+            frame[i] = frame[node.parent];
+            relative[i] = relative[node.parent] * node.local;
+        }
+        else {
+            frame[i] = -1;
+            relative[i] = node.local;
+        }
+        if (node.primitive < 0 || !meshes[node.primitive])
+            continue;
+
+        // Groups stay in the order their first part appears in the graph
+        size_t g = 0;
+        while (g < groups.size() && (groups[g].node != frame[i] || groups[g].material != node.material))
+            g++;
+        if (g == groups.size()) {
+            groups.push_back(Group());
+            groups[g].node = frame[i];
+            groups[g].material = node.material;
+            groups[g].numParts = 0;
+        }
+        AppendMesh(meshes[node.primitive], relative[i], groups[g].vertices, groups[g].indices);
+        groups[g].numParts++;
+    }
+
+    for (size_t g = 0; g < groups.size(); g++) {
+        Group& group = groups[g];
+        const GLfloat* v = &group.vertices[0];
+        group.bounds.min.Set(v[0], v[1], v[2]);
+        group.bounds.max = group.bounds.min;
+        for (size_t k = 6; k < group.vertices.size(); k += 6) {
+            if (v[k] < group.bounds.min.x) group.bounds.min.x = v[k];
+            if (v[k + 1] < group.bounds.min.y) group.bounds.min.y = v[k + 1];
+            if (v[k + 2] < group.bounds.min.z) group.bounds.min.z = v[k + 2];
+            if (v[k] > group.bounds.max.x) group.bounds.max.x = v[k];
+            if (v[k + 1] > group.bounds.max.y) group.bounds.max.y = v[k + 1];
+            if (v[k + 2] > group.bounds.max.z) group.bounds.max.z = v[k + 2];
+        }
+    }
+}
+
+void BakedGraph::Draw(int group) const {
+    const Group& g = groups[group];
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_NORMAL_ARRAY);
+    glVertexPointer(3, GL_FLOAT, 6 * sizeof(GLfloat), &g.vertices[0]);
+    glNormalPointer(GL_FLOAT, 6 * sizeof(GLfloat), &g.vertices[3]);
+
+    glDrawElements(GL_TRIANGLES, (GLsizei)g.indices.size(), GL_UNSIGNED_INT, &g.indices[0]);
+
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    PROFILE_COUNT(COUNTER_GL_CALLS, 7);
+    PROFILE_COUNT(COUNTER_DRAW_CALLS, 1);
+    PROFILE_COUNT(COUNTER_VERTICES, (int)g.indices.size());
+}
@@ -0,0 +1,50 @@
+#ifndef BAKEDGRAPH_H
+#define BAKEDGRAPH_H
+
+#include <vector>
+#include "Frustum.h"
+#include "SceneGraph.h"
+
+struct PrimitiveMesh;
+
+// The drawable parts of a SceneGraph merged at load time into one mesh per
+// rigid group and material. Parts with no joint between them and the same
+// joint node above them never move relative to each other, so their
+// primitives are transformed once into that node's space and drawn together
+// with its world matrix: one draw call per moving joint per material instead
+// of one per part.
+class BakedGraph {
+private:
+    struct Group {
+        int node;      // joint node the vertices are relative to, -1 for the graph's root space
+        int material;
+        int numParts;
+        std::vector<GLfloat> vertices;  // interleaved position and normal, 6 floats per vertex
+        std::vector<GLuint> indices;
+        BBox bounds;   // around the vertices, in the space of node
+    };
+
+    std::vector<Group> groups;
+
+public:
+    // meshes gives the geometry of each primitive index the graph uses. Parts
+    // whose primitive has no mesh are left out.
+    void Build(const SceneGraph& graph, const PrimitiveMesh** meshes);
+    void Clear() { groups.clear(); }
+
+    int GetNumGroups() const { return (int)groups.size(); }
+    int GetGroupNode(int group) const { return groups[group].node; }
+    int GetGroupMaterial(int group) const { return groups[group].material; }
+    int GetGroupNumParts(int group) const { return groups[group].numParts; }
+    const BBox& GetGroupBounds(int group) const { return groups[group].bounds; }
+    const GLfloat* GetGroupVertices(int group) const { return &groups[group].vertices[0]; }
+    int GetGroupNumVertices(int group) const { return (int)groups[group].vertices.size() / 6; }
+    const GLuint* GetGroupIndices(int group) const { return &groups[group].indices[0]; }
+    int GetGroupNumIndices(int group) const { return (int)groups[group].indices.size(); }
+
+    // Draws a group with the current modelview matrix, which should be the
+    // view times the world matrix of GetGroupNode()
+    void Draw(int group) const;
+};
+
+#endif  // BAKEDGRAPH_H
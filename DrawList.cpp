@@ -0,0 +1,91 @@
+#include <math.h>
+#include <string.h>
+#include <vector>
+#include "MATRIX4X4.h"
+#include "DrawList.h"
+
+// Key layout: material in bits 48-63, mesh in bits 32-47, recording index below
+static inline unsigned long long MakeKey(int material, int mesh, int index) {
+    return ((unsigned long long)(material & 0xFFFF) << 48) |
+        ((unsigned long long)(mesh & 0xFFFF) << 32) | (unsigned int)index;
+}
+
+DrawList::DrawList() {
+    sorted = true;
+}
+
+void DrawList::Clear() {
+    items.clear();
+    keys.clear();
+    sorted = true;
+}
+
+void DrawList::Add(const MATRIX4X4& matrix, int material, int mesh) {
+    DrawItem item;
+
+    item.matrix = matrix;
+    item.material = material;
+    item.mesh = mesh;
+    keys.push_back(MakeKey(material, mesh, (int)items.size()));
+    items.push_back(item);
+    sorted = false;
+}
+
+void DrawList::Sort() {
+    int count = (int)keys.size();
+    if (sorted || count < 2)
+        return;
+
+    // The keys start in recording order, so a stable sort on the upper four
+    // bytes leaves the index bytes in order without passes of their own
+    const int firstByte = 4;
+    int histograms[8][256];
+    memset(histograms, 0, sizeof(histograms));
+    for (int i = 0; i < count; i++) {
+        for (int b = firstByte; b < 8; b++)
+            histograms[b][(keys[i] >> (b * 8)) & 0xFF]++;
+    }
+
+    scratch.resize(count);
+    unsigned long long* src = &keys[0];
+    unsigned long long* dst = &scratch[0];
+
+    for (int b = firstByte; b < 8; b++) {
+        int* histogram = histograms[b];
+
+        // A byte that is the same in every key would not move anything
+        if (histogram[(src[0] >> (b * 8)) & 0xFF] == count)
+            continue;
+
+        int offset = 0;
+        for (int d = 0; d < 256; d++) {
+            int n = histogram[d];
+            histogram[d] = offset;
+            offset += n;
+        }
+        for (int i = 0; i < count; i++)
+            dst[histogram[(src[i] >> (b * 8)) & 0xFF]++] = src[i];
+
+        unsigned long long* t = src;
+        src = dst;
+        dst = t;
+    }
+
+    if (src != &keys[0])
+        keys.swap(scratch);
+    sorted = true;
+}
+
+int DrawList::CountStateChanges(bool recordingOrder) const {
+    int changes = 0;
+    int material = -1, mesh = -1;
+
+    for (int i = 0; i < (int)items.size(); i++) {
+        const DrawItem& item = recordingOrder ? items[i] : GetItem(i);
+        if (i == 0 || item.material != material || item.mesh != mesh)
+            changes++;
+        material = item.material;
+        mesh = item.mesh;
+    }
+    return changes;
+}
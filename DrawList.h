@@ -0,0 +1,44 @@
+#ifndef DRAWLIST_H
+#define DRAWLIST_H
+
+#include <vector>
+#include "MATRIX4X4.h"
+
+// One primitive to draw: its modelview matrix, MaterialRegistry ID and mesh ID
+struct DrawItem {
+    MATRIX4X4 matrix;
+    int material;
+    int mesh;
+};
+
+// The primitives of a frame, recorded first and submitted afterwards. Sort()
+// orders them by a 64-bit key of material, then mesh, then recording order, so
+// everything sharing a material goes out together. Material and mesh IDs must
+// fit in 16 bits.
+class DrawList {
+private:
+    std::vector<DrawItem> items;
+    std::vector<unsigned long long> keys;     // sorted keys after Sort(), recording order before
+    std::vector<unsigned long long> scratch;  // second buffer for the radix passes
+    bool sorted;
+
+    int CountStateChanges(bool recordingOrder) const;
+
+public:
+    DrawList();
+
+    void Clear();
+    void Add(const MATRIX4X4& matrix, int material, int mesh);
+    void Sort();  // LSD radix sort on the material and mesh bytes of the keys
+
+    // Items in submission order: sorted if Sort() was called since the last Add()
+    int GetNumItems() const { return (int)items.size(); }
+    const DrawItem& GetItem(int i) const { return items[(unsigned int)(keys[i] & 0xFFFFFFFFu)]; }
+
+    // Material or mesh switches between consecutive items, counting the first
+    // item, in recording order and in submission order
+    int GetNumStateChangesRecorded() const { return CountStateChanges(true); }
+    int GetNumStateChanges() const { return CountStateChanges(false); }
+};
+
+#endif  // DRAWLIST_H
@@ -0,0 +1,171 @@
+#ifdef _WIN32
+#include <windows.h>
+#endif
+#include <GL/gl.h>
+#include <math.h>
+#include "VECTOR3D.h"
+#include "MATRIX4X4.h"
+#include "Frustum.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FRUSTUM_SSE
+#endif
+
+void TransformBounds(const float* m, const BBox& box, BBox& result) {
+    // Arvo's method: start from the translation and, for every matrix
+    // element, add whichever of the two box extremes gives the smaller and
+    // larger product
+    float bmin[3] = { box.min.x, box.min.y, box.min.z };
+    float bmax[3] = { box.max.x, box.max.y, box.max.z };
+    float rmin[3] = { m[12], m[13], m[14] };
+    float rmax[3] = { m[12], m[13], m[14] };
+
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            float a = m[j * 4 + i] * bmin[j];
+            float b = m[j * 4 + i] * bmax[j];
+            if (a < b) {
+                rmin[i] += a;
+                rmax[i] += b;
+            }
+            else {
+                rmin[i] += b;
+                rmax[i] += a;
+            }
+        }
+    }
+    result.min.Set(rmin[0], rmin[1], rmin[2]);
+    result.max.Set(rmax[0], rmax[1], rmax[2]);
+}
+
+Frustum::Frustum() {
+    for (int i = 0; i < 8; i++) {
+        planeX[i] = planeY[i] = planeZ[i] = 0.0f;
+        planeD[i] = 1.0f;  // never rejects until Extract() is called
+    }
+    numTested = 0;
+    numCulled = 0;
+}
+
+void Frustum::Extract(const float* clip) {
+    // Gribb/Hartmann: each plane is the fourth row of the clip matrix plus or
+    // minus one of the other rows. Row k of a column-major matrix is
+    // (m[k], m[4 + k], m[8 + k], m[12 + k]).
+    for (int p = 0; p < 6; p++) {
+        int row = p / 2;
+        float sign = (p % 2 == 0) ? 1.0f : -1.0f;
+
+        planeX[p] = clip[3] + sign * clip[row];
+        planeY[p] = clip[7] + sign * clip[4 + row];
+        planeZ[p] = clip[11] + sign * clip[8 + row];
+        planeD[p] = clip[15] + sign * clip[12 + row];
+    }
+}
+
+void Frustum::ExtractFromGL(bool includeModelview) {
+    MATRIX4X4 projection;
+    MATRIX4X4 modelview;
+
+    glGetFloatv(GL_PROJECTION_MATRIX, projection);
+    if (!includeModelview) {
+        Extract(projection);
+        return;
+    }
+
+    glGetFloatv(GL_MODELVIEW_MATRIX, modelview);
+    Extract(projection * modelview);
+}
+
+bool Frustum::IsBoxVisible(const BBox& box) {
+    float cx = 0.5f * (box.min.x + box.max.x);
+    float cy = 0.5f * (box.min.y + box.max.y);
+    float cz = 0.5f * (box.min.z + box.max.z);
+    float ex = 0.5f * (box.max.x - box.min.x);
+    float ey = 0.5f * (box.max.y - box.min.y);
+    float ez = 0.5f * (box.max.z - box.min.z);
+    bool outside = false;
+
+    // A box is outside when even its corner furthest along a plane normal is
+    // behind that plane
+#ifdef FRUSTUM_SSE
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    __m128 vcx = _mm_set1_ps(cx), vcy = _mm_set1_ps(cy), vcz = _mm_set1_ps(cz);
+    __m128 vex = _mm_set1_ps(ex), vey = _mm_set1_ps(ey), vez = _mm_set1_ps(ez);
+    int mask = 0;
+
+    for (int p = 0; p < 8; p += 4) {
+        __m128 px = _mm_loadu_ps(planeX + p);
+        __m128 py = _mm_loadu_ps(planeY + p);
+        __m128 pz = _mm_loadu_ps(planeZ + p);
+        __m128 dist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(px, vcx), _mm_mul_ps(py, vcy)),
+            _mm_add_ps(_mm_mul_ps(pz, vcz), _mm_loadu_ps(planeD + p)));
+        __m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_andnot_ps(signMask, px), vex),
+            _mm_mul_ps(_mm_andnot_ps(signMask, py), vey)), _mm_mul_ps(_mm_andnot_ps(signMask, pz), vez));
+        mask |= _mm_movemask_ps(_mm_cmplt_ps(_mm_add_ps(dist, radius), _mm_setzero_ps()));
+    }
+    outside = mask != 0;
+#else
+    for (int p = 0; p < 6 && !outside; p++) {
+        float dist = planeX[p] * cx + planeY[p] * cy + planeZ[p] * cz + planeD[p];
+        float radius = fabsf(planeX[p]) * ex + fabsf(planeY[p]) * ey + fabsf(planeZ[p]) * ez;
+        outside = dist + radius < 0.0f;
+    }
+#endif
+
+    numTested++;
+    if (outside)
+        numCulled++;
+    return !outside;
+}
+
+int Frustum::CullBoxes(const BBox* boxes, int count, bool* visible) {
+    int numVisible = 0;
+    int i = 0;
+
+#ifdef FRUSTUM_SSE
+    // Four boxes per iteration, one plane at a time
+    const __m128 half = _mm_set1_ps(0.5f);
+    for (; i + 4 <= count; i += 4) {
+        const BBox* b = boxes + i;
+        __m128 minX = _mm_setr_ps(b[0].min.x, b[1].min.x, b[2].min.x, b[3].min.x);
+        __m128 minY = _mm_setr_ps(b[0].min.y, b[1].min.y, b[2].min.y, b[3].min.y);
+        __m128 minZ = _mm_setr_ps(b[0].min.z, b[1].min.z, b[2].min.z, b[3].min.z);
+        __m128 maxX = _mm_setr_ps(b[0].max.x, b[1].max.x, b[2].max.x, b[3].max.x);
+        __m128 maxY = _mm_setr_ps(b[0].max.y, b[1].max.y, b[2].max.y, b[3].max.y);
+        __m128 maxZ = _mm_setr_ps(b[0].max.z, b[1].max.z, b[2].max.z, b[3].max.z);
+        __m128 cx = _mm_mul_ps(_mm_add_ps(minX, maxX), half);
+        __m128 cy = _mm_mul_ps(_mm_add_ps(minY, maxY), half);
+        __m128 cz = _mm_mul_ps(_mm_add_ps(minZ, maxZ), half);
+        __m128 ex = _mm_mul_ps(_mm_sub_ps(maxX, minX), half);
+        __m128 ey = _mm_mul_ps(_mm_sub_ps(maxY, minY), half);
+        __m128 ez = _mm_mul_ps(_mm_sub_ps(maxZ, minZ), half);
+        __m128 outside = _mm_setzero_ps();
+
+        for (int p = 0; p < 6; p++) {
+            __m128 dist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(planeX[p]), cx), _mm_mul_ps(_mm_set1_ps(planeY[p]), cy)),
+                _mm_add_ps(_mm_mul_ps(_mm_set1_ps(planeZ[p]), cz), _mm_set1_ps(planeD[p])));
+            __m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(fabsf(planeX[p])), ex), _mm_mul_ps(_mm_set1_ps(fabsf(planeY[p])), ey)),
+                _mm_mul_ps(_mm_set1_ps(fabsf(planeZ[p])), ez));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(dist, radius), _mm_setzero_ps()));
+        }
+
+        int mask = _mm_movemask_ps(outside);
+        for (int lane = 0; lane < 4; lane++) {
+            visible[i + lane] = (mask & (1 << lane)) == 0;
+            if (visible[i + lane])
+                numVisible++;
+        }
+    }
+    numTested += i;
+    numCulled += i - numVisible;
+#endif
+
+    // Remaining boxes one at a time
+    for (; i < count; i++) {
+        visible[i] = IsBoxVisible(boxes[i]);
+        if (visible[i])
+            numVisible++;
+    }
+    return numVisible;
+}
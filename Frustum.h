@@ -0,0 +1,47 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include "VECTOR3D.h"
+
+// Structure defining an axis-aligned bounding box
+typedef struct BoundingBox {
+    VECTOR3D min;
+    VECTOR3D max;
+} BBox;
+
+// Transforms box by the column-major 4x4 matrix m (the layout glGetFloatv
+// returns) and returns the axis-aligned box around the result
+void TransformBounds(const float* m, const BBox& box, BBox& result);
+
+// View frustum as six planes, used to skip geometry that cannot be seen.
+// The planes are in whatever space the matrix given to Extract() maps from:
+// eye space for the projection matrix alone, world space for projection * view.
+class Frustum {
+private:
+    // Left, right, bottom, top, near and far planes stored as separate arrays
+    // and padded to eight with planes that never reject, so a box is tested
+    // against all of them with two SSE compares
+    float planeX[8];
+    float planeY[8];
+    float planeZ[8];
+    float planeD[8];
+
+    int numTested;
+    int numCulled;
+
+public:
+    Frustum();
+
+    void Extract(const float* clip);            // column-major projection * modelview
+    void ExtractFromGL(bool includeModelview);  // reads the current GL matrices
+
+    bool IsBoxVisible(const BBox& box);
+    int CullBoxes(const BBox* boxes, int count, bool* visible);  // returns the number visible
+
+    // Counts since the last ResetStats()
+    void ResetStats() { numTested = numCulled = 0; }
+    int GetNumTested() const { return numTested; }
+    int GetNumCulled() const { return numCulled; }
+};
+
+#endif  // FRUSTUM_H
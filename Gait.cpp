@@ -0,0 +1,44 @@
+#include <math.h>
+#include "VectorSIMD.h"
+#include "Gait.h"
+
+float GaitPhase(const GaitParams& gait, float time) {
+    float cycles = time * gait.speed / gait.period;
+    return cycles - floorf(cycles);
+}
+
+float GaitSwing(const GaitParams& gait, float time) {
+    float phase = GaitPhase(gait, time);
+    return phase < 0.5f ? 2.0f * phase : 2.0f - 2.0f * phase;
+}
+
+void EvaluateGaitBatch(const GaitParams& gait, int count, const float* times, float* swings) {
+    float rate = gait.speed / gait.period;
+    int i = 0;
+
+#ifdef VECTOR_SIMD_WIDTH
+    vfloat vrate = VSet(rate);
+    vfloat two = VSet(2.0f);
+    for (; i + VECTOR_SIMD_WIDTH <= count; i += VECTOR_SIMD_WIDTH) {
+        vfloat cycles = VMul(VLoad(times + i), vrate);
+        vfloat phase = VSub(cycles, VFloor(cycles));
+        vfloat up = VMul(two, phase);
+        VStore(swings + i, VMin(up, VSub(two, up)));
+    }
+#endif
+    for (; i < count; i++) {
+        float cycles = times[i] * rate;
+        float phase = cycles - floorf(cycles);
+        swings[i] = phase < 0.5f ? 2.0f * phase : 2.0f - 2.0f * phase;
+    }
+}
+
+void ApplyGaitSwing(const GaitParams& gait, float swing, float weight, float* joints) {
+    float scale = swing * weight * gait.stride;
+    for (int j = 0; j < gait.numJoints; j++)
+        joints[gait.joints[j]] = gait.amplitudes[j] * scale;
+}
+
+void EvaluateGait(const GaitParams& gait, float time, float weight, float* joints) {
+    ApplyGaitSwing(gait, GaitSwing(gait, time), weight, joints);
+}
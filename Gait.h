@@ -0,0 +1,34 @@
+#ifndef GAIT_H
+#define GAIT_H
+
+// A walk computed in closed form from time alone. Each leg joint follows a
+// triangle wave of the gait phase, swinging from 0 out to its amplitude and
+// back once per cycle, so any time can be evaluated directly: nothing is
+// accumulated from frame to frame, there is no drift, and seeking costs the
+// same as playing.
+struct GaitParams {
+    float period;              // seconds per cycle at speed 1
+    float speed;               // cycles run this many times faster
+    float stride;              // scales every amplitude, 1 for the full swing
+    int numJoints;
+    const int* joints;         // joint index each amplitude drives
+    const float* amplitudes;   // degrees at the peak of the swing
+};
+
+// Position in the cycle at time seconds, in [0, 1)
+float GaitPhase(const GaitParams& gait, float time);
+
+// 0 at the start and end of the cycle, 1 halfway through
+float GaitSwing(const GaitParams& gait, float time);
+
+// swings[i] = GaitSwing(gait, times[i]) for a whole crowd, vectorized
+void EvaluateGaitBatch(const GaitParams& gait, int count, const float* times, float* swings);
+
+// Sets the gait's joints to swing * weight of their amplitude. A weight below
+// 1 eases the legs towards standing.
+void ApplyGaitSwing(const GaitParams& gait, float swing, float weight, float* joints);
+
+// ApplyGaitSwing(gait, GaitSwing(gait, time), weight, joints)
+void EvaluateGait(const GaitParams& gait, float time, float weight, float* joints);
+
+#endif  // GAIT_H
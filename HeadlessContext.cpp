@@ -0,0 +1,147 @@
+#include <stdio.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+#include <GL/gl.h>
+#ifdef ROBOT3D_HEADLESS_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+#include "HeadlessContext.h"
+
+HeadlessContext::HeadlessContext() {
+    display = NULL;
+    surface = NULL;
+    context = NULL;
+    width = height = 0;
+}
+
+HeadlessContext::~HeadlessContext() {
+    Destroy();
+}
+
+#ifdef ROBOT3D_HEADLESS_EGL
+
+// The surfaceless platform needs no window system at all. Older drivers
+// without it may still give a default display that works offscreen.
+static EGLDisplay OpenDisplay() {
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    const char* extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+
+    if (getPlatformDisplay && extensions && strstr(extensions, "EGL_MESA_platform_surfaceless")) {
+        EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+        if (display != EGL_NO_DISPLAY)
+            return display;
+    }
+    return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
+
+bool HeadlessContext::Create(int width, int height) {
+    static const EGLint configAttribs[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8,
+        EGL_GREEN_SIZE, 8,
+        EGL_BLUE_SIZE, 8,
+        EGL_ALPHA_SIZE, 8,
+        EGL_DEPTH_SIZE, 24,
+        EGL_NONE
+    };
+    EGLint surfaceAttribs[] = { EGL_WIDTH, width, EGL_HEIGHT, height, EGL_NONE };
+    EGLint major, minor, numConfigs;
+    EGLConfig config;
+
+    Destroy();
+    EGLDisplay eglDisplay = OpenDisplay();
+    if (eglDisplay == EGL_NO_DISPLAY || !eglInitialize(eglDisplay, &major, &minor)) {
+        fprintf(stderr, "headless: no EGL display\n");
+        return false;
+    }
+    display = eglDisplay;
+
+    // Desktop GL, the program uses the fixed-function pipeline
+    if (!eglBindAPI(EGL_OPENGL_API) ||
+        !eglChooseConfig(eglDisplay, configAttribs, &config, 1, &numConfigs) || numConfigs < 1) {
+        fprintf(stderr, "headless: no RGBA8 + depth24 OpenGL pbuffer config\n");
+        Destroy();
+        return false;
+    }
+    surface = eglCreatePbufferSurface(eglDisplay, config, surfaceAttribs);
+    context = eglCreateContext(eglDisplay, config, EGL_NO_CONTEXT, NULL);
+    if (surface == EGL_NO_SURFACE || context == EGL_NO_CONTEXT ||
+        !eglMakeCurrent(eglDisplay, (EGLSurface)surface, (EGLSurface)surface, (EGLContext)context)) {
+        fprintf(stderr, "headless: could not create a %dx%d context (EGL error 0x%x)\n", width, height, eglGetError());
+        Destroy();
+        return false;
+    }
+
+    this->width = width;
+    this->height = height;
+    printf("headless: EGL %d.%d, %s, %s\n", major, minor, glGetString(GL_RENDERER), glGetString(GL_VERSION));
+    return true;
+}
+
+void HeadlessContext::Destroy() {
+    if (!display)
+        return;
+    eglMakeCurrent((EGLDisplay)display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (context)
+        eglDestroyContext((EGLDisplay)display, (EGLContext)context);
+    if (surface)
+        eglDestroySurface((EGLDisplay)display, (EGLSurface)surface);
+    eglTerminate((EGLDisplay)display);
+    display = surface = context = NULL;
+    width = height = 0;
+}
+
+#else
+
+bool HeadlessContext::Create(int width, int height) {
+    fprintf(stderr, "headless: not built with ROBOT3D_HEADLESS_EGL\n");
+    return false;
+}
+
+void HeadlessContext::Destroy() {
+}
+
+#endif  // ROBOT3D_HEADLESS_EGL
+
+bool HeadlessContext::SaveImage(const char* path) const {
+    if (width <= 0 || height <= 0)
+        return false;
+
+    unsigned char* pixels = new unsigned char[width * height * 3];
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, pixels);
+    bool ok = WriteImage(path, pixels, width, height, 3);
+    delete[] pixels;
+    return ok;
+}
+
+bool HeadlessContext::WriteImage(const char* path, const unsigned char* pixels, int width, int height, int channels) {
+    if (!pixels || width <= 0 || height <= 0 || channels < 3)
+        return false;
+
+    FILE* file = fopen(path, "wb");
+    if (!file)
+        return false;
+
+    // GL rows go bottom up, image rows top down
+    unsigned char* row = new unsigned char[width * 3];
+    fprintf(file, "P6\n%d %d\n255\n", width, height);
+    for (int y = height - 1; y >= 0; y--) {
+        const unsigned char* src = pixels + y * width * channels;
+        for (int x = 0; x < width; x++, src += channels) {
+            row[x * 3] = src[0];
+            row[x * 3 + 1] = src[1];
+            row[x * 3 + 2] = src[2];
+        }
+        fwrite(row, 1, width * 3, file);
+    }
+    delete[] row;
+
+    bool ok = ferror(file) == 0;
+    return fclose(file) == 0 && ok;
+}
@@ -0,0 +1,36 @@
+#ifndef HEADLESSCONTEXT_H
+#define HEADLESSCONTEXT_H
+
+// An offscreen OpenGL context for machines with no display and no GPU. It
+// renders into a pbuffer through EGL, which on Mesa needs neither X nor a
+// graphics card: with no hardware driver it falls back to the llvmpipe
+// software rasterizer. Only built when ROBOT3D_HEADLESS_EGL is defined, so
+// the Windows build needs nothing extra; without it Create() fails.
+class HeadlessContext {
+private:
+    void* display;   // EGLDisplay
+    void* surface;   // EGLSurface
+    void* context;   // EGLContext
+    int width, height;
+
+public:
+    HeadlessContext();
+    ~HeadlessContext();
+
+    // Creates a width x height RGBA context with a depth buffer and makes it
+    // current on the calling thread. Prints why and returns false on failure.
+    bool Create(int width, int height);
+    void Destroy();
+
+    // Writes the color buffer as a binary PPM image
+    bool SaveImage(const char* path) const;
+
+    // Writes width x height pixels of channels bytes each, rows bottom up as GL
+    // reads them, as a binary PPM image. Only the first three channels are kept.
+    static bool WriteImage(const char* path, const unsigned char* pixels, int width, int height, int channels);
+
+    int GetWidth() const { return width; }
+    int GetHeight() const { return height; }
+};
+
+#endif  // HEADLESSCONTEXT_H
@@ -0,0 +1,122 @@
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "JobSystem.h"
+
+JobSystem::JobSystem(int numThreads) {
+    if (numThreads <= 0)
+        numThreads = (int)std::thread::hardware_concurrency();
+    if (numThreads <= 0)
+        numThreads = 1;
+
+    numQueues = numThreads;
+    queues = new WorkQueue[numQueues];
+    numQueued = 0;
+    quit = false;
+
+    // The calling thread is the last worker
+    for (int i = 0; i < numQueues - 1; i++)
+        threads.push_back(std::thread(&JobSystem::WorkerLoop, this, i));
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard<std::mutex> guard(sleepLock);
+        quit = true;
+    }
+    wake.notify_all();
+    for (size_t i = 0; i < threads.size(); i++)
+        threads[i].join();
+    delete[] queues;
+}
+
+bool JobSystem::PopJob(int queue, Job& job) {
+    WorkQueue& q = queues[queue];
+    std::lock_guard<std::mutex> guard(q.lock);
+    if (q.jobs.empty())
+        return false;
+    job = q.jobs.back();
+    q.jobs.pop_back();
+    numQueued--;
+    return true;
+}
+
+bool JobSystem::StealJob(int thief, Job& job) {
+    // Start with the next queue along so thieves spread over their victims
+    for (int i = 1; i < numQueues; i++) {
+        WorkQueue& q = queues[(thief + i) % numQueues];
+        std::lock_guard<std::mutex> guard(q.lock);
+        if (q.jobs.empty())
+            continue;
+        job = q.jobs.front();
+        q.jobs.pop_front();
+        numQueued--;
+        return true;
+    }
+    return false;
+}
+
+void JobSystem::RunJob(const Job& job) {
+    job.func(job.data, job.begin, job.end);
+    job.pending->fetch_sub(1, std::memory_order_release);
+}
+
+void JobSystem::WorkerLoop(int queue) {
+    Job job;
+
+    for (;;) {
+        if (PopJob(queue, job) || StealJob(queue, job)) {
+            RunJob(job);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepLock);
+        wake.wait(lock, [this] { return quit || numQueued > 0; });
+        if (quit)
+            return;
+    }
+}
+
+void JobSystem::ParallelFor(int count, int grainSize, JobFunc func, void* data) {
+    if (count <= 0)
+        return;
+    if (grainSize <= 0)
+        grainSize = (count + numQueues * 4 - 1) / (numQueues * 4);
+    if (numQueues == 1 || count <= grainSize) {
+        func(data, 0, count);
+        return;
+    }
+
+    int numChunks = (count + grainSize - 1) / grainSize;
+    std::atomic<int> pending(numChunks);
+    Job job;
+
+    job.func = func;
+    job.data = data;
+    job.pending = &pending;
+    for (int c = 0; c < numChunks; c++) {
+        job.begin = c * grainSize;
+        job.end = job.begin + grainSize < count ? job.begin + grainSize : count;
+
+        WorkQueue& q = queues[c % numQueues];
+        std::lock_guard<std::mutex> guard(q.lock);
+        q.jobs.push_back(job);
+    }
+    {
+        std::lock_guard<std::mutex> guard(sleepLock);
+        numQueued += numChunks;
+    }
+    wake.notify_all();
+
+    // Help out until every chunk has finished, not just been taken
+    int self = numQueues - 1;
+    while (pending.load(std::memory_order_acquire) > 0) {
+        if (PopJob(self, job) || StealJob(self, job))
+            RunJob(job);
+        else
+            std::this_thread::yield();
+    }
+}
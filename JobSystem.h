@@ -0,0 +1,60 @@
+#ifndef JOBSYSTEM_H
+#define JOBSYSTEM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work on items [begin, end) of a ParallelFor range
+typedef void (*JobFunc)(void* data, int begin, int end);
+
+// A fixed set of worker threads with one job queue each. ParallelFor() cuts a
+// range into chunks and deals them out round robin; a thread works through
+// its own queue newest first and, once that is empty, steals the oldest job
+// from another queue, so uneven chunks still finish at about the same time.
+// The calling thread has a queue of its own and works too until the range is
+// done. Only one thread may call ParallelFor() at a time, and jobs must not
+// call it themselves.
+class JobSystem {
+private:
+    struct Job {
+        JobFunc func;
+        void* data;
+        int begin, end;
+        std::atomic<int>* pending;  // chunks of the range not finished yet
+    };
+
+    struct WorkQueue {
+        std::mutex lock;
+        std::deque<Job> jobs;
+    };
+
+    std::vector<std::thread> threads;
+    WorkQueue* queues;   // one per worker, the last one for the thread calling ParallelFor()
+    int numQueues;
+
+    std::mutex sleepLock;
+    std::condition_variable wake;
+    std::atomic<int> numQueued;  // jobs pushed and not yet taken
+    bool quit;
+
+    bool PopJob(int queue, Job& job);
+    bool StealJob(int thief, Job& job);
+    void RunJob(const Job& job);
+    void WorkerLoop(int queue);
+
+public:
+    JobSystem(int numThreads = 0);  // threads including the caller, 0 for one per hardware thread
+    ~JobSystem();
+
+    int GetNumThreads() const { return numQueues; }
+
+    // Calls func over [0, count) in chunks of grainSize items, 0 to pick a
+    // size that gives every thread a few chunks. Returns when all are done.
+    void ParallelFor(int count, int grainSize, JobFunc func, void* data);
+};
+
+#endif  // JOBSYSTEM_H
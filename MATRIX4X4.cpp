@@ -0,0 +1,445 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+//	MATRIX4X4.cpp
+//	Function definitions for 4x4 matrix class
+//	The products, the inverse and the batch point transform have SSE paths with a
+//	scalar fallback that gives the same results
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#include <math.h>
+#include <string.h>
+#include "VECTOR3D.h"
+#include "VECTOR4D.h"
+#include "MATRIX4X4.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MATRIX4X4_SSE
+#endif
+
+static const double kDegreesToRadians = 3.14159265358979323846 / 180.0;
+
+MATRIX4X4::MATRIX4X4(float e0, float e1, float e2, float e3,
+	float e4, float e5, float e6, float e7,
+	float e8, float e9, float e10, float e11,
+	float e12, float e13, float e14, float e15)
+{
+	entries[0] = e0;	entries[1] = e1;	entries[2] = e2;	entries[3] = e3;
+	entries[4] = e4;	entries[5] = e5;	entries[6] = e6;	entries[7] = e7;
+	entries[8] = e8;	entries[9] = e9;	entries[10] = e10;	entries[11] = e11;
+	entries[12] = e12;	entries[13] = e13;	entries[14] = e14;	entries[15] = e15;
+}
+
+MATRIX4X4::MATRIX4X4(const float* rhs)
+{
+	memcpy(entries, rhs, 16 * sizeof(float));
+}
+
+void MATRIX4X4::SetEntry(int position, float value)
+{
+	if (position >= 0 && position <= 15)
+		entries[position] = value;
+}
+
+float MATRIX4X4::GetEntry(int position) const
+{
+	if (position >= 0 && position <= 15)
+		return entries[position];
+
+	return 0.0f;
+}
+
+VECTOR4D MATRIX4X4::GetRow(int position) const
+{
+	if (position >= 0 && position <= 3)
+		return VECTOR4D(entries[position], entries[position + 4], entries[position + 8], entries[position + 12]);
+
+	return VECTOR4D(0.0f, 0.0f, 0.0f, 0.0f);
+}
+
+VECTOR4D MATRIX4X4::GetColumn(int position) const
+{
+	if (position >= 0 && position <= 3)
+		return VECTOR4D(entries + position * 4);
+
+	return VECTOR4D(0.0f, 0.0f, 0.0f, 0.0f);
+}
+
+void MATRIX4X4::LoadIdentity(void)
+{
+	memset(entries, 0, 16 * sizeof(float));
+	entries[0] = entries[5] = entries[10] = entries[15] = 1.0f;
+}
+
+void MATRIX4X4::LoadZero(void)
+{
+	memset(entries, 0, 16 * sizeof(float));
+}
+
+MATRIX4X4 MATRIX4X4::operator+(const MATRIX4X4& rhs) const
+{
+	MATRIX4X4 result;
+	for (int i = 0; i < 16; i++)
+		result.entries[i] = entries[i] + rhs.entries[i];
+	return result;
+}
+
+MATRIX4X4 MATRIX4X4::operator-(const MATRIX4X4& rhs) const
+{
+	MATRIX4X4 result;
+	for (int i = 0; i < 16; i++)
+		result.entries[i] = entries[i] - rhs.entries[i];
+	return result;
+}
+
+MATRIX4X4 MATRIX4X4::operator*(const MATRIX4X4& rhs) const
+{
+	MATRIX4X4 result;
+
+#ifdef MATRIX4X4_SSE
+	// Column j of the result is this matrix's columns weighted by column j of rhs
+	__m128 c0 = _mm_load_ps(entries);
+	__m128 c1 = _mm_load_ps(entries + 4);
+	__m128 c2 = _mm_load_ps(entries + 8);
+	__m128 c3 = _mm_load_ps(entries + 12);
+
+	for (int col = 0; col < 4; col++) {
+		const float* b = rhs.entries + col * 4;
+		__m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(b[0])), _mm_mul_ps(c1, _mm_set1_ps(b[1]))),
+			_mm_add_ps(_mm_mul_ps(c2, _mm_set1_ps(b[2])), _mm_mul_ps(c3, _mm_set1_ps(b[3]))));
+		_mm_store_ps(result.entries + col * 4, r);
+	}
+#else
+	for (int col = 0; col < 4; col++) {
+		const float* b = rhs.entries + col * 4;
+		for (int row = 0; row < 4; row++) {
+			result.entries[col * 4 + row] = (entries[row] * b[0] + entries[4 + row] * b[1]) +
+				(entries[8 + row] * b[2] + entries[12 + row] * b[3]);
+		}
+	}
+#endif
+
+	return result;
+}
+
+MATRIX4X4 MATRIX4X4::operator*(const float rhs) const
+{
+	MATRIX4X4 result;
+	for (int i = 0; i < 16; i++)
+		result.entries[i] = entries[i] * rhs;
+	return result;
+}
+
+bool MATRIX4X4::operator==(const MATRIX4X4& rhs) const
+{
+	for (int i = 0; i < 16; i++) {
+		if (entries[i] != rhs.entries[i])
+			return false;
+	}
+	return true;
+}
+
+bool MATRIX4X4::operator!=(const MATRIX4X4& rhs) const
+{
+	return !((*this) == rhs);
+}
+
+void MATRIX4X4::operator+=(const MATRIX4X4& rhs)
+{
+	(*this) = (*this) + rhs;
+}
+
+void MATRIX4X4::operator-=(const MATRIX4X4& rhs)
+{
+	(*this) = (*this) - rhs;
+}
+
+void MATRIX4X4::operator*=(const MATRIX4X4& rhs)
+{
+	(*this) = (*this) * rhs;
+}
+
+void MATRIX4X4::operator*=(const float rhs)
+{
+	(*this) = (*this) * rhs;
+}
+
+MATRIX4X4 MATRIX4X4::operator-(void) const
+{
+	MATRIX4X4 result(*this);
+	for (int i = 0; i < 16; i++)
+		result.entries[i] = -result.entries[i];
+	return result;
+}
+
+VECTOR4D MATRIX4X4::operator*(const VECTOR4D& rhs) const
+{
+	VECTOR4D result;
+
+#ifdef MATRIX4X4_SSE
+	__m128 r = _mm_add_ps(
+		_mm_add_ps(_mm_mul_ps(_mm_load_ps(entries), _mm_set1_ps(rhs.x)), _mm_mul_ps(_mm_load_ps(entries + 4), _mm_set1_ps(rhs.y))),
+		_mm_add_ps(_mm_mul_ps(_mm_load_ps(entries + 8), _mm_set1_ps(rhs.z)), _mm_mul_ps(_mm_load_ps(entries + 12), _mm_set1_ps(rhs.w))));
+	_mm_store_ps(&result.x, r);
+#else
+	result.x = (entries[0] * rhs.x + entries[4] * rhs.y) + (entries[8] * rhs.z + entries[12] * rhs.w);
+	result.y = (entries[1] * rhs.x + entries[5] * rhs.y) + (entries[9] * rhs.z + entries[13] * rhs.w);
+	result.z = (entries[2] * rhs.x + entries[6] * rhs.y) + (entries[10] * rhs.z + entries[14] * rhs.w);
+	result.w = (entries[3] * rhs.x + entries[7] * rhs.y) + (entries[11] * rhs.z + entries[15] * rhs.w);
+#endif
+
+	return result;
+}
+
+VECTOR3D MATRIX4X4::GetRotatedVECTOR3D(const VECTOR3D& rhs) const
+{
+	return VECTOR3D(entries[0] * rhs.x + entries[4] * rhs.y + entries[8] * rhs.z,
+		entries[1] * rhs.x + entries[5] * rhs.y + entries[9] * rhs.z,
+		entries[2] * rhs.x + entries[6] * rhs.y + entries[10] * rhs.z);
+}
+
+VECTOR3D MATRIX4X4::GetTransformedVECTOR3D(const VECTOR3D& rhs) const
+{
+	VECTOR3D result;
+	TransformPoints(&rhs, &result, 1);
+	return result;
+}
+
+void MATRIX4X4::TransformPoints(const VECTOR3D* in, VECTOR3D* out, int count) const
+{
+#ifdef MATRIX4X4_SSE
+	__m128 c0 = _mm_load_ps(entries);
+	__m128 c1 = _mm_load_ps(entries + 4);
+	__m128 c2 = _mm_load_ps(entries + 8);
+	__m128 c3 = _mm_load_ps(entries + 12);
+
+	for (int i = 0; i < count; i++) {
+		__m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(in[i].x)), _mm_mul_ps(c1, _mm_set1_ps(in[i].y))),
+			_mm_add_ps(_mm_mul_ps(c2, _mm_set1_ps(in[i].z)), c3));
+
+		// VECTOR3D is 12 bytes, so store x, y and then z rather than a whole register
+		_mm_storel_pi((__m64*)&out[i].x, r);
+		_mm_store_ss(&out[i].z, _mm_movehl_ps(r, r));
+	}
+#else
+	for (int i = 0; i < count; i++) {
+		float x = in[i].x, y = in[i].y, z = in[i].z;
+		out[i].x = (entries[0] * x + entries[4] * y) + (entries[8] * z + entries[12]);
+		out[i].y = (entries[1] * x + entries[5] * y) + (entries[9] * z + entries[13]);
+		out[i].z = (entries[2] * x + entries[6] * y) + (entries[10] * z + entries[14]);
+	}
+#endif
+}
+
+bool MATRIX4X4::Invert(void)
+{
+	// Cofactor expansion through the 2x2 determinants of the top and bottom
+	// halves. The formulas are written for a row-major matrix t; reading the
+	// column-major entries as rows gives t = transpose, and inverting the
+	// transpose produces the rows of the transposed inverse, ie the columns
+	// of our inverse.
+	const float* t = entries;
+
+	float s0 = t[0] * t[5] - t[4] * t[1];
+	float s1 = t[0] * t[6] - t[4] * t[2];
+	float s2 = t[0] * t[7] - t[4] * t[3];
+	float s3 = t[1] * t[6] - t[5] * t[2];
+	float s4 = t[1] * t[7] - t[5] * t[3];
+	float s5 = t[2] * t[7] - t[6] * t[3];
+
+	float c5 = t[10] * t[15] - t[14] * t[11];
+	float c4 = t[9] * t[15] - t[13] * t[11];
+	float c3 = t[9] * t[14] - t[13] * t[10];
+	float c2 = t[8] * t[15] - t[12] * t[11];
+	float c1 = t[8] * t[14] - t[12] * t[10];
+	float c0 = t[8] * t[13] - t[12] * t[9];
+
+	float det = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+	if (det == 0.0f)
+		return false;
+	float invDet = 1.0f / det;
+
+#ifdef MATRIX4X4_SSE
+	// vj holds column j of t with its rows in the order 1, 0, 3, 2, and kn
+	// pairs the bottom cofactor cn with the top sn, so each output row is
+	// three products and a sign pattern
+	__m128 r0 = _mm_load_ps(entries);
+	__m128 r1 = _mm_load_ps(entries + 4);
+	__m128 r2 = _mm_load_ps(entries + 8);
+	__m128 r3 = _mm_load_ps(entries + 12);
+	_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+	__m128 v0 = _mm_shuffle_ps(r0, r0, _MM_SHUFFLE(2, 3, 0, 1));
+	__m128 v1 = _mm_shuffle_ps(r1, r1, _MM_SHUFFLE(2, 3, 0, 1));
+	__m128 v2 = _mm_shuffle_ps(r2, r2, _MM_SHUFFLE(2, 3, 0, 1));
+	__m128 v3 = _mm_shuffle_ps(r3, r3, _MM_SHUFFLE(2, 3, 0, 1));
+
+	__m128 k0 = _mm_setr_ps(c0, c0, s0, s0);
+	__m128 k1 = _mm_setr_ps(c1, c1, s1, s1);
+	__m128 k2 = _mm_setr_ps(c2, c2, s2, s2);
+	__m128 k3 = _mm_setr_ps(c3, c3, s3, s3);
+	__m128 k4 = _mm_setr_ps(c4, c4, s4, s4);
+	__m128 k5 = _mm_setr_ps(c5, c5, s5, s5);
+
+	__m128 scaleEven = _mm_setr_ps(invDet, -invDet, invDet, -invDet);
+	__m128 scaleOdd = _mm_setr_ps(-invDet, invDet, -invDet, invDet);
+
+	__m128 b0 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(v1, k5), _mm_mul_ps(v2, k4)), _mm_mul_ps(v3, k3));
+	__m128 b1 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(v0, k5), _mm_mul_ps(v2, k2)), _mm_mul_ps(v3, k1));
+	__m128 b2 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(v0, k4), _mm_mul_ps(v1, k2)), _mm_mul_ps(v3, k0));
+	__m128 b3 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(v0, k3), _mm_mul_ps(v1, k1)), _mm_mul_ps(v2, k0));
+
+	_mm_store_ps(entries, _mm_mul_ps(b0, scaleEven));
+	_mm_store_ps(entries + 4, _mm_mul_ps(b1, scaleOdd));
+	_mm_store_ps(entries + 8, _mm_mul_ps(b2, scaleEven));
+	_mm_store_ps(entries + 12, _mm_mul_ps(b3, scaleOdd));
+#else
+	float b[16];
+
+	b[0] = (t[5] * c5 - t[6] * c4 + t[7] * c3) * invDet;
+	b[1] = (-t[1] * c5 + t[2] * c4 - t[3] * c3) * invDet;
+	b[2] = (t[13] * s5 - t[14] * s4 + t[15] * s3) * invDet;
+	b[3] = (-t[9] * s5 + t[10] * s4 - t[11] * s3) * invDet;
+
+	b[4] = (-t[4] * c5 + t[6] * c2 - t[7] * c1) * invDet;
+	b[5] = (t[0] * c5 - t[2] * c2 + t[3] * c1) * invDet;
+	b[6] = (-t[12] * s5 + t[14] * s2 - t[15] * s1) * invDet;
+	b[7] = (t[8] * s5 - t[10] * s2 + t[11] * s1) * invDet;
+
+	b[8] = (t[4] * c4 - t[5] * c2 + t[7] * c0) * invDet;
+	b[9] = (-t[0] * c4 + t[1] * c2 - t[3] * c0) * invDet;
+	b[10] = (t[12] * s4 - t[13] * s2 + t[15] * s0) * invDet;
+	b[11] = (-t[8] * s4 + t[9] * s2 - t[11] * s0) * invDet;
+
+	b[12] = (-t[4] * c3 + t[5] * c1 - t[6] * c0) * invDet;
+	b[13] = (t[0] * c3 - t[1] * c1 + t[2] * c0) * invDet;
+	b[14] = (-t[12] * s3 + t[13] * s1 - t[14] * s0) * invDet;
+	b[15] = (t[8] * s3 - t[9] * s1 + t[10] * s0) * invDet;
+
+	memcpy(entries, b, sizeof(b));
+#endif
+
+	return true;
+}
+
+MATRIX4X4 MATRIX4X4::GetInverse(void) const
+{
+	MATRIX4X4 result(*this);
+	if (!result.Invert())
+		result.LoadZero();
+	return result;
+}
+
+void MATRIX4X4::Transpose(void)
+{
+	(*this) = GetTranspose();
+}
+
+MATRIX4X4 MATRIX4X4::GetTranspose(void) const
+{
+	return MATRIX4X4(entries[0], entries[4], entries[8], entries[12],
+		entries[1], entries[5], entries[9], entries[13],
+		entries[2], entries[6], entries[10], entries[14],
+		entries[3], entries[7], entries[11], entries[15]);
+}
+
+void MATRIX4X4::SetTranslation(const VECTOR3D& translation)
+{
+	LoadIdentity();
+	entries[12] = translation.x;
+	entries[13] = translation.y;
+	entries[14] = translation.z;
+}
+
+void MATRIX4X4::SetScale(const VECTOR3D& scaleFactor)
+{
+	LoadIdentity();
+	entries[0] = scaleFactor.x;
+	entries[5] = scaleFactor.y;
+	entries[10] = scaleFactor.z;
+}
+
+void MATRIX4X4::SetUniformScale(const float scaleFactor)
+{
+	SetScale(VECTOR3D(scaleFactor, scaleFactor, scaleFactor));
+}
+
+void MATRIX4X4::SetRotationAxis(const double angle, const VECTOR3D& axis)
+{
+	// Same matrix glRotatef builds, including leaving a zero axis as identity
+	float x = axis.x, y = axis.y, z = axis.z;
+	float length = sqrtf(x * x + y * y + z * z);
+	float c = (float)cos(angle * kDegreesToRadians);
+	float s = (float)sin(angle * kDegreesToRadians);
+
+	LoadIdentity();
+	if (length == 0.0f)
+		return;
+	x /= length;
+	y /= length;
+	z /= length;
+
+	entries[0] = x * x * (1 - c) + c;
+	entries[1] = y * x * (1 - c) + z * s;
+	entries[2] = x * z * (1 - c) - y * s;
+	entries[4] = x * y * (1 - c) - z * s;
+	entries[5] = y * y * (1 - c) + c;
+	entries[6] = y * z * (1 - c) + x * s;
+	entries[8] = x * z * (1 - c) + y * s;
+	entries[9] = y * z * (1 - c) - x * s;
+	entries[10] = z * z * (1 - c) + c;
+}
+
+void MATRIX4X4::SetRotationX(const double angle)
+{
+	LoadIdentity();
+	entries[5] = (float)cos(angle * kDegreesToRadians);
+	entries[6] = (float)sin(angle * kDegreesToRadians);
+	entries[9] = -entries[6];
+	entries[10] = entries[5];
+}
+
+void MATRIX4X4::SetRotationY(const double angle)
+{
+	LoadIdentity();
+	entries[0] = (float)cos(angle * kDegreesToRadians);
+	entries[2] = -(float)sin(angle * kDegreesToRadians);
+	entries[8] = -entries[2];
+	entries[10] = entries[0];
+}
+
+void MATRIX4X4::SetRotationZ(const double angle)
+{
+	LoadIdentity();
+	entries[0] = (float)cos(angle * kDegreesToRadians);
+	entries[1] = (float)sin(angle * kDegreesToRadians);
+	entries[4] = -entries[1];
+	entries[5] = entries[0];
+}
+
+void MATRIX4X4::SetPerspective(const double fovy, const double aspect, const double zNear, const double zFar)
+{
+	double f = 1.0 / tan(fovy * 0.5 * kDegreesToRadians);
+
+	LoadZero();
+	entries[0] = (float)(f / aspect);
+	entries[5] = (float)f;
+	entries[10] = (float)((zFar + zNear) / (zNear - zFar));
+	entries[11] = -1.0f;
+	entries[14] = (float)(2.0 * zFar * zNear / (zNear - zFar));
+}
+
+void MATRIX4X4::SetLookAt(const VECTOR3D& eye, const VECTOR3D& center, const VECTOR3D& up)
+{
+	VECTOR3D forward = center - eye;
+	forward.Normalize();
+	VECTOR3D side = forward.CrossProduct(up);
+	side.Normalize();
+	VECTOR3D newUp = side.CrossProduct(forward);
+
+	LoadIdentity();
+	entries[0] = side.x;	entries[4] = side.y;	entries[8] = side.z;
+	entries[1] = newUp.x;	entries[5] = newUp.y;	entries[9] = newUp.z;
+	entries[2] = -forward.x;	entries[6] = -forward.y;	entries[10] = -forward.z;
+	entries[12] = -side.DotProduct(eye);
+	entries[13] = -newUp.DotProduct(eye);
+	entries[14] = forward.DotProduct(eye);
+}
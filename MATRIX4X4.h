@@ -0,0 +1,95 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+//	MATRIX4X4.h
+//	Class declaration for a 4x4 matrix
+//	Entries are column-major, the layout glLoadMatrixf and glGetFloatv use, and aligned
+//	to 16 bytes so each column loads straight into an SSE register
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef MATRIX4X4_H
+#define MATRIX4X4_H
+
+#include "VECTOR3D.h"
+#include "VECTOR4D.h"
+
+class alignas(16) MATRIX4X4
+{
+public:
+	//constructors, the default one loads the identity
+	MATRIX4X4()
+	{
+		LoadIdentity();
+	}
+	MATRIX4X4(float e0, float e1, float e2, float e3,
+		float e4, float e5, float e6, float e7,
+		float e8, float e9, float e10, float e11,
+		float e12, float e13, float e14, float e15);
+	MATRIX4X4(const float* rhs);
+
+	void SetEntry(int position, float value);
+	float GetEntry(int position) const;
+	VECTOR4D GetRow(int position) const;
+	VECTOR4D GetColumn(int position) const;
+
+	void LoadIdentity(void);
+	void LoadZero(void);
+
+	//binary operators
+	MATRIX4X4 operator+(const MATRIX4X4& rhs) const;
+	MATRIX4X4 operator-(const MATRIX4X4& rhs) const;
+	MATRIX4X4 operator*(const MATRIX4X4& rhs) const;
+	MATRIX4X4 operator*(const float rhs) const;
+
+	bool operator==(const MATRIX4X4& rhs) const;
+	bool operator!=(const MATRIX4X4& rhs) const;
+
+	//self-add etc
+	void operator+=(const MATRIX4X4& rhs);
+	void operator-=(const MATRIX4X4& rhs);
+	void operator*=(const MATRIX4X4& rhs);
+	void operator*=(const float rhs);
+
+	//unary operators
+	MATRIX4X4 operator-(void) const;
+	MATRIX4X4 operator+(void) const { return (*this); }
+
+	//multiply a vector by this matrix
+	VECTOR4D operator*(const VECTOR4D& rhs) const;
+
+	//rotate a direction by the upper 3x3 part only
+	VECTOR3D GetRotatedVECTOR3D(const VECTOR3D& rhs) const;
+	//transform a point (w = 1), without dividing by the resulting w
+	VECTOR3D GetTransformedVECTOR3D(const VECTOR3D& rhs) const;
+	VECTOR3D GetTranslation(void) const { return VECTOR3D(entries[12], entries[13], entries[14]); }
+
+	//transform count points at once. in and out may be the same array
+	void TransformPoints(const VECTOR3D* in, VECTOR3D* out, int count) const;
+
+	//Invert leaves the matrix unchanged and returns false if it is singular,
+	//GetInverse then returns the zero matrix
+	bool Invert(void);
+	MATRIX4X4 GetInverse(void) const;
+	void Transpose(void);
+	MATRIX4X4 GetTranspose(void) const;
+
+	//set to perform an operation on space - these load the identity first.
+	//Angles are in degrees, like glRotatef
+	void SetTranslation(const VECTOR3D& translation);
+	void SetScale(const VECTOR3D& scaleFactor);
+	void SetUniformScale(const float scaleFactor);
+	void SetRotationAxis(const double angle, const VECTOR3D& axis);
+	void SetRotationX(const double angle);
+	void SetRotationY(const double angle);
+	void SetRotationZ(const double angle);
+
+	//camera matrices built the way gluPerspective and gluLookAt build them
+	void SetPerspective(const double fovy, const double aspect, const double zNear, const double zFar);
+	void SetLookAt(const VECTOR3D& eye, const VECTOR3D& center, const VECTOR3D& up);
+
+	//cast to pointer to a (float *) for glLoadMatrixf etc
+	operator float* () const { return (float*)this; }
+
+	//member variables
+	float entries[16];
+};
+
+#endif	//MATRIX4X4_H
@@ -0,0 +1,87 @@
+#ifdef _WIN32
+#include <windows.h>
+#endif
+#include <GL/gl.h>
+#include <string.h>
+#include <vector>
+#include "MaterialRegistry.h"
+#include "Profiler.h"
+
+static bool SameColor(const GLfloat* a, const GLfloat* b) {
+    return a[0] == b[0] && a[1] == b[1] && a[2] == b[2] && a[3] == b[3];
+}
+
+static bool SameMaterial(const Material& a, const Material& b) {
+    return SameColor(a.ambient, b.ambient) && SameColor(a.diffuse, b.diffuse) &&
+        SameColor(a.specular, b.specular) && a.shininess == b.shininess;
+}
+
+MaterialRegistry::MaterialRegistry() {
+    memset(&current, 0, sizeof(current));
+    boundMaterial = -1;
+    ResetStats();
+}
+
+int MaterialRegistry::Register(const Material& material) {
+    for (size_t i = 0; i < materials.size(); i++) {
+        if (SameMaterial(materials[i], material))
+            return (int)i;
+    }
+    materials.push_back(material);
+    return (int)materials.size() - 1;
+}
+
+int MaterialRegistry::Register(const GLfloat* ambient, const GLfloat* diffuse, const GLfloat* specular, GLfloat shininess) {
+    Material material;
+
+    memcpy(material.ambient, ambient, sizeof(material.ambient));
+    memcpy(material.diffuse, diffuse, sizeof(material.diffuse));
+    memcpy(material.specular, specular, sizeof(material.specular));
+    material.shininess = shininess;
+    return Register(material);
+}
+
+void MaterialRegistry::Bind(int material) {
+    if (material < 0 || material >= (int)materials.size())
+        return;
+    if (material == boundMaterial) {
+        numBindsSkipped++;
+        return;
+    }
+
+    // Different IDs can still share some values, only send the ones that changed
+    const Material& m = materials[material];
+    bool known = boundMaterial >= 0;
+    int calls = 0;
+
+    if (!known || !SameColor(current.ambient, m.ambient)) {
+        glMaterialfv(GL_FRONT, GL_AMBIENT, m.ambient);
+        calls++;
+    }
+    if (!known || !SameColor(current.specular, m.specular)) {
+        glMaterialfv(GL_FRONT, GL_SPECULAR, m.specular);
+        calls++;
+    }
+    if (!known || !SameColor(current.diffuse, m.diffuse)) {
+        glMaterialfv(GL_FRONT, GL_DIFFUSE, m.diffuse);
+        calls++;
+    }
+    if (!known || current.shininess != m.shininess) {
+        glMaterialfv(GL_FRONT, GL_SHININESS, &m.shininess);
+        calls++;
+    }
+
+    current = m;
+    boundMaterial = material;
+    numCallsIssued += calls;
+    PROFILE_COUNT(COUNTER_GL_CALLS, calls);
+    PROFILE_COUNT(COUNTER_MATERIAL_SWITCHES, calls > 0 ? 1 : 0);
+    if (calls > 0)
+        numBindsIssued++;
+    else
+        numBindsSkipped++;
+}
+
+void MaterialRegistry::Invalidate() {
+    boundMaterial = -1;
+}
@@ -0,0 +1,49 @@
+#ifndef MATERIALREGISTRY_H
+#define MATERIALREGISTRY_H
+
+#include <vector>
+
+// Front face material, the four values glMaterialfv sets
+struct Material {
+    GLfloat ambient[4];
+    GLfloat diffuse[4];
+    GLfloat specular[4];
+    GLfloat shininess;
+};
+
+// Every material the program draws with, referred to by integer ID. Bind()
+// remembers what it last sent to GL and only issues the glMaterialfv calls
+// whose values differ, so drawing many parts with the same material costs no
+// GL calls after the first.
+class MaterialRegistry {
+private:
+    std::vector<Material> materials;
+    Material current;     // GL state as last set through Bind()
+    int boundMaterial;    // ID last bound, -1 when the GL state is unknown
+
+    int numBindsIssued;   // Bind() calls that changed GL state
+    int numBindsSkipped;  // Bind() calls that found it already matching
+    int numCallsIssued;   // glMaterialfv calls made
+
+public:
+    MaterialRegistry();
+
+    // Returns the ID of a material with these values, adding it if no
+    // registered material matches exactly
+    int Register(const Material& material);
+    int Register(const GLfloat* ambient, const GLfloat* diffuse, const GLfloat* specular, GLfloat shininess);
+
+    int GetNumMaterials() const { return (int)materials.size(); }
+    const Material& GetMaterial(int material) const { return materials[material]; }
+
+    void Bind(int material);
+    void Invalidate();  // Call after setting GL material state directly
+
+    // Counts since the last ResetStats()
+    void ResetStats() { numBindsIssued = numBindsSkipped = numCallsIssued = 0; }
+    int GetNumBindsIssued() const { return numBindsIssued; }
+    int GetNumBindsSkipped() const { return numBindsSkipped; }
+    int GetNumCallsIssued() const { return numCallsIssued; }
+};
+
+#endif  // MATERIALREGISTRY_H
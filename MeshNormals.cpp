@@ -0,0 +1,216 @@
+#include <math.h>
+#include <vector>
+#include "VectorSIMD.h"
+#include "JobSystem.h"
+#include "MeshNormals.h"
+
+// Grids with fewer vertices than this are not worth handing to the job system
+static const int kMinVerticesForThreads = 128 * 128;
+
+// Adds the normalized cross product a x b to the running sum s
+static inline void AddCornerNormal(float ax, float ay, float az, float bx, float by, float bz,
+    float& sx, float& sy, float& sz) {
+    float cx = ay * bz - az * by;
+    float cy = az * bx - ax * bz;
+    float cz = ax * by - ay * bx;
+    float len2 = cx * cx + cy * cy + cz * cz;
+
+    if (len2 > 0.0f) {
+        float inv = 1.0f / sqrtf(len2);
+        sx += cx * inv;
+        sy += cy * inv;
+        sz += cz * inv;
+    }
+}
+
+static void ComputeVertexNormal(int gridSize, int row, int col, const float* positions, float* normals) {
+    int rowLength = gridSize + 1;
+    int v = row * rowLength + col;
+    int up = 3 * rowLength;  // floats from a vertex to the one in the next row
+    const float* p = positions + 3 * v;
+    float sx = 0.0f, sy = 0.0f, sz = 0.0f;
+
+    // Edges from this vertex to its right/left neighbours in the row and to
+    // its neighbours in the next/previous row. Only those that exist are used.
+    bool hasR = col < gridSize, hasL = col > 0;
+    bool hasU = row < gridSize, hasD = row > 0;
+    float rx = 0, ry = 0, rz = 0, lx = 0, ly = 0, lz = 0;
+    float ux = 0, uy = 0, uz = 0, dx = 0, dy = 0, dz = 0;
+
+    if (hasR) { rx = p[3] - p[0]; ry = p[4] - p[1]; rz = p[5] - p[2]; }
+    if (hasL) { lx = p[-3] - p[0]; ly = p[-2] - p[1]; lz = p[-1] - p[2]; }
+    if (hasU) { ux = p[up] - p[0]; uy = p[up + 1] - p[1]; uz = p[up + 2] - p[2]; }
+    if (hasD) { dx = p[-up] - p[0]; dy = p[1 - up] - p[1]; dz = p[2 - up] - p[2]; }
+
+    // Corner normal of each adjacent quad, same winding as the quad corners
+    if (hasR && hasU) AddCornerNormal(rx, ry, rz, ux, uy, uz, sx, sy, sz);
+    if (hasU && hasL) AddCornerNormal(ux, uy, uz, lx, ly, lz, sx, sy, sz);
+    if (hasL && hasD) AddCornerNormal(lx, ly, lz, dx, dy, dz, sx, sy, sz);
+    if (hasD && hasR) AddCornerNormal(dx, dy, dz, rx, ry, rz, sx, sy, sz);
+
+    float len2 = sx * sx + sy * sy + sz * sz;
+    if (len2 > 0.0f) {
+        float inv = 1.0f / sqrtf(len2);
+        sx *= inv;
+        sy *= inv;
+        sz *= inv;
+    }
+    float* n = normals + 3 * v;
+    n[0] = sx;
+    n[1] = sy;
+    n[2] = sz;
+}
+
+#ifdef VECTOR_SIMD_WIDTH
+static inline void VAddCornerNormal(vfloat ax, vfloat ay, vfloat az, vfloat bx, vfloat by, vfloat bz,
+    vfloat& sx, vfloat& sy, vfloat& sz) {
+    vfloat cx, cy, cz;
+    VCross(ax, ay, az, bx, by, bz, cx, cy, cz);
+    VNormalize(cx, cy, cz);
+    sx = VAdd(sx, cx);
+    sy = VAdd(sy, cy);
+    sz = VAdd(sz, cz);
+}
+
+// Columns [first, first + width) of three grid rows with x, y and z split into
+// separate arrays, so the vector path can load neighbouring vertices at once.
+// Row r lives in slot r % 3, and each slot is x, then y, then z, width floats each.
+struct SplitRows {
+    int first, width;
+    int slotRow[3];  // grid row held in each slot, -1 for none
+    std::vector<float> slots;
+
+    SplitRows(int first, int width) : first(first), width(width), slots(9 * width) {
+        slotRow[0] = slotRow[1] = slotRow[2] = -1;
+    }
+
+    // x values of row's slot, filled from positions if it held another row
+    const float* Get(const float* positions, int rowLength, int row) {
+        int slot = row % 3;
+        float* x = &slots[slot * 3 * width];
+
+        if (slotRow[slot] != row) {
+            const float* p = positions + 3 * (row * rowLength + first);
+            for (int i = 0; i < width; i++, p += 3) {
+                x[i] = p[0];
+                x[i + width] = p[1];
+                x[i + 2 * width] = p[2];
+            }
+            slotRow[slot] = row;
+        }
+        return x;
+    }
+};
+
+// Same as ComputeVertexNormal for VECTOR_SIMD_WIDTH consecutive interior
+// vertices starting at column index i of the split rows, which all have four
+// neighbours. Writes their normals, x/y/z interleaved, to normals onwards.
+static inline void ComputeInteriorNormals(const float* down, const float* center, const float* up,
+    int width, int i, float* normals) {
+    const float* cX = center + i;
+    const float* cY = cX + width;
+    const float* cZ = cY + width;
+    const float* uX = up + i;
+    const float* dX = down + i;
+    vfloat cx = VLoad(cX), cy = VLoad(cY), cz = VLoad(cZ);
+
+    vfloat rx = VSub(VLoad(cX + 1), cx), ry = VSub(VLoad(cY + 1), cy), rz = VSub(VLoad(cZ + 1), cz);
+    vfloat lx = VSub(VLoad(cX - 1), cx), ly = VSub(VLoad(cY - 1), cy), lz = VSub(VLoad(cZ - 1), cz);
+    vfloat ux = VSub(VLoad(uX), cx), uy = VSub(VLoad(uX + width), cy), uz = VSub(VLoad(uX + 2 * width), cz);
+    vfloat dx = VSub(VLoad(dX), cx), dy = VSub(VLoad(dX + width), cy), dz = VSub(VLoad(dX + 2 * width), cz);
+
+    vfloat sx = VSet(0.0f), sy = VSet(0.0f), sz = VSet(0.0f);
+    VAddCornerNormal(rx, ry, rz, ux, uy, uz, sx, sy, sz);
+    VAddCornerNormal(ux, uy, uz, lx, ly, lz, sx, sy, sz);
+    VAddCornerNormal(lx, ly, lz, dx, dy, dz, sx, sy, sz);
+    VAddCornerNormal(dx, dy, dz, rx, ry, rz, sx, sy, sz);
+    VNormalize(sx, sy, sz);
+
+    float nx[VECTOR_SIMD_WIDTH], ny[VECTOR_SIMD_WIDTH], nz[VECTOR_SIMD_WIDTH];
+    VStore(nx, sx);
+    VStore(ny, sy);
+    VStore(nz, sz);
+    for (int k = 0; k < VECTOR_SIMD_WIDTH; k++, normals += 3) {
+        normals[0] = nx[k];
+        normals[1] = ny[k];
+        normals[2] = nz[k];
+    }
+}
+#endif
+
+void ComputeGridNormalsRegion(int gridSize, int row0, int row1, int col0, int col1,
+    const float* positions, float* normals) {
+    if (row0 < 0) row0 = 0;
+    if (col0 < 0) col0 = 0;
+    if (row1 > gridSize) row1 = gridSize;
+    if (col1 > gridSize) col1 = gridSize;
+    if (row0 > row1 || col0 > col1)
+        return;
+
+    int rowLength = gridSize + 1;
+#ifdef VECTOR_SIMD_WIDTH
+    // The region's columns plus the neighbours either side
+    int first = col0 > 0 ? col0 - 1 : 0;
+    int last = col1 < gridSize ? col1 + 1 : gridSize;
+    SplitRows split(first, last - first + 1);
+#endif
+
+    for (int row = row0; row <= row1; row++) {
+        int col = col0;
+
+#ifdef VECTOR_SIMD_WIDTH
+        // Interior vertices of interior rows go through the vector path,
+        // the grid border and the row tail are done one at a time
+        if (row > 0 && row < gridSize) {
+            int interiorEnd = col1 < gridSize - 1 ? col1 : gridSize - 1;
+
+            for (; col <= col1 && col < 1; col++)
+                ComputeVertexNormal(gridSize, row, col, positions, normals);
+            if (col + VECTOR_SIMD_WIDTH - 1 <= interiorEnd) {
+                const float* down = split.Get(positions, rowLength, row - 1);
+                const float* center = split.Get(positions, rowLength, row);
+                const float* up = split.Get(positions, rowLength, row + 1);
+
+                for (; col + VECTOR_SIMD_WIDTH - 1 <= interiorEnd; col += VECTOR_SIMD_WIDTH)
+                    ComputeInteriorNormals(down, center, up, split.width, col - first,
+                        normals + 3 * (row * rowLength + col));
+            }
+        }
+#endif
+        for (; col <= col1; col++)
+            ComputeVertexNormal(gridSize, row, col, positions, normals);
+    }
+}
+
+struct GridNormalsJob {
+    int gridSize;
+    const float* positions;
+    float* normals;
+};
+
+// Rows [begin, end) of the grid
+static void NormalsJob(void* data, int begin, int end) {
+    GridNormalsJob* job = (GridNormalsJob*)data;
+    ComputeGridNormalsRegion(job->gridSize, begin, end - 1, 0, job->gridSize, job->positions, job->normals);
+}
+
+void ComputeGridNormals(int gridSize, const float* positions, float* normals, JobSystem* jobs) {
+    int numRows = gridSize + 1;
+
+    if (!jobs || jobs->GetNumThreads() < 2 || numRows * numRows < kMinVerticesForThreads) {
+        ComputeGridNormalsRegion(gridSize, 0, gridSize, 0, gridSize, positions, normals);
+        return;
+    }
+
+    // Every vertex only reads positions and writes its own normal, so bands
+    // of rows can be processed independently
+    GridNormalsJob job = { gridSize, positions, normals };
+    jobs->ParallelFor(numRows, 0, NormalsJob, &job);
+}
+
+void ComputeGridNormalsScalar(int gridSize, const float* positions, float* normals) {
+    for (int row = 0; row <= gridSize; row++) {
+        for (int col = 0; col <= gridSize; col++)
+            ComputeVertexNormal(gridSize, row, col, positions, normals);
+    }
+}
@@ -0,0 +1,30 @@
+#ifndef MESHNORMALS_H
+#define MESHNORMALS_H
+
+// Smooth vertex normals for a regular grid of (gridSize + 1) x (gridSize + 1)
+// vertices, row after row. Positions and normals are x, y, z floats per
+// vertex, the layout glVertexPointer and glNormalPointer read with stride 0.
+//
+// Each vertex normal is the normalized sum of the unit corner normals of the
+// (up to four) quads sharing the vertex, so shared vertices get an average
+// rather than the contribution of whichever quad was visited last.
+
+class JobSystem;
+
+// Recomputes normals for the whole grid. Uses SSE/AVX when the compiler
+// targets it, splitting three rows at a time into x/y/z arrays to load
+// neighbouring vertices together, and splits large grids into bands of rows
+// across jobs' threads.
+// jobs may be NULL to do everything on the calling thread.
+void ComputeGridNormals(int gridSize, const float* positions, float* normals, JobSystem* jobs);
+
+// Recomputes normals only for vertices in rows [row0, row1] and
+// columns [col0, col1] (inclusive, clamped to the grid).
+void ComputeGridNormalsRegion(int gridSize, int row0, int row1, int col0, int col1,
+    const float* positions, float* normals);
+
+// Plain scalar version of ComputeGridNormals, used as the reference the
+// vectorized paths must match.
+void ComputeGridNormalsScalar(int gridSize, const float* positions, float* normals);
+
+#endif  // MESHNORMALS_H
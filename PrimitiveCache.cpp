@@ -0,0 +1,126 @@
+#ifdef _WIN32
+#include <windows.h>
+#endif
+#include <GL/gl.h>
+#include <math.h>
+#include <vector>
+#include "PrimitiveCache.h"
+
+static const float kPi = 3.14159265358979f;
+
+PrimitiveCache::~PrimitiveCache() {
+    Clear();
+}
+
+const PrimitiveMesh* PrimitiveCache::Find(PrimitiveShape shape, int slices, int stacks) {
+    for (size_t i = 0; i < meshes.size(); i++) {
+        if (meshes[i]->shape == shape && meshes[i]->slices == slices && meshes[i]->stacks == stacks)
+            return meshes[i];
+    }
+    return NULL;
+}
+
+PrimitiveMesh* PrimitiveCache::NewMesh(PrimitiveShape shape, int slices, int stacks, int numVertices, int numIndices) {
+    PrimitiveMesh* mesh = new PrimitiveMesh;
+    mesh->shape = shape;
+    mesh->slices = slices;
+    mesh->stacks = stacks;
+    mesh->vertices = new GLfloat[numVertices * 6];
+    mesh->indices = new GLuint[numIndices];
+    mesh->numVertices = numVertices;
+    mesh->numIndices = numIndices;
+    meshes.push_back(mesh);
+    return mesh;
+}
+
+const PrimitiveMesh* PrimitiveCache::GetCube() {
+    const PrimitiveMesh* found = Find(SHAPE_CUBE, 0, 0);
+    if (found)
+        return found;
+
+    PrimitiveMesh* mesh = NewMesh(SHAPE_CUBE, 0, 0, 24, 36);
+    BuildCube(mesh);
+    return mesh;
+}
+
+const PrimitiveMesh* PrimitiveCache::GetCylinder(int slices, int stacks) {
+    if (slices < 3) slices = 3;
+    if (stacks < 1) stacks = 1;
+    const PrimitiveMesh* found = Find(SHAPE_CYLINDER, slices, stacks);
+    if (found)
+        return found;
+
+    PrimitiveMesh* mesh = NewMesh(SHAPE_CYLINDER, slices, stacks, (slices + 1) * (stacks + 1), slices * stacks * 6);
+    BuildCylinder(mesh);
+    return mesh;
+}
+
+void PrimitiveCache::BuildCube(PrimitiveMesh* mesh) {
+    // Per face: outward normal, then two edge directions whose cross product
+    // is that normal so the corners come out counterclockwise from outside
+    static const float faces[6][9] = {
+        { 1, 0, 0,   0, 1, 0,   0, 0, 1 },
+        { -1, 0, 0,  0, 0, 1,   0, 1, 0 },
+        { 0, 1, 0,   0, 0, 1,   1, 0, 0 },
+        { 0, -1, 0,  1, 0, 0,   0, 0, 1 },
+        { 0, 0, 1,   1, 0, 0,   0, 1, 0 },
+        { 0, 0, -1,  0, 1, 0,   1, 0, 0 },
+    };
+    static const float corners[4][2] = { { -1, -1 }, { 1, -1 }, { 1, 1 }, { -1, 1 } };
+    GLfloat* v = mesh->vertices;
+    GLuint* index = mesh->indices;
+
+    for (int f = 0; f < 6; f++) {
+        const float* n = faces[f];
+        const float* u = faces[f] + 3;
+        const float* w = faces[f] + 6;
+        GLuint base = f * 4;
+
+        for (int c = 0; c < 4; c++) {
+            for (int k = 0; k < 3; k++)
+                *v++ = 0.5f * (n[k] + corners[c][0] * u[k] + corners[c][1] * w[k]);
+            for (int k = 0; k < 3; k++)
+                *v++ = n[k];
+        }
+        *index++ = base; *index++ = base + 1; *index++ = base + 2;
+        *index++ = base; *index++ = base + 2; *index++ = base + 3;
+    }
+}
+
+void PrimitiveCache::BuildCylinder(PrimitiveMesh* mesh) {
+    // Along +z from 0 to 1. The seam column is duplicated so every slice is a
+    // plain quad, and x = sin, y = cos around the axis as GLU does.
+    int slices = mesh->slices, stacks = mesh->stacks;
+    GLfloat* v = mesh->vertices;
+    GLuint* index = mesh->indices;
+
+    for (int j = 0; j <= stacks; j++) {
+        float z = (float)j / stacks;
+        for (int i = 0; i <= slices; i++) {
+            float angle = 2.0f * kPi * (i == slices ? 0 : i) / slices;
+            float s = sinf(angle), c = cosf(angle);
+            *v++ = s; *v++ = c; *v++ = z;
+            *v++ = s; *v++ = c; *v++ = 0.0f;
+        }
+    }
+
+    for (int j = 0; j < stacks; j++) {
+        for (int i = 0; i < slices; i++) {
+            GLuint q0 = j * (slices + 1) + i;
+            GLuint q1 = q0 + 1;
+            GLuint q3 = q0 + slices + 1;
+            GLuint q2 = q3 + 1;
+            *index++ = q0; *index++ = q3; *index++ = q2;
+            *index++ = q0; *index++ = q2; *index++ = q1;
+        }
+    }
+}
+
+void PrimitiveCache::Clear() {
+    for (size_t i = 0; i < meshes.size(); i++) {
+        delete[] meshes[i]->vertices;
+        delete[] meshes[i]->indices;
+        delete meshes[i];
+    }
+    meshes.clear();
+}
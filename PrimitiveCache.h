@@ -0,0 +1,47 @@
+#ifndef PRIMITIVECACHE_H
+#define PRIMITIVECACHE_H
+
+#include <vector>
+
+// Shapes the cache can build, all unit sized so the model matrix scales them
+enum PrimitiveShape {
+    SHAPE_CUBE,      // glutSolidCube(1.0)
+    SHAPE_CYLINDER   // gluCylinder(quad, 1.0, 1.0, 1.0, slices, stacks), no end caps
+};
+
+// Triangles with interleaved position and normal, 6 floats per vertex
+struct PrimitiveMesh {
+    PrimitiveShape shape;
+    int slices, stacks;  // tessellation the mesh was built with, 0 for the cube
+    GLfloat* vertices;
+    GLuint* indices;
+    int numVertices;
+    int numIndices;
+};
+
+// Builds each shape once per tessellation and keeps it, so drawing a primitive
+// allocates nothing and tessellates nothing. The cache only builds meshes,
+// BakedGraph and RobotCrowd transform and draw them.
+class PrimitiveCache {
+private:
+    std::vector<PrimitiveMesh*> meshes;
+
+    const PrimitiveMesh* Find(PrimitiveShape shape, int slices, int stacks);
+    PrimitiveMesh* NewMesh(PrimitiveShape shape, int slices, int stacks, int numVertices, int numIndices);
+    void BuildCube(PrimitiveMesh* mesh);
+    void BuildCylinder(PrimitiveMesh* mesh);
+
+public:
+    PrimitiveCache() {}
+    ~PrimitiveCache();
+
+    // The returned meshes stay valid until Clear() or the cache is destroyed
+    const PrimitiveMesh* GetCube();
+    const PrimitiveMesh* GetCylinder(int slices, int stacks);
+
+    void Clear();
+
+    int GetNumMeshes() const { return (int)meshes.size(); }
+};
+
+#endif  // PRIMITIVECACHE_H
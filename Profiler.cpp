@@ -0,0 +1,139 @@
+#include <stdio.h>
+#include <math.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include "Profiler.h"
+
+static const char* counterNames[NUM_PROFILE_COUNTERS] = {
+    "gl calls", "draw calls", "vertices", "material switches"
+};
+
+Profiler::Profiler(int eventCapacity, int frameCapacity) {
+    this->eventCapacity = eventCapacity;
+    this->frameCapacity = frameCapacity;
+    events = new Event[eventCapacity];
+    frames = new Frame[frameCapacity];
+    numEvents = 0;
+    numFrames = 0;
+    frameStart = 0;
+    for (int c = 0; c < NUM_PROFILE_COUNTERS; c++)
+        counters[c] = 0;
+    numThreads = 0;
+    origin = std::chrono::steady_clock::now();
+}
+
+Profiler::~Profiler() {
+    delete[] events;
+    delete[] frames;
+}
+
+Profiler& GetProfiler() {
+    static Profiler profiler;
+    return profiler;
+}
+
+int Profiler::GetThreadIndex() {
+    thread_local int index = -1;
+    if (index < 0)
+        index = numThreads.fetch_add(1, std::memory_order_relaxed);
+    return index;
+}
+
+void Profiler::AddEvent(const char* name, long long start, long long end) {
+    unsigned int n = numEvents.fetch_add(1, std::memory_order_relaxed);
+    Event& event = events[n % eventCapacity];
+    event.name = name;
+    event.start = start;
+    event.duration = end - start;
+    event.thread = GetThreadIndex();
+}
+
+void Profiler::BeginFrame() {
+    GetThreadIndex();  // the thread drawing the frames is thread 0 in the trace
+    frameStart = Now();
+}
+
+void Profiler::EndFrame() {
+    long long end = Now();
+    AddEvent("frame", frameStart, end);
+
+    Frame& frame = frames[numFrames % frameCapacity];
+    frame.start = frameStart;
+    frame.duration = end - frameStart;
+    for (int c = 0; c < NUM_PROFILE_COUNTERS; c++)
+        frame.counters[c] = counters[c].exchange(0, std::memory_order_relaxed);
+    numFrames++;
+}
+
+bool Profiler::WriteChromeTrace(const char* path) const {
+    FILE* file = fopen(path, "w");
+    if (!file)
+        return false;
+
+    // The rings keep only the newest events and frames
+    unsigned int lastEvent = numEvents.load(std::memory_order_acquire);
+    unsigned int firstEvent = lastEvent > (unsigned int)eventCapacity ? lastEvent - eventCapacity : 0;
+    unsigned int firstFrame = numFrames > (unsigned int)frameCapacity ? numFrames - frameCapacity : 0;
+    int threads = numThreads.load(std::memory_order_relaxed);
+
+    // Chrome wants microseconds
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"Robot3D\"}}");
+    for (int t = 0; t < threads; t++)
+        fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"thread %d\"}}", t, t);
+
+    for (unsigned int n = firstEvent; n < lastEvent; n++) {
+        const Event& event = events[n % eventCapacity];
+        fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+            event.name, event.thread, event.start * 0.001, event.duration * 0.001);
+    }
+
+    for (unsigned int n = firstFrame; n < numFrames; n++) {
+        const Frame& frame = frames[n % frameCapacity];
+        fprintf(file, ",\n{\"name\":\"frame\",\"ph\":\"C\",\"pid\":1,\"tid\":0,\"ts\":%.3f,\"args\":{", frame.start * 0.001);
+        for (int c = 0; c < NUM_PROFILE_COUNTERS; c++)
+            fprintf(file, "%s\"%s\":%d", c > 0 ? "," : "", counterNames[c], frame.counters[c]);
+        fprintf(file, "}}");
+    }
+    fprintf(file, "\n]}\n");
+
+    bool ok = ferror(file) == 0;
+    return fclose(file) == 0 && ok;
+}
+
+// Nearest-rank percentile of sorted values
+static double Percentile(const std::vector<long long>& sorted, double p) {
+    int rank = (int)ceil(p * sorted.size());
+    return sorted[rank > 0 ? rank - 1 : 0] * 1e-6;
+}
+
+void Profiler::PrintSummary(FILE* file) const {
+    unsigned int firstFrame = numFrames > (unsigned int)frameCapacity ? numFrames - frameCapacity : 0;
+    int count = (int)(numFrames - firstFrame);
+    if (count == 0) {
+        fprintf(file, "profile: no frames recorded\n");
+        return;
+    }
+
+    std::vector<long long> durations(count);
+    double totals[NUM_PROFILE_COUNTERS] = {};
+    double totalMs = 0.0;
+    for (int i = 0; i < count; i++) {
+        const Frame& frame = frames[(firstFrame + i) % frameCapacity];
+        durations[i] = frame.duration;
+        totalMs += frame.duration * 1e-6;
+        for (int c = 0; c < NUM_PROFILE_COUNTERS; c++)
+            totals[c] += frame.counters[c];
+    }
+    std::sort(durations.begin(), durations.end());
+
+    fprintf(file, "profile: %d frames, ms per frame mean %.3f p50 %.3f p95 %.3f p99 %.3f max %.3f\n",
+        count, totalMs / count, Percentile(durations, 0.50), Percentile(durations, 0.95),
+        Percentile(durations, 0.99), durations[count - 1] * 1e-6);
+    fprintf(file, "profile: per frame");
+    for (int c = 0; c < NUM_PROFILE_COUNTERS; c++)
+        fprintf(file, "%s %s %.1f", c > 0 ? "," : "", counterNames[c], totals[c] / count);
+    fprintf(file, "\n");
+}
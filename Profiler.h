@@ -0,0 +1,109 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+
+// What the draw code counts each frame
+enum ProfileCounter {
+    COUNTER_GL_CALLS,           // every gl* call made while drawing
+    COUNTER_DRAW_CALLS,         // glDrawElements and glBegin/glEnd pairs
+    COUNTER_VERTICES,           // vertices sent to GL or to the software renderer
+    COUNTER_MATERIAL_SWITCHES,  // material binds that changed GL state
+    NUM_PROFILE_COUNTERS
+};
+
+// Scoped CPU timers and per-frame counters for finding where a frame goes.
+// Timers from any thread go into a fixed ring of events: recording one is an
+// atomic increment and a few stores, no lock and no allocation, and once the
+// ring is full the oldest events are overwritten. EndFrame() keeps each
+// frame's time and counters in a second ring for the percentile summary.
+// WriteChromeTrace() and PrintSummary() read the rings, so call them only
+// while no other thread is recording, between frames.
+//
+// The PROFILE_* macros below are what the rest of the program uses. Unless
+// ROBOT3D_PROFILE is defined they expand to nothing, so a normal build has no
+// timing code in it at all.
+class Profiler {
+private:
+    // Times are nanoseconds since the Profiler was created
+    struct Event {
+        const char* name;  // must outlive the Profiler, a string literal
+        long long start;
+        long long duration;
+        int thread;
+    };
+
+    struct Frame {
+        long long start;
+        long long duration;
+        int counters[NUM_PROFILE_COUNTERS];
+    };
+
+    Event* events;
+    int eventCapacity;
+    std::atomic<unsigned int> numEvents;  // recorded so far, event n lives in slot n % eventCapacity
+
+    Frame* frames;
+    int frameCapacity;
+    unsigned int numFrames;               // ended so far, same ring layout as events
+    long long frameStart;
+
+    std::atomic<int> counters[NUM_PROFILE_COUNTERS];
+    std::atomic<int> numThreads;          // threads that have recorded an event
+    std::chrono::steady_clock::time_point origin;
+
+public:
+    Profiler(int eventCapacity = 1 << 18, int frameCapacity = 1 << 14);
+    ~Profiler();
+
+    long long Now() const {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - origin).count();
+    }
+    int GetThreadIndex();  // small per-thread number in the order threads first record
+
+    void AddEvent(const char* name, long long start, long long end);
+    void Count(ProfileCounter counter, int amount) { counters[counter].fetch_add(amount, std::memory_order_relaxed); }
+
+    void BeginFrame();
+    void EndFrame();   // Stores the frame's time and counters and zeroes the counters
+
+    // Chrome trace event format, load it in chrome://tracing or Perfetto
+    bool WriteChromeTrace(const char* path) const;
+
+    // Frame time mean and p50/p95/p99/max plus the mean of each counter
+    void PrintSummary(FILE* file) const;
+
+    int GetNumFrames() const { return (int)numFrames; }
+};
+
+// The one Profiler the PROFILE_* macros record into
+Profiler& GetProfiler();
+
+// Times the enclosing scope
+class ProfileScope {
+private:
+    const char* name;
+    long long start;
+
+public:
+    ProfileScope(const char* name) : name(name), start(GetProfiler().Now()) {}
+    ~ProfileScope() { GetProfiler().AddEvent(name, start, GetProfiler().Now()); }
+};
+
+#ifdef ROBOT3D_PROFILE
+#define PROFILE_JOIN2(a, b) a##b
+#define PROFILE_JOIN(a, b) PROFILE_JOIN2(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_JOIN(profileScope, __LINE__)(name)
+#define PROFILE_COUNT(counter, amount) GetProfiler().Count(counter, amount)
+#define PROFILE_BEGIN_FRAME() GetProfiler().BeginFrame()
+#define PROFILE_END_FRAME() GetProfiler().EndFrame()
+#else
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_COUNT(counter, amount) ((void)0)
+#define PROFILE_BEGIN_FRAME() ((void)0)
+#define PROFILE_END_FRAME() ((void)0)
+#endif
+
+#endif  // PROFILER_H
@@ -0,0 +1,202 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+//	QUATERNION.cpp
+//	Function definitions for rotation quaternion class
+//	The product and the slerp blend have SSE paths with a scalar fallback
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#include <math.h>
+#include "VECTOR3D.h"
+#include "VECTOR4D.h"
+#include "MATRIX4X4.h"
+#include "QUATERNION.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define QUATERNION_SSE
+#endif
+
+static const double kDegreesToRadians = 3.14159265358979323846 / 180.0;
+
+void QUATERNION::SetFromAxisAngle(const double angle, const VECTOR3D& axis)
+{
+	float length = axis.GetLength();
+	if (length == 0.0f) {
+		LoadIdentity();
+		return;
+	}
+
+	double halfAngle = angle * kDegreesToRadians * 0.5;
+	float s = (float)sin(halfAngle) / length;
+
+	x = axis.x * s;
+	y = axis.y * s;
+	z = axis.z * s;
+	w = (float)cos(halfAngle);
+}
+
+void QUATERNION::GetAxisAngle(double& angle, VECTOR3D& axis) const
+{
+	QUATERNION q = GetNormalized();
+	float cw = q.w;
+
+	if (cw > 1.0f)
+		cw = 1.0f;
+	else if (cw < -1.0f)
+		cw = -1.0f;
+	angle = 2.0 * acos((double)cw) / kDegreesToRadians;
+
+	// The axis is undefined for (close to) no rotation, any will do
+	float s = sqrtf(1.0f - cw * cw);
+	if (s < 1e-6f)
+		axis.Set(1.0f, 0.0f, 0.0f);
+	else
+		axis.Set(q.x / s, q.y / s, q.z / s);
+}
+
+void QUATERNION::SetFromMatrix(const MATRIX4X4& matrix)
+{
+	// Shepperd's method: divide by the largest of w, x, y, z to stay accurate
+	const float* m = matrix.entries;
+	float trace = m[0] + m[5] + m[10];
+
+	if (trace > 0.0f) {
+		float s = sqrtf(trace + 1.0f) * 2.0f;
+		w = 0.25f * s;
+		x = (m[6] - m[9]) / s;
+		y = (m[8] - m[2]) / s;
+		z = (m[1] - m[4]) / s;
+	}
+	else if (m[0] > m[5] && m[0] > m[10]) {
+		float s = sqrtf(1.0f + m[0] - m[5] - m[10]) * 2.0f;
+		w = (m[6] - m[9]) / s;
+		x = 0.25f * s;
+		y = (m[4] + m[1]) / s;
+		z = (m[8] + m[2]) / s;
+	}
+	else if (m[5] > m[10]) {
+		float s = sqrtf(1.0f + m[5] - m[0] - m[10]) * 2.0f;
+		w = (m[8] - m[2]) / s;
+		x = (m[4] + m[1]) / s;
+		y = 0.25f * s;
+		z = (m[9] + m[6]) / s;
+	}
+	else {
+		float s = sqrtf(1.0f + m[10] - m[0] - m[5]) * 2.0f;
+		w = (m[1] - m[4]) / s;
+		x = (m[8] + m[2]) / s;
+		y = (m[9] + m[6]) / s;
+		z = 0.25f * s;
+	}
+}
+
+MATRIX4X4 QUATERNION::GetMatrix(void) const
+{
+	float xx = x * x, yy = y * y, zz = z * z;
+	float xy = x * y, xz = x * z, yz = y * z;
+	float wx = w * x, wy = w * y, wz = w * z;
+
+	return MATRIX4X4(1.0f - 2.0f * (yy + zz), 2.0f * (xy + wz), 2.0f * (xz - wy), 0.0f,
+		2.0f * (xy - wz), 1.0f - 2.0f * (xx + zz), 2.0f * (yz + wx), 0.0f,
+		2.0f * (xz + wy), 2.0f * (yz - wx), 1.0f - 2.0f * (xx + yy), 0.0f,
+		0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+void QUATERNION::Normalize(void)
+{
+	float length = sqrtf(DotProduct(*this));
+	if (length == 0.0f) {
+		LoadIdentity();
+		return;
+	}
+
+	float invLength = 1.0f / length;
+	x *= invLength;
+	y *= invLength;
+	z *= invLength;
+	w *= invLength;
+}
+
+QUATERNION QUATERNION::GetNormalized(void) const
+{
+	QUATERNION result(*this);
+	result.Normalize();
+	return result;
+}
+
+QUATERNION QUATERNION::Slerp(const QUATERNION& q2, float factor) const
+{
+	float cosTheta = DotProduct(q2);
+	float sign = 1.0f;
+
+	// q and -q are the same rotation, take the one on the shorter arc
+	if (cosTheta < 0.0f) {
+		cosTheta = -cosTheta;
+		sign = -1.0f;
+	}
+
+	// Nearly parallel: sin(theta) is too small to divide by, lerp instead
+	float weight1, weight2;
+	bool nearlyParallel = cosTheta > 0.9995f;
+	if (nearlyParallel) {
+		weight1 = 1.0f - factor;
+		weight2 = factor;
+	}
+	else {
+		float theta = acosf(cosTheta);
+		float invSinTheta = 1.0f / sinf(theta);
+		weight1 = sinf((1.0f - factor) * theta) * invSinTheta;
+		weight2 = sinf(factor * theta) * invSinTheta;
+	}
+	weight2 *= sign;
+
+	QUATERNION result;
+#ifdef QUATERNION_SSE
+	__m128 r = _mm_add_ps(_mm_mul_ps(_mm_load_ps(&x), _mm_set1_ps(weight1)),
+		_mm_mul_ps(_mm_load_ps(&q2.x), _mm_set1_ps(weight2)));
+	_mm_store_ps(&result.x, r);
+#else
+	result.x = x * weight1 + q2.x * weight2;
+	result.y = y * weight1 + q2.y * weight2;
+	result.z = z * weight1 + q2.z * weight2;
+	result.w = w * weight1 + q2.w * weight2;
+#endif
+
+	if (nearlyParallel)
+		result.Normalize();
+	return result;
+}
+
+VECTOR3D QUATERNION::GetRotatedVECTOR3D(const VECTOR3D& rhs) const
+{
+	// v + w * t + u x t, with u the vector part and t = 2 * (u x v)
+	VECTOR3D u(x, y, z);
+	VECTOR3D t = u.CrossProduct(rhs) * 2.0f;
+	return rhs + t * w + u.CrossProduct(t);
+}
+
+QUATERNION QUATERNION::operator*(const QUATERNION& rhs) const
+{
+	QUATERNION result;
+
+#ifdef QUATERNION_SSE
+	// Each lane is w1 * q2 plus x1, y1 and z1 times a signed shuffle of q2:
+	//	x1 * ( w2, -z2,  y2, -x2)
+	//	y1 * ( z2,  w2, -x2, -y2)
+	//	z1 * (-y2,  x2,  w2, -z2)
+	__m128 q2 = _mm_load_ps(&rhs.x);
+	__m128 xTerm = _mm_xor_ps(_mm_shuffle_ps(q2, q2, _MM_SHUFFLE(0, 1, 2, 3)), _mm_setr_ps(0.0f, -0.0f, 0.0f, -0.0f));
+	__m128 yTerm = _mm_xor_ps(_mm_shuffle_ps(q2, q2, _MM_SHUFFLE(1, 0, 3, 2)), _mm_setr_ps(0.0f, 0.0f, -0.0f, -0.0f));
+	__m128 zTerm = _mm_xor_ps(_mm_shuffle_ps(q2, q2, _MM_SHUFFLE(2, 3, 0, 1)), _mm_setr_ps(-0.0f, 0.0f, 0.0f, -0.0f));
+
+	__m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(w), q2), _mm_mul_ps(_mm_set1_ps(x), xTerm)),
+		_mm_add_ps(_mm_mul_ps(_mm_set1_ps(y), yTerm), _mm_mul_ps(_mm_set1_ps(z), zTerm)));
+	_mm_store_ps(&result.x, r);
+#else
+	result.x = (w * rhs.x + x * rhs.w) + (y * rhs.z - z * rhs.y);
+	result.y = (w * rhs.y - x * rhs.z) + (y * rhs.w + z * rhs.x);
+	result.z = (w * rhs.z + x * rhs.y) + (-y * rhs.x + z * rhs.w);
+	result.w = (w * rhs.w - x * rhs.x) + (-y * rhs.y - z * rhs.z);
+#endif
+
+	return result;
+}
@@ -0,0 +1,94 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+//	QUATERNION.h
+//	Class declaration for a rotation quaternion
+//	Stored x, y, z, w and aligned to 16 bytes so it loads into an SSE register
+//	Angles are in degrees, like glRotatef
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef QUATERNION_H
+#define QUATERNION_H
+
+#include "VECTOR3D.h"
+#include "VECTOR4D.h"
+#include "MATRIX4X4.h"
+
+class alignas(16) QUATERNION
+{
+public:
+	//constructors, the default one is the identity rotation
+	QUATERNION(void) : x(0.0f), y(0.0f), z(0.0f), w(1.0f)
+	{}
+
+	QUATERNION(float newX, float newY, float newZ, float newW) : x(newX), y(newY), z(newZ), w(newW)
+	{}
+
+	QUATERNION(const double angle, const VECTOR3D& axis)
+	{
+		SetFromAxisAngle(angle, axis);
+	}
+
+	void Set(float newX, float newY, float newZ, float newW)
+	{
+		x = newX;	y = newY;	z = newZ;	w = newW;
+	}
+
+	void LoadIdentity(void)
+	{
+		x = y = z = 0.0f;
+		w = 1.0f;
+	}
+
+	//axis-angle conversions. A zero axis gives the identity
+	void SetFromAxisAngle(const double angle, const VECTOR3D& axis);
+	void GetAxisAngle(double& angle, VECTOR3D& axis) const;
+
+	//matrix conversions. SetFromMatrix reads the rotation part only, which
+	//must not be scaled
+	void SetFromMatrix(const MATRIX4X4& matrix);
+	MATRIX4X4 GetMatrix(void) const;
+
+	float DotProduct(const QUATERNION& rhs) const
+	{
+		return x * rhs.x + y * rhs.y + z * rhs.z + w * rhs.w;
+	}
+
+	void Normalize(void);
+	QUATERNION GetNormalized(void) const;
+
+	QUATERNION GetConjugate(void) const
+	{
+		return QUATERNION(-x, -y, -z, w);
+	}
+
+	//shortest-arc spherical interpolation, factor in [0,1]
+	QUATERNION Slerp(const QUATERNION& q2, float factor) const;
+
+	VECTOR3D GetRotatedVECTOR3D(const VECTOR3D& rhs) const;
+
+	//this * rhs applies rhs first, like multiplying the matrices
+	QUATERNION operator*(const QUATERNION& rhs) const;
+	void operator*=(const QUATERNION& rhs)
+	{
+		(*this) = (*this) * rhs;
+	}
+
+	bool operator==(const QUATERNION& rhs) const
+	{
+		return x == rhs.x && y == rhs.y && z == rhs.z && w == rhs.w;
+	}
+
+	bool operator!=(const QUATERNION& rhs) const
+	{
+		return !((*this) == rhs);
+	}
+
+	VECTOR4D GetVECTOR4D(void) const { return VECTOR4D(x, y, z, w); }
+
+	//member variables
+	float x;
+	float y;
+	float z;
+	float w;
+};
+
+#endif	//QUATERNION_H
@@ -1,20 +1,34 @@
+#ifdef _WIN32
 #include <windows.h>
-#include <gl/gl.h>
-#include <gl/glu.h>
-#include <gl/glut.h>
+#endif
+#include <GL/gl.h>
+#include <GL/glu.h>
+#include <GL/glut.h>
 #include <utility>  // For std::pair
+#include <vector>
 #include <string.h>
 #include <math.h>
+#include <xmmintrin.h>  // For _mm_malloc/_mm_free
 #include "VECTOR3D.h"
+#include "MATRIX4X4.h"
 #include "QuadMesh.h"
+#include "MaterialRegistry.h"
+#include "VectorBatch.h"
+#include "MeshNormals.h"
+#include "SoftwareRasterizer.h"
+#include "Profiler.h"
 
 QuadMesh::QuadMesh(int maxMeshSize, float meshDim) {
     minMeshSize = 1;
     numVertices = 0;
-    vertices = NULL;
+    positions = NULL;
+    normals = NULL;
     numQuads = 0;
-    quads = NULL;
     numFacesDrawn = 0;
+    activeMeshSize = 0;
+    drawStrip = NULL;
+    materialRegistry = NULL;
+    materialID = -1;
 
     this->maxMeshSize = maxMeshSize < minMeshSize ? minMeshSize : maxMeshSize;
     this->meshDim = meshDim;
@@ -50,29 +64,128 @@ void QuadMesh::SetMaterial(VECTOR3D ambient, VECTOR3D diffuse, VECTOR3D specular
     mat_diffuse[2] = diffuse.z;
     mat_diffuse[3] = 1.0;
     mat_shininess[0] = shininess;
+    materialRegistry = NULL;
 }
 
-bool QuadMesh::CreateMemory() {
-    vertices = new MeshVertex[(maxMeshSize + 1) * (maxMeshSize + 1)];
-    if (!vertices) {
-        return false;
+void QuadMesh::UseMaterial(MaterialRegistry* registry, int material) {
+    materialRegistry = registry;
+    materialID = material;
+}
+
+void QuadMesh::ApplyMaterial() {
+    if (materialRegistry) {
+        materialRegistry->Bind(materialID);
+        return;
     }
 
-    quads = new MeshQuad[maxMeshSize * maxMeshSize];
-    if (!quads) {
+    glMaterialfv(GL_FRONT, GL_AMBIENT, mat_ambient);
+    glMaterialfv(GL_FRONT, GL_SPECULAR, mat_specular);
+    glMaterialfv(GL_FRONT, GL_DIFFUSE, mat_diffuse);
+    glMaterialfv(GL_FRONT, GL_SHININESS, mat_shininess);
+    PROFILE_COUNT(COUNTER_GL_CALLS, 4);
+    PROFILE_COUNT(COUNTER_MATERIAL_SWITCHES, 1);
+}
+
+// Allocates a float array aligned for SSE/AVX loads
+static float* AllocFloats(int count) {
+    return (float*)_mm_malloc(count * sizeof(float), 32);
+}
+
+bool QuadMesh::CreateMemory() {
+    int maxVertices = (maxMeshSize + 1) * (maxMeshSize + 1);
+
+    // 3 floats (x, y, z) per vertex each
+    positions = AllocFloats(maxVertices * 3);
+    normals = AllocFloats(maxVertices * 3);
+    if (!positions || !normals) {
         return false;
     }
 
     return true;
 }
 
+// Index lists for drawing a grid as one triangle strip. They only depend on
+// the grid size drawn and the row length of the vertex arrays, so every mesh
+// drawing the same grid (all the chunks of a Terrain, say) shares one list.
+// Meshes are created and drawn on one thread, the list needs no lock.
+struct GridStrip {
+    int meshSize;
+    int rowLength;
+    int refs;
+    GLuint* indices;
+    int numIndices;
+};
+
+static std::vector<GridStrip*> gridStrips;
+
+static GridStrip* AcquireGridStrip(int meshSize, int rowLength) {
+    for (size_t i = 0; i < gridStrips.size(); i++) {
+        GridStrip* strip = gridStrips[i];
+        if (strip->meshSize == meshSize && strip->rowLength == rowLength) {
+            strip->refs++;
+            return strip;
+        }
+    }
+
+    // Each row of quads zigzags between the row above and the row below. Rows
+    // are joined by repeating the last index of one and the first of the next,
+    // which adds degenerate triangles and keeps the next row's winding.
+    GridStrip* strip = new GridStrip;
+    strip->meshSize = meshSize;
+    strip->rowLength = rowLength;
+    strip->refs = 1;
+    strip->numIndices = meshSize * 2 * (meshSize + 1) + (meshSize - 1) * 2;
+    strip->indices = new GLuint[strip->numIndices];
+
+    GLuint* dst = strip->indices;
+    for (int j = 0; j < meshSize; j++) {
+        if (j > 0) {
+            dst[0] = dst[-1];
+            dst[1] = (j + 1) * rowLength;
+            dst += 2;
+        }
+        // Same two counterclockwise triangles per quad as GetQuad()'s corners
+        // split along their 0-2 diagonal
+        for (int k = 0; k <= meshSize; k++) {
+            dst[0] = (j + 1) * rowLength + k;
+            dst[1] = j * rowLength + k;
+            dst += 2;
+        }
+    }
+    gridStrips.push_back(strip);
+    return strip;
+}
+
+static void ReleaseGridStrip(GridStrip* strip) {
+    if (--strip->refs > 0)
+        return;
+    for (size_t i = 0; i < gridStrips.size(); i++) {
+        if (gridStrips[i] == strip) {
+            gridStrips.erase(gridStrips.begin() + i);
+            break;
+        }
+    }
+    delete[] strip->indices;
+    delete strip;
+}
+
+const GridStrip* QuadMesh::GetDrawStrip(int meshSize) {
+    int rowLength = activeMeshSize + 1;
+
+    if (drawStrip && (drawStrip->meshSize != meshSize || drawStrip->rowLength != rowLength)) {
+        ReleaseGridStrip(drawStrip);
+        drawStrip = NULL;
+    }
+    if (!drawStrip)
+        drawStrip = AcquireGridStrip(meshSize, rowLength);
+    return drawStrip;
+}
+
 QuadMesh::MaxMeshDim QuadMesh::GetMaxMeshDimensions() const {
     return MaxMeshDim(minMeshSize, maxMeshSize);  // Corrected function implementation
 }
 
 bool QuadMesh::InitMesh(int meshSize, VECTOR3D origin, double meshLength, double meshWidth, VECTOR3D dir1, VECTOR3D dir2) {
-    VECTOR3D o;
-    int currentVertex = 0;
     double sf1, sf2;
 
     VECTOR3D v1, v2;
@@ -90,147 +203,221 @@ bool QuadMesh::InitMesh(int meshSize, VECTOR3D origin, double meshLength, double
     sf2 = meshWidth / meshSize;
     v2 *= sf2;
 
-    VECTOR3D meshpt;
+    activeMeshSize = meshSize;
+
+    meshOrigin = origin;
+    meshStep1 = v1;
+    meshStep2 = v2;
+    meshUp = dir1.CrossProduct(dir2);
+    meshUp.Normalize();
 
     // VERTICES
     numVertices = (meshSize + 1) * (meshSize + 1);
 
-    // Starts at front left corner of mesh
-    o.Set(origin.x, origin.y, origin.z);
-
-    for (int i = 0; i < meshSize + 1; i++) {
-        for (int j = 0; j < meshSize + 1; j++) {
-            // Compute vertex position along mesh row (along x direction)
-            meshpt.x = o.x + j * v1.x;
-            meshpt.y = o.y + j * v1.y;
-            meshpt.z = o.z + j * v1.z;
+    // Vertex (i, j) is origin + j * v1 + i * v2, starting at the front left
+    // corner of the mesh, so each row is its grid coordinates (j, i, 0) pushed
+    // through one affine transform
+    MATRIX4X4 gridToMesh(v1.x, v1.y, v1.z, 0.0f,
+        v2.x, v2.y, v2.z, 0.0f,
+        0.0f, 0.0f, 0.0f, 0.0f,
+        origin.x, origin.y, origin.z, 1.0f);
+
+    int rowLength = meshSize + 1;
+    float* gridCol = new float[rowLength];
+    float* gridRow = new float[rowLength];
+    float* gridZero = new float[rowLength];
+    float* rowX = new float[rowLength];
+    float* rowY = new float[rowLength];
+    float* rowZ = new float[rowLength];
+    for (int j = 0; j < rowLength; j++) {
+        gridCol[j] = (float)j;
+        gridZero[j] = 0.0f;
+    }
 
-            vertices[currentVertex].position.Set(meshpt.x, meshpt.y, meshpt.z);
-            currentVertex++;
+    for (int i = 0; i < rowLength; i++) {
+        // Next row in mesh (negative z direction)
+        for (int j = 0; j < rowLength; j++)
+            gridRow[j] = (float)i;
+        BatchTransformPoints(rowLength, gridToMesh, gridCol, gridRow, gridZero, rowX, rowY, rowZ);
+
+        float* dst = positions + 3 * i * rowLength;
+        for (int j = 0; j < rowLength; j++, dst += 3) {
+            dst[0] = rowX[j];
+            dst[1] = rowY[j];
+            dst[2] = rowZ[j];
         }
-        // Go to next row in mesh (negative z direction)
-        o += v2;
     }
 
-    // Build Quad Polygons
-    numQuads = (meshSize) * (meshSize);
-    int currentQuad = 0;
+    delete[] gridCol;
+    delete[] gridRow;
+    delete[] gridZero;
+    delete[] rowX;
+    delete[] rowY;
+    delete[] rowZ;
 
-    for (int j = 0; j < meshSize; j++) {
-        for (int k = 0; k < meshSize; k++) {
-            // Counterclockwise order
-            quads[currentQuad].vertices[0] = &vertices[j * (meshSize + 1) + k];
-            quads[currentQuad].vertices[1] = &vertices[j * (meshSize + 1) + k + 1];
-            quads[currentQuad].vertices[2] = &vertices[(j + 1) * (meshSize + 1) + k + 1];
-            quads[currentQuad].vertices[3] = &vertices[(j + 1) * (meshSize + 1) + k];
-            currentQuad++;
-        }
-    }
+    // Quad Polygons are implied by the grid, see GetQuad()
+    numQuads = (meshSize) * (meshSize);
 
     this->ComputeNormals();
 
     return true;
 }
 
+MeshQuad QuadMesh::GetQuad(int quad) const {
+    int rowLength = activeMeshSize + 1;
+    int j = quad / activeMeshSize;
+    int k = quad % activeMeshSize;
+    MeshQuad q;
+
+    // Counterclockwise order
+    q.vertices[0] = j * rowLength + k;
+    q.vertices[1] = j * rowLength + k + 1;
+    q.vertices[2] = (j + 1) * rowLength + k + 1;
+    q.vertices[3] = (j + 1) * rowLength + k;
+    return q;
+}
+
+void QuadMesh::GetBounds(VECTOR3D& min, VECTOR3D& max) const {
+    if (numVertices == 0) {
+        min.LoadZero();
+        max.LoadZero();
+        return;
+    }
+
+    float lo[3], hi[3];
+
+    for (int a = 0; a < 3; a++)
+        lo[a] = hi[a] = positions[a];
+    for (int v = 1; v < numVertices; v++) {
+        const float* p = positions + 3 * v;
+        for (int a = 0; a < 3; a++) {
+            if (p[a] < lo[a]) lo[a] = p[a];
+            if (p[a] > hi[a]) hi[a] = p[a];
+        }
+    }
+    min.Set(lo[0], lo[1], lo[2]);
+    max.Set(hi[0], hi[1], hi[2]);
+}
+
 void QuadMesh::DrawMesh(int meshSize) {
-    int currentQuad = 0;
+    PROFILE_SCOPE("QuadMesh::DrawMesh");
+    ApplyMaterial();
 
-    glMaterialfv(GL_FRONT, GL_AMBIENT, mat_ambient);
-    glMaterialfv(GL_FRONT, GL_SPECULAR, mat_specular);
-    glMaterialfv(GL_FRONT, GL_DIFFUSE, mat_diffuse);
-    glMaterialfv(GL_FRONT, GL_SHININESS, mat_shininess);
+    if (meshSize > activeMeshSize)
+        meshSize = activeMeshSize;
 
     for (int j = 0; j < meshSize; j++) {
         for (int k = 0; k < meshSize; k++) {
-            glBegin(GL_QUADS);
+            MeshQuad quad = GetQuad(j * activeMeshSize + k);
 
-            glNormal3f(quads[currentQuad].vertices[0]->normal.x,
-                quads[currentQuad].vertices[0]->normal.y,
-                quads[currentQuad].vertices[0]->normal.z);
-            glVertex3f(quads[currentQuad].vertices[0]->position.x,
-                quads[currentQuad].vertices[0]->position.y,
-                quads[currentQuad].vertices[0]->position.z);
-
-            glNormal3f(quads[currentQuad].vertices[1]->normal.x,
-                quads[currentQuad].vertices[1]->normal.y,
-                quads[currentQuad].vertices[1]->normal.z);
-            glVertex3f(quads[currentQuad].vertices[1]->position.x,
-                quads[currentQuad].vertices[1]->position.y,
-                quads[currentQuad].vertices[1]->position.z);
-
-            glNormal3f(quads[currentQuad].vertices[2]->normal.x,
-                quads[currentQuad].vertices[2]->normal.y,
-                quads[currentQuad].vertices[2]->normal.z);
-            glVertex3f(quads[currentQuad].vertices[2]->position.x,
-                quads[currentQuad].vertices[2]->position.y,
-                quads[currentQuad].vertices[2]->position.z);
-
-            glNormal3f(quads[currentQuad].vertices[3]->normal.x,
-                quads[currentQuad].vertices[3]->normal.y,
-                quads[currentQuad].vertices[3]->normal.z);
-            glVertex3f(quads[currentQuad].vertices[3]->position.x,
-                quads[currentQuad].vertices[3]->position.y,
-                quads[currentQuad].vertices[3]->position.z);
+            glBegin(GL_QUADS);
+            for (int c = 0; c < 4; c++) {
+                unsigned int v = quad.vertices[c];
+                glNormal3fv(normals + 3 * v);
+                glVertex3fv(positions + 3 * v);
+            }
             glEnd();
-            currentQuad++;
         }
     }
+    PROFILE_COUNT(COUNTER_GL_CALLS, meshSize * meshSize * 10);  // glBegin, 4 normals, 4 vertices, glEnd
+    PROFILE_COUNT(COUNTER_DRAW_CALLS, meshSize * meshSize);
+    PROFILE_COUNT(COUNTER_VERTICES, meshSize * meshSize * 4);
 }
 
 void QuadMesh::FreeMemory() {
-    if (vertices)
-        delete[] vertices;
-    vertices = NULL;
+    if (positions)
+        _mm_free(positions);
+    positions = NULL;
+    if (normals)
+        _mm_free(normals);
+    normals = NULL;
     numVertices = 0;
-
-    if (quads)
-        delete[] quads;
-    quads = NULL;
     numQuads = 0;
+
+    if (drawStrip)
+        ReleaseGridStrip(drawStrip);
+    drawStrip = NULL;
 }
 
-void QuadMesh::ComputeNormals() {
-    int currentQuad = 0;
-
-    for (int j = 0; j < this->maxMeshSize; j++) {
-        for (int k = 0; k < this->maxMeshSize; k++) {
-            VECTOR3D n0, n1, n2, n3, e0, e1, e2, e3;
-
-            quads[currentQuad].vertices[0]->normal.LoadZero();
-            quads[currentQuad].vertices[1]->normal.LoadZero();
-            quads[currentQuad].vertices[2]->normal.LoadZero();
-            quads[currentQuad].vertices[3]->normal.LoadZero();
-            e0 = quads[currentQuad].vertices[1]->position - quads[currentQuad].vertices[0]->position;
-            e1 = quads[currentQuad].vertices[2]->position - quads[currentQuad].vertices[1]->position;
-            e2 = quads[currentQuad].vertices[3]->position - quads[currentQuad].vertices[2]->position;
-            e3 = quads[currentQuad].vertices[0]->position - quads[currentQuad].vertices[3]->position;
-            e0.Normalize();
-            e1.Normalize();
-            e2.Normalize();
-            e3.Normalize();
-
-            n0 = e0.CrossProduct(-e3);
-            n0.Normalize();
-            quads[currentQuad].vertices[0]->normal += n0;
-
-            n1 = e1.CrossProduct(-e0);
-            n1.Normalize();
-            quads[currentQuad].vertices[1]->normal += n1;
-
-            n2 = e2.CrossProduct(-e1);
-            n2.Normalize();
-            quads[currentQuad].vertices[2]->normal += n2;
-
-            n3 = e3.CrossProduct(-e2);
-            n3.Normalize();
-            quads[currentQuad].vertices[3]->normal += n3;
-
-            quads[currentQuad].vertices[0]->normal.Normalize();
-            quads[currentQuad].vertices[1]->normal.Normalize();
-            quads[currentQuad].vertices[2]->normal.Normalize();
-            quads[currentQuad].vertices[3]->normal.Normalize();
-
-            currentQuad++;
+bool QuadMesh::SetHeights(int row0, int col0, int numRows, int numCols, const float* heights) {
+    if (row0 < 0 || col0 < 0 || numRows <= 0 || numCols <= 0 ||
+        row0 + numRows > activeMeshSize + 1 || col0 + numCols > activeMeshSize + 1) {
+        return false;
+    }
+
+    int rowLength = activeMeshSize + 1;
+
+    for (int i = 0; i < numRows; i++) {
+        int row = row0 + i;
+        for (int j = 0; j < numCols; j++) {
+            int col = col0 + j;
+            float* p = positions + 3 * (row * rowLength + col);
+            float h = heights[i * numCols + j];
+
+            p[0] = meshOrigin.x + col * meshStep1.x + row * meshStep2.x + h * meshUp.x;
+            p[1] = meshOrigin.y + col * meshStep1.y + row * meshStep2.y + h * meshUp.y;
+            p[2] = meshOrigin.z + col * meshStep1.z + row * meshStep2.z + h * meshUp.z;
         }
     }
+
+    // A vertex normal depends on its direct neighbours, so a one-vertex border
+    // around the edited region is enough
+    int row1 = row0 + numRows;
+    int col1 = col0 + numCols;
+    ComputeGridNormalsRegion(activeMeshSize, row0 - 1, row1, col0 - 1, col1, positions, normals);
+
+    return true;
+}
+
+void QuadMesh::DrawMeshIndexed(int meshSize) {
+    PROFILE_SCOPE("QuadMesh::DrawMeshIndexed");
+    if (meshSize > activeMeshSize)
+        meshSize = activeMeshSize;
+    if (meshSize <= 0)
+        return;
+
+    const GridStrip* strip = GetDrawStrip(meshSize);
+
+    ApplyMaterial();
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_NORMAL_ARRAY);
+    glVertexPointer(3, GL_FLOAT, 0, positions);
+    glNormalPointer(GL_FLOAT, 0, normals);
+
+    glDrawElements(GL_TRIANGLE_STRIP, strip->numIndices, GL_UNSIGNED_INT, strip->indices);
+
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    PROFILE_COUNT(COUNTER_GL_CALLS, 7);
+    PROFILE_COUNT(COUNTER_DRAW_CALLS, 1);
+    PROFILE_COUNT(COUNTER_VERTICES, strip->numIndices);
+}
+
+void QuadMesh::RasterizeIndexed(SoftwareRasterizer& rasterizer, const MATRIX4X4& modelview, int meshSize) {
+    if (meshSize > activeMeshSize)
+        meshSize = activeMeshSize;
+    if (meshSize <= 0)
+        return;
+
+    const GridStrip* strip = GetDrawStrip(meshSize);
+
+    if (materialRegistry) {
+        rasterizer.DrawMesh(modelview, materialRegistry->GetMaterial(materialID), positions, normals, 3, numVertices,
+            GL_TRIANGLE_STRIP, strip->indices, strip->numIndices);
+        return;
+    }
+
+    Material material;
+    memcpy(material.ambient, mat_ambient, sizeof(material.ambient));
+    memcpy(material.diffuse, mat_diffuse, sizeof(material.diffuse));
+    memcpy(material.specular, mat_specular, sizeof(material.specular));
+    material.shininess = mat_shininess[0];
+    rasterizer.DrawMesh(modelview, material, positions, normals, 3, numVertices,
+        GL_TRIANGLE_STRIP, strip->indices, strip->numIndices);
+}
+
+void QuadMesh::ComputeNormals(JobSystem* jobs) {
+    // Accumulate-then-normalize over the active grid, see MeshNormals.h
+    ComputeGridNormals(activeMeshSize, positions, normals, jobs);
 }
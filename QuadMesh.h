@@ -4,15 +4,16 @@
 #include "VECTOR3D.h"
 #include <utility>  // Necessary for std::pair
 
-// Structure representing a mesh vertex
-struct MeshVertex {
-    VECTOR3D position;
-    VECTOR3D normal;
-};
+class MaterialRegistry;
+class SoftwareRasterizer;
+class MATRIX4X4;
+class JobSystem;
+struct GridStrip;
 
-// Structure representing a quad (four vertices)
+// Structure representing a quad (four vertices). Quads are not stored, the
+// topology is implied by the grid and GetQuad() builds this view on demand.
 struct MeshQuad {
-    MeshVertex* vertices[4];  // pointers to vertices of each quad
+    unsigned int vertices[4];  // indices of the quad's vertices, counterclockwise
 };
 
 class QuadMesh {
@@ -21,23 +22,39 @@ private:
     int minMeshSize;
     float meshDim;
 
+    // Positions and normals are two separate arrays of x, y, z per vertex, so
+    // passes that only need positions (bounds, height edits) never touch
+    // normals, and GL draws straight from both with stride 0
     int numVertices;
-    MeshVertex* vertices;
+    float* positions;
+    float* normals;
 
     int numQuads;
-    MeshQuad* quads;
 
     int numFacesDrawn;
 
+    // Grid frame from InitMesh, used to place vertices when heights are edited
+    VECTOR3D meshOrigin;
+    VECTOR3D meshStep1;  // offset between neighbouring vertices along a row
+    VECTOR3D meshStep2;  // offset between neighbouring rows
+    VECTOR3D meshUp;     // unit normal of the flat grid, heights are measured along it
+
+    int activeMeshSize;     // meshSize given to the last InitMesh
+    GridStrip* drawStrip;   // triangle strip indices, shared with meshes drawing the same grid
+
     // Material properties
     GLfloat mat_ambient[4];
     GLfloat mat_specular[4];
     GLfloat mat_diffuse[4];
     GLfloat mat_shininess[1];
+    MaterialRegistry* materialRegistry;  // if set, materialID is bound instead of the values above
+    int materialID;
 
 private:
     bool CreateMemory();  // Allocates memory for the mesh
     void FreeMemory();    // Frees memory used by the mesh
+    const GridStrip* GetDrawStrip(int meshSize);  // The strip for drawing meshSize quads a side
+    void ApplyMaterial();
 
 public:
     typedef std::pair<int, int> MaxMeshDim;  // Corrected the type definition for mesh dimensions
@@ -52,8 +69,27 @@ public:
 
     bool InitMesh(int meshSize, VECTOR3D origin, double meshLength, double meshWidth, VECTOR3D dir1, VECTOR3D dir2);
     void DrawMesh(int meshSize);
+    void DrawMeshIndexed(int meshSize);  // Draws the vertex arrays as one triangle strip, a single glDrawElements
+    void RasterizeIndexed(SoftwareRasterizer& rasterizer, const MATRIX4X4& modelview, int meshSize);  // Same, on the CPU
     void SetMaterial(VECTOR3D ambient, VECTOR3D diffuse, VECTOR3D specular, double shininess);
-    void ComputeNormals();
+    void UseMaterial(MaterialRegistry* registry, int material);  // Draws with a registered material instead
+    void ComputeNormals(JobSystem* jobs = NULL);  // jobs splits large grids across threads, may be NULL
+
+    // Sets the height above the flat grid of the numRows x numCols vertices starting
+    // at (row0, col0); heights are row-major. Only normals of that region plus a
+    // one-vertex border are recomputed.
+    bool SetHeights(int row0, int col0, int numRows, int numCols, const float* heights);
+
+    // Axis-aligned bounds of the active grid, reads positions only
+    void GetBounds(VECTOR3D& min, VECTOR3D& max) const;
+    int GetMeshSize() const { return activeMeshSize; }
+
+    // Per-vertex and per-quad accessors over the active grid
+    int GetNumVertices() const { return numVertices; }
+    int GetNumQuads() const { return numQuads; }
+    MeshQuad GetQuad(int quad) const;
+    VECTOR3D GetPosition(int vertex) const { const float* p = positions + 3 * vertex; return VECTOR3D(p[0], p[1], p[2]); }
+    VECTOR3D GetNormal(int vertex) const { const float* n = normals + 3 * vertex; return VECTOR3D(n[0], n[1], n[2]); }
 };
 
 #endif  // QUADMESH_H
@@ -5,103 +5,42 @@
 #include <stdio.h>
 #include <string.h>
 #include <math.h>
-#include <gl/glut.h>
+#include <GL/glut.h>
 #include <utility>
 #include <vector>
+#include <chrono>
 #include "VECTOR3D.h"
+#include "MATRIX4X4.h"
 #include "QuadMesh.h"
+#include "Terrain.h"
+#include "Frustum.h"
+#include "SceneGraph.h"
+#include "RobotModel.h"
+#include "PrimitiveCache.h"
+#include "MaterialRegistry.h"
+#include "DrawList.h"
+#include "BakedGraph.h"
+#include "RobotCrowd.h"
+#include "JobSystem.h"
+#include "SimClock.h"
+#include "HeadlessContext.h"
+#include "SoftwareRasterizer.h"
+#include "Profiler.h"
 
 const int vWidth = 650;    // Viewport width in pixels
 const int vHeight = 500;    // Viewport height in pixels
 
-// Note how everything depends on robot body dimensions so that can scale entire robot proportionately
-// just by changing robot body scale
-float robotBodyWidth = 12.0;
-float robotBodyLength = 10.0;
-float robotBodyDepth = 8.0;
-float headWidth = 0.3 * robotBodyWidth;
-float headLength = headWidth;
-float headDepth = headWidth;
-float upperArmLength = robotBodyLength;
-float upperArmWidth = 0.2 * robotBodyWidth;
-float gunWidth = upperArmWidth;
-float gunLength = upperArmLength / 2.0;
-float gunDepth = upperArmWidth;
-float stanchionLength = robotBodyLength;
-float stanchionRadius = 0.1 * robotBodyDepth;
-float baseWidth = 1.5 * robotBodyWidth;
-float baseLength = 0.4 * stanchionLength;
-float legAngle = 0.0f;        // Controls the angle of the leg during stepping
 bool spinCannon = false;      // Flag to control cannon spinning
-float cannonSpinAngle = 0.0f; // Angle for cannon spinning
-
-// Joint angles for walking
-float hipAngleLeft = 0.0f;  // Angle for left hip joint
-float kneeAngleLeft = 0.0f; // Angle for left knee joint
-float ankleAngleLeft = 0.0f; // Angle for left ankle joint
-float hipAngleRight = 0.0f;  // Angle for right hip joint
-float kneeAngleRight = 0.0f; // Angle for right knee joint
-float ankleAngleRight = 0.0f; // Angle for right ankle joint
-float lowerLegAngleLeft = 0.0f;  // Angle for rotating lower part of the left leg
-float lowerLegAngleRight = 0.0f; // Angle for rotating lower part of the right leg
+
+// Joint angles and placement of every robot. robots[0] is the robot the keys
+// control, any others are the crowd standing around it.
+std::vector<RobotPose> robots;
 
 // Flag to control walking state
 bool walking = false;
-bool stepBackwards = false;  // Controls whether the leg is stepping forward or backward
-bool walkingForward = true;   // Track whether we're walking forward
 int selectedJoint = 0; // 0 for none, 1 for knee, 2 for hip, 3 for body
 int cameraView = 0; // 0 = default, 1 = front, 2 = side, 3 = top-down
 
-// Control Robot body rotation on base
-float robotAngle = 0.0;
-float neckAngle = 0.0f;   // Neck rotation
-
-// Control arm rotation
-float shoulderAngle = -40.0;
-float gunAngle = -25.0;
-
-// Lighting/shading and material properties for robot - upcoming lecture - just copy for now
-// Robot RGBA material properties (NOTE: we will learn about this later in the semester)
-GLfloat robotBody_mat_ambient[] = { 0.0f,0.0f,0.0f,1.0f };
-GLfloat robotBody_mat_specular[] = { 0.45f,0.55f,0.45f,1.0f };
-GLfloat robotBody_mat_diffuse[] = { 0.8f, 0.7f, 0.5f, 1.0f };
-GLfloat robotBody_mat_shininess[] = { 32.0F };
-
-GLfloat robotArm_mat_ambient[] = { 0.0215f, 0.1745f, 0.0215f, 0.55f };
-GLfloat robotArm_mat_diffuse[] = { 0.4f, 0.5f, 0.2f, 1.0f };
-GLfloat robotArm_mat_specular[] = { 0.7f, 0.6f, 0.6f, 1.0f };
-GLfloat robotArm_mat_shininess[] = { 32.0F };
-
-GLfloat dark_grey_ambient[] = { 0.1f, 0.1f, 0.1f, 1.0f };
-GLfloat dark_grey_diffuse[] = { 0.15f, 0.15f, 0.15f, 1.0f };
-GLfloat dark_grey_specular[] = { 0.2f, 0.2f, 0.2f, 1.0f };
-GLfloat dark_grey_shininess[] = { 50.0f };
-
-GLfloat robotLowerBody_mat_ambient[] = { 0.25f, 0.25f, 0.25f, 1.0f };
-GLfloat robotLowerBody_mat_diffuse[] = { 0.4f, 0.4f, 0.4f, 1.0f };
-GLfloat robotLowerBody_mat_specular[] = { 0.774597f, 0.774597f, 0.774597f, 1.0f };
-GLfloat robotLowerBody_mat_shininess[] = { 76.8F };
-
-GLfloat green_mat_ambient[] = { 0.02f, 0.15f, 0.02f, 1.0f };
-GLfloat green_mat_diffuse[] = { 0.05f, 0.2f, 0.05f, 0.1f };
-GLfloat green_mat_specular[] = { 0.2f, 0.2f, 0.2f, 1.0f };
-GLfloat green_mat_shininess[] = { 100.0f };
-
-GLfloat beige_mat_ambient[] = { 0.6f, 0.5f, 0.3f, 1.0f };
-GLfloat beige_mat_specular[] = { 0.1f, 0.1f, 0.1f, 1.0f };
-GLfloat beige_mat_diffuse[] = { 0.7f, 0.6f, 0.4f, 1.0f };
-GLfloat beige_mat_shininess[] = { 30.0f };
-
-GLfloat light_brown_mat_ambient[] = { 0.3f, 0.2f, 0.1f, 1.0f };
-GLfloat light_brown_mat_specular[] = { 0.1f, 0.1f, 0.1f, 1.0f };
-GLfloat light_brown_mat_diffuse[] = { 0.4f, 0.3f, 0.2f, 1.0f };
-GLfloat light_brown_mat_shininess[] = { 30.0f };
-
-GLfloat red_orange_ambient[] = { 0.8f, 0.2f, 0.0f, 1.0f };
-GLfloat red_orange_diffuse[] = { 0.9f, 0.3f, 0.1f, 1.0f };
-GLfloat red_orange_specular[] = { 0.8f, 0.2f, 0.1f, 1.0f };
-GLfloat red_orange_shininess[] = { 32.0F };
-
 // Light properties
 GLfloat light_position0[] = { -4.0F, 8.0F, 8.0F, 1.0F };
 GLfloat light_position1[] = { 4.0F, 8.0F, 8.0F, 1.0F };
@@ -109,39 +48,167 @@ GLfloat light_diffuse[] = { 1.0, 1.0, 1.0, 1.0 };
 GLfloat light_specular[] = { 1.0, 1.0, 1.0, 1.0 };
 GLfloat light_ambient[] = { 0.2F, 0.2F, 0.2F, 1.0F };
 
+GLfloat light_model_ambient[] = { 0.2F, 0.2F, 0.2F, 1.0F };  // GL's default GL_LIGHT_MODEL_AMBIENT
+GLfloat clear_color[] = { 0.4F, 0.4F, 0.4F, 0.0F };
+
 // Mouse button
 int currentButton;
 
-// A flat open mesh
-QuadMesh* groundMesh = NULL;
-
-// Structure defining a bounding box, currently unused
-typedef struct BoundingBox {
-	VECTOR3D min;
-	VECTOR3D max;
-} BBox;
-
-// Default Mesh Size
+// The robot's part hierarchy, built once in initOpenGL and posed from robots[0]
+SceneGraph robotGraph;
+int robotSocketNodes[NUM_ROBOT_SOCKETS];
+float jointAngles[NUM_ROBOT_JOINTS];
+SceneGraphInstance robotInstance;  // robots[0]'s world matrices, only moved parts are recomputed
+
+// The ground, tiled into QuadMesh chunks with distance based level of detail
+Terrain* groundTerrain = NULL;
+float groundSize = 4096.0;   // Side length of the ground
+int groundMaxDepth = 7;      // Finest chunks are groundSize / 2^7 = 32 units across
+
+// View frustum culling. Robot parts are tested in eye space against eyeFrustum,
+// ground chunks in world space against worldFrustum.
+Frustum eyeFrustum;
+Frustum worldFrustum;
+BBox primitiveBounds[NUM_ROBOT_PRIMITIVES] = {
+	{ VECTOR3D(-0.5f, -0.5f, -0.5f), VECTOR3D(0.5f, 0.5f, 0.5f) },  // unit cube
+	{ VECTOR3D(-1.0f, -1.0f, 0.0f), VECTOR3D(1.0f, 1.0f, 1.0f) },   // barrel
+};
+// Every material drawn with, so unchanged material state is never sent to GL again
+MaterialRegistry materials;
+int robotMaterialIDs[NUM_ROBOT_MATERIALS];
+int groundMaterialID;
+
+// Robot part groups recorded each frame, then submitted sorted by material
+DrawList drawList;
+bool sortDrawList = true;
+
+// Shared geometry for the robot primitives, built once in initOpenGL()
+PrimitiveCache primitiveCache;
+const PrimitiveMesh* primitiveMeshes[NUM_ROBOT_PRIMITIVES];
+
+// The robot's rigid parts merged into one mesh per joint and material, drawn a group per call
+BakedGraph bakedRobot;
+
+// Crowd mode: the robots after robots[0] are drawn in per-material batches,
+// with a coarser barrel since they are never seen close up
+RobotCrowd crowd;
+const PrimitiveMesh* crowdMeshes[NUM_ROBOT_PRIMITIVES];
+int crowdSizes[] = { 1, 1000, 10000 };  // robot counts the 'r' key cycles through
+int crowdSizeIndex = 0;
+float crowdSpacing = 30.0;    // Distance between neighbouring robots
+double farPlane = 100.0;      // Far clipping plane, pushed out while a crowd is shown
+double frameMilliseconds = 0.0;
+
+// Worker threads for the per-robot updates, one per core unless --threads says otherwise
+JobSystem* jobs = NULL;
+int numThreads = 0;
+
+// Software rendering: the same scene drawn on the CPU by the worker threads and
+// shown with glDrawPixels, or with no GL at all when headless
+SoftwareRasterizer rasterizer;
+RasterLight rasterLights[2];  // light_position0 and 1, already in eye space
+bool softwareRendering = false;
+
+// Animation runs in fixed 10 ms steps of real time, whatever the frame rate.
+// Frames are drawn from renderRobots: the main robot blended between its state
+// before the last step (previousRobot) and after it (robots[0]), the crowd
+// evaluated from the gait at the blended time.
+SimClock simClock(0.01);
+float walkFadeSeconds = 0.25f;  // Cross-fade between walking and standing
+bool simulationRunning = false;
+RobotPose previousRobot;
+std::vector<RobotPose> renderRobots;
+
+// The crowd walks in step with a shared gait clock, each robot offset by its
+// walkOffset, so it carries no animation state of its own
+double crowdWalkTime = 0.0;     // seconds of gait played
+float crowdWalkWeight = 0.0f;   // 0 standing to 1 walking, eased over walkFadeSeconds
+double previousWalkTime = 0.0;
+float previousWalkWeight = 0.0f;
+
+// Redisplay scheduling, see requestRedisplay(). Nothing is drawn while the
+// scene is still, and at most one frame per refresh while it is not.
+double refreshInterval = 1.0 / 60.0;  // Seconds, a 60 Hz display
+double lastFrameTime = -1.0;          // elapsedSeconds() when display() last ran
+bool redisplayPosted = false;         // glutPostRedisplay() called, display() not run yet
+bool redisplayTimerPending = false;   // redisplayTimer() set and not fired yet
+int numRedisplayRequests = 0;         // requests merged into the frame being drawn
+int framesDrawn = 0;
+
+bool showStats = false;  // Show per-frame statistics in the window title
+
+// Headless mode renders a fixed number of frames offscreen with no window and
+// exits. Time then advances one refreshInterval per frame, so every run draws
+// the same frames.
+bool headless = false;
+double headlessTime = 0.0;
+
+// Default Mesh Size, quads per side of each ground chunk
 int meshSize = 16;
 
 // Prototypes for functions in this module
 void initOpenGL(int w, int h);
+void initScene();
 void display(void);
+void getCameraView(VECTOR3D& eye, VECTOR3D& up);
+void drawScene(const VECTOR3D& eye, const VECTOR3D& up);
+void drawSceneSoftware(const VECTOR3D& eye, const VECTOR3D& up);
+void presentSoftwareImage();
 void reshape(int w, int h);
 void mouse(int button, int state, int x, int y);
 void mouseMotionHandler(int xMouse, int yMouse);
 void keyboard(unsigned char key, int x, int y);
 void functionKeys(int key, int x, int y);
-void animationHandler(int param);
 void drawRobot();
-void drawBody();
-void drawHead();
-void drawLowerBody();
-void drawLeftArm();
-void drawRightArm();
+void recordRobot(const MATRIX4X4& view);
+void rasterizeDrawList();
+void gatherJointAngles(const RobotPose& pose, float* angles);
+void submitDrawList();
+void drawRobotGroup(int group);
+void updateStatsTitle();
+void setCrowdSize(int count);
+void startSimulation();
+void requestRedisplay();
+void redisplayTimer(int value);
+void simulationStep();
+void advanceSimulation();
+void snapRenderState();
+double elapsedSeconds();
+bool writeProfile(const char* tracePath);
+int runHeadless(int numFrames, int width, int height, int crowdSize, const char* imagePath, bool software,
+	const char* tracePath);
 
 int main(int argc, char** argv)
 {
+	// --headless FRAMES [--size WxH] [--crowd N] [--image FILE.ppm] [--software]
+	// [--trace FILE.json] renders offscreen and exits. --threads N sets the worker
+	// threads, --software also starts the window with the software renderer.
+	int headlessFrames = 0;
+	int headlessWidth = vWidth, headlessHeight = vHeight;
+	int headlessCrowd = 1;
+	const char* headlessImage = NULL;
+	bool software = false;
+	const char* tracePath = NULL;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--headless") == 0 && i + 1 < argc)
+			headlessFrames = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc)
+			sscanf(argv[++i], "%dx%d", &headlessWidth, &headlessHeight);
+		else if (strcmp(argv[i], "--crowd") == 0 && i + 1 < argc)
+			headlessCrowd = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--image") == 0 && i + 1 < argc)
+			headlessImage = argv[++i];
+		else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+			numThreads = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--software") == 0)
+			software = true;
+		else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+			tracePath = argv[++i];
+	}
+	if (headlessFrames > 0)
+		return runHeadless(headlessFrames, headlessWidth, headlessHeight, headlessCrowd, headlessImage, software, tracePath);
+	softwareRendering = software;
+
 	// Initialize GLUT
 	glutInit(&argc, argv);
 	glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB | GLUT_DEPTH);
@@ -181,6 +248,8 @@ void initOpenGL(int w, int h)
 	glLightfv(GL_LIGHT0, GL_POSITION, light_position0);
 	glLightfv(GL_LIGHT1, GL_POSITION, light_position1);
 
+	glLightModelfv(GL_LIGHT_MODEL_AMBIENT, light_model_ambient);
+
 	glEnable(GL_LIGHTING);
 	glEnable(GL_LIGHT0);
 	glEnable(GL_LIGHT1);   // This second light is currently off
@@ -188,7 +257,7 @@ void initOpenGL(int w, int h)
 	// Other OpenGL setup
 	glEnable(GL_DEPTH_TEST);   // Remove hidded surfaces
 	glShadeModel(GL_SMOOTH);   // Use smooth shading, makes boundaries between polygons harder to see
-	glClearColor(0.4F, 0.4F, 0.4F, 0.0F);  // Color and depth for glClear
+	glClearColor(clear_color[0], clear_color[1], clear_color[2], clear_color[3]);  // Color and depth for glClear
 	glClearDepth(1.0f);
 	glEnable(GL_NORMALIZE);    // Renormalize normal vectors
 	glHint(GL_PERSPECTIVE_CORRECTION_HINT, GL_NICEST);   // Nicer perspective
@@ -196,661 +265,315 @@ void initOpenGL(int w, int h)
 	glMatrixMode(GL_MODELVIEW);
 	glLoadIdentity();
 
+	initScene();
+}
 
-	// Other initializatuion
-	// Set up ground quad mesh
-	VECTOR3D origin = VECTOR3D(-16.0f, 0.0f, 16.0f);
-	VECTOR3D dir1v = VECTOR3D(1.0f, 0.0f, 0.0f);
-	VECTOR3D dir2v = VECTOR3D(0.0f, 0.0f, -1.0f);
-	groundMesh = new QuadMesh(meshSize, 32.0);
-	groundMesh->InitMesh(meshSize, origin, 32.0, 32.0, dir1v, dir2v);
+// Everything drawn, shared by the GL and the software renderer. Makes no GL calls.
+void initScene()
+{
+	// The software renderer lights with the same values, the positions were
+	// given with an identity modelview so they are in eye space
+	const GLfloat* lightPositions[2] = { light_position0, light_position1 };
+	for (int i = 0; i < 2; i++) {
+		rasterLights[i].position.Set(lightPositions[i][0], lightPositions[i][1], lightPositions[i][2]);
+		for (int c = 0; c < 3; c++) {
+			rasterLights[i].ambient[c] = light_ambient[c];
+			rasterLights[i].diffuse[c] = light_diffuse[c];
+			rasterLights[i].specular[c] = light_specular[c];
+		}
+	}
 
-	VECTOR3D ambient = VECTOR3D(0.0f, 0.05f, 0.0f);
-	VECTOR3D diffuse = VECTOR3D(0.4f, 0.8f, 0.4f);
-	VECTOR3D specular = VECTOR3D(0.04f, 0.04f, 0.04f);
-	float shininess = 0.2;
-	groundMesh->SetMaterial(ambient, diffuse, specular, shininess);
+	// Set up ground terrain centered under the robot (lowered to -25)
+	VECTOR3D groundCenter = VECTOR3D(0.0f, -25.0f, 0.0f);
+	groundTerrain = new Terrain(groundCenter, groundSize, meshSize, groundMaxDepth);
+
+	GLfloat ground_ambient[] = { 0.0f, 0.05f, 0.0f, 1.0f };
+	GLfloat ground_diffuse[] = { 0.4f, 0.8f, 0.4f, 1.0f };
+	GLfloat ground_specular[] = { 0.04f, 0.04f, 0.04f, 1.0f };
+	groundMaterialID = materials.Register(ground_ambient, ground_diffuse, ground_specular, 0.2f);
+	groundTerrain->UseMaterial(&materials, groundMaterialID);
+
+	// Set up the robot hierarchy and the geometry its parts are drawn with
+	BuildRobotGraph(robotGraph, robotSocketNodes);
+	robotInstance.Init(&robotGraph);
+	RegisterRobotMaterials(materials, robotMaterialIDs);
+	primitiveMeshes[PRIMITIVE_CUBE] = primitiveCache.GetCube();
+	primitiveMeshes[PRIMITIVE_BARREL] = primitiveCache.GetCylinder(40, 20);
+	bakedRobot.Build(robotGraph, primitiveMeshes);
+
+	jobs = new JobSystem(numThreads);
+	rasterizer.SetJobSystem(jobs);
+	crowdMeshes[PRIMITIVE_CUBE] = primitiveMeshes[PRIMITIVE_CUBE];
+	crowdMeshes[PRIMITIVE_BARREL] = primitiveCache.GetCylinder(12, 1);
+	crowd.Init(&robotGraph, &materials, robotMaterialIDs, crowdMeshes, primitiveBounds);
+	setCrowdSize(1);
+}
 
+// Resizes the crowd and lays it out on a square grid around robots[0]. New
+// robots face their own way and start the walk cycle at their own phase.
+void setCrowdSize(int count)
+{
+	int oldCount = (int)robots.size();
+	int side = (int)ceil(sqrt((double)count));
+	int center = (side / 2) * side + side / 2;  // grid cell robots[0] stands in
+
+	robots.resize(count);
+	for (int i = oldCount; i < count; i++) {
+		InitRobotPose(robots[i]);
+		if (i == 0)
+			continue;
+		robots[i].heading = (float)(rand() % 360);
+		robots[i].walkOffset = (rand() % 50) * 0.01f;
+	}
+	for (int i = 1; i < count; i++) {
+		int cell = i - 1 < center ? i - 1 : i;
+		robots[i].position.Set((cell % side - side / 2) * crowdSpacing, 0.0, (cell / side - side / 2) * crowdSpacing);
+	}
 }
 
 void display(void)
 {
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-	glLoadIdentity();
+	std::chrono::steady_clock::time_point frameStart = std::chrono::steady_clock::now();
+	PROFILE_BEGIN_FRAME();
+
+	// Any redisplay requested from here on is for the next frame
+	redisplayPosted = false;
+	lastFrameTime = elapsedSeconds();
+	framesDrawn++;
 
 	// Change camera position based on selected view
+	VECTOR3D eye, up;
+	getCameraView(eye, up);
+
+	// Bring the animation up to date before drawing any of it
+	advanceSimulation();
+
+	if (softwareRendering)
+		drawSceneSoftware(eye, up);
+	else
+		drawScene(eye, up);
+
+	if (showStats) {
+		// Wait for GL so the frame time covers drawing as well as submission
+		if (!softwareRendering)
+			glFinish();
+		frameMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+		updateStatsTitle();
+	}
+
+	if (!headless) {
+		PROFILE_SCOPE("glutSwapBuffers");
+		glutSwapBuffers();   // Double buffering, swap buffers
+	}
+
+	numRedisplayRequests = 0;
+	if (simulationRunning)
+		requestRedisplay();  // Keep animating
+	PROFILE_END_FRAME();
+}
+
+// Camera position for the selected view, always looking at the origin
+void getCameraView(VECTOR3D& eye, VECTOR3D& up)
+{
+	up.Set(0.0, 1.0, 0.0);
 	switch (cameraView) {
 	case 0: // Default (isometric view)
-		gluLookAt(35.0, 20.0, 35.0, 0.0, 0.0, 0.0, 0.0, 1.0, 0.0);
+		eye.Set(35.0, 20.0, 35.0);
 		break;
 	case 1: // Front view
-		gluLookAt(0.0, 15.0, 50.0, 0.0, 0.0, 0.0, 0.0, 1.0, 0.0);
+		eye.Set(0.0, 15.0, 50.0);
 		break;
 	case 2: // Side view
-		gluLookAt(50.0, 15.0, 0.0, 0.0, 0.0, 0.0, 0.0, 1.0, 0.0);
+		eye.Set(50.0, 15.0, 0.0);
 		break;
 	case 3: // Top-down view
-		gluLookAt(0.0, 50.0, 0.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0);
+		eye.Set(0.0, 50.0, 0.0);
+		up.Set(1.0, 0.0, 0.0);
 		break;
 	}
-
-	// Draw Robot
-	drawRobot();
-
-	// Draw ground (lowered further)
-	glPushMatrix();
-	glTranslatef(0.0, -25.0, 0.0);  // Lowered the ground to -30.0
-	groundMesh->DrawMesh(meshSize);
-	glPopMatrix();
-
-	glutSwapBuffers();   // Double buffering, swap buffers
 }
 
-
-void drawRobot()
+void drawScene(const VECTOR3D& eye, const VECTOR3D& up)
 {
-	// 1. Draw the lower body (green part and legs) separately with no rotation
-	glPushMatrix();  // Save current matrix state
-	drawLowerBody();  // Draw the lower body first without any transformations
-	glPopMatrix();  // Restore the matrix
+	PROFILE_SCOPE("drawScene");
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	glLoadIdentity();
+	gluLookAt(eye.x, eye.y, eye.z, 0.0, 0.0, 0.0, up.x, up.y, up.z);
 
-	// 2. Draw the upper body with rotation
-	glPushMatrix();  // Save current matrix state
+	// Planes for this frame's culling
+	eyeFrustum.ExtractFromGL(false);
+	worldFrustum.ExtractFromGL(true);
+	eyeFrustum.ResetStats();
+	worldFrustum.ResetStats();
+	materials.ResetStats();
 
-	// Rotate only the upper body parts
-	glRotatef(robotAngle, 0.0, 1.0, 0.0);  // Apply rotation for the upper body
+	// Draw Robot
+	drawRobot();
 
-	// Draw the upper body components: torso, head, arms
-	drawBody();      // Beige, black parts (upper torso)
-	drawHead();      // Head
-	drawLeftArm();   // Left arm
-	drawRightArm();  // Right arm
+	// Draw the rest of the crowd, if any, in world space. The worker threads
+	// pose the robots, this thread only submits the finished vertex arrays.
+	int crowdCount = (int)robots.size() - 1;
+	crowd.Update(crowdCount > 0 ? &renderRobots[1] : NULL, crowdCount, &worldFrustum, jobs);
+	crowd.Draw();
 
-	glPopMatrix();  // End upper body rotation, restore the matrix
+	// Draw ground, chunk detail follows the camera
+	groundTerrain->Update(eye);
+	groundTerrain->Draw(&worldFrustum);
 }
 
-void drawBody()
+// drawScene() on the CPU. The matrices GL would build are built with MATRIX4X4
+// and the same parts, crowd and ground chunks are handed to the rasterizer,
+// which shades the screen tiles on the worker threads.
+void drawSceneSoftware(const VECTOR3D& eye, const VECTOR3D& up)
 {
-	// Top Part (Beige, wide)
-	glPushMatrix();
-	// Set material properties for the beige top part
-	glMaterialfv(GL_FRONT, GL_AMBIENT, beige_mat_ambient);
-	glMaterialfv(GL_FRONT, GL_SPECULAR, beige_mat_specular);
-	glMaterialfv(GL_FRONT, GL_DIFFUSE, beige_mat_diffuse);
-	glMaterialfv(GL_FRONT, GL_SHININESS, beige_mat_shininess);
-
-	// Position and scale the top part
-	glTranslatef(0.0, 0.5 * robotBodyLength, 0.0);  // Top part is at the top
-	glScalef(robotBodyWidth, robotBodyLength / 3.0, robotBodyDepth);  // Wide part, 1/3 of total height
-	glutSolidCube(1.0);
-	glPopMatrix();
-
-	// Middle Part (Black, thin and long)
-	glPushMatrix();
-	// Set material properties for the black middle part
-	glMaterialfv(GL_FRONT, GL_AMBIENT, dark_grey_ambient);
-	glMaterialfv(GL_FRONT, GL_SPECULAR, dark_grey_specular);
-	glMaterialfv(GL_FRONT, GL_DIFFUSE, dark_grey_diffuse);
-	glMaterialfv(GL_FRONT, GL_SHININESS, dark_grey_shininess);
-
-	// Position and scale the middle part
-	glTranslatef(0.0, 0.0, 0.0);  // Middle part stays in the center
-	glScalef(0.4 * robotBodyWidth, robotBodyLength / 2.0, 0.4 * robotBodyDepth);  // Thin and long part
-	glutSolidCube(1.0);
-	glPopMatrix();
-
-	// No longer drawing the green bottom part here; it will now be drawn as part of the lower body.
+	PROFILE_SCOPE("drawSceneSoftware");
+	MATRIX4X4 view, projection;
+
+	view.SetLookAt(eye, VECTOR3D(0.0, 0.0, 0.0), up);
+	projection.SetPerspective(60.0, (double)rasterizer.GetWidth() / rasterizer.GetHeight(), 0.2, farPlane);
+	rasterizer.SetProjection(projection);
+	rasterizer.SetLights(rasterLights, 2, light_model_ambient);
+	rasterizer.Clear(clear_color[0], clear_color[1], clear_color[2]);
+
+	eyeFrustum.Extract(projection);
+	worldFrustum.Extract(projection * view);
+	eyeFrustum.ResetStats();
+	worldFrustum.ResetStats();
+	materials.ResetStats();
+
+	recordRobot(view);
+	rasterizeDrawList();
+
+	int crowdCount = (int)robots.size() - 1;
+	crowd.Update(crowdCount > 0 ? &renderRobots[1] : NULL, crowdCount, &worldFrustum, jobs);
+	crowd.Rasterize(rasterizer, view);
+
+	groundTerrain->Update(eye);
+	groundTerrain->Rasterize(rasterizer, view, &worldFrustum);
+
+	rasterizer.Finish();
+	if (!headless)
+		presentSoftwareImage();
 }
 
-void drawHead()
+// Copies the rasterizer's pixels to the window, covering the whole viewport
+void presentSoftwareImage()
 {
-	// Set robot material properties for the head (white part)
-	GLfloat white_ambient[] = { 1.0f, 1.0f, 1.0f, 1.0f };
-	GLfloat white_diffuse[] = { 1.0f, 1.0f, 1.0f, 1.0f };
-	GLfloat white_specular[] = { 0.5f, 0.5f, 0.5f, 1.0f };
-	GLfloat white_shininess[] = { 50.0f };
-
-	GLfloat cyan_ambient[] = { 0.0f, 1.0f, 1.0f, 1.0f };
-	GLfloat cyan_diffuse[] = { 0.0f, 1.0f, 1.0f, 1.0f };
-	GLfloat cyan_specular[] = { 0.1f, 0.1f, 0.1f, 1.0f };
-	GLfloat cyan_shininess[] = { 30.0f };
-
-	glMaterialfv(GL_FRONT, GL_AMBIENT, dark_grey_ambient);
-	glMaterialfv(GL_FRONT, GL_SPECULAR, dark_grey_specular);
-	glMaterialfv(GL_FRONT, GL_DIFFUSE, dark_grey_diffuse);
-	glMaterialfv(GL_FRONT, GL_SHININESS, dark_grey_shininess);
-
-	glPushMatrix();
-	// Apply neck rotation
-	glRotatef(neckAngle, 0.0, 1.0, 0.0);  // Rotate neck along Y-axis
-	glTranslatef(0, 0.5 * robotBodyLength + 1.0 * headLength, 0); // Move head above the body
-
-	// Draw the head (white part)
-	glPushMatrix();
-	glMaterialfv(GL_FRONT, GL_AMBIENT, white_ambient);
-	glMaterialfv(GL_FRONT, GL_DIFFUSE, white_diffuse);
-	glMaterialfv(GL_FRONT, GL_SPECULAR, white_specular);
-	glMaterialfv(GL_FRONT, GL_SHININESS, white_shininess);
-
-	glScalef(0.4 * robotBodyWidth, 0.4 * robotBodyWidth, 0.4 * robotBodyWidth);
-	glutSolidCube(1.0);
-	glPopMatrix();
-
-	glMaterialfv(GL_FRONT, GL_AMBIENT, green_mat_ambient);
-	glMaterialfv(GL_FRONT, GL_DIFFUSE, green_mat_diffuse);
-	glMaterialfv(GL_FRONT, GL_SPECULAR, green_mat_specular);
-	glMaterialfv(GL_FRONT, GL_SHININESS, green_mat_shininess);
-
-	// Draw left side of the head
-	glPushMatrix();
-	glTranslatef(-0.2 * robotBodyWidth, 0, 0);  // Move to left
-	glScalef(0.01 * robotBodyWidth, 0.4 * robotBodyWidth, 0.4 * robotBodyWidth);
-	glutSolidCube(1.0);
-	glPopMatrix();
-
-	// Draw right side of the head
+	PROFILE_SCOPE("presentSoftwareImage");
+	glMatrixMode(GL_PROJECTION);
 	glPushMatrix();
-	glTranslatef(0.2 * robotBodyWidth, 0, 0);  // Move to right
-	glScalef(0.01 * robotBodyWidth, 0.4 * robotBodyWidth, 0.4 * robotBodyWidth);
-	glutSolidCube(1.0);
-	glPopMatrix();
+	glLoadIdentity();
+	glMatrixMode(GL_MODELVIEW);
+	glLoadIdentity();
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_LIGHTING);
 
-	// Grey stripe positioned just behind the blue and in front of the white, move very slightly down
-	glMaterialfv(GL_FRONT, GL_AMBIENT, dark_grey_ambient);
-	glMaterialfv(GL_FRONT, GL_DIFFUSE, dark_grey_diffuse);
-	glMaterialfv(GL_FRONT, GL_SPECULAR, dark_grey_specular);
-	glMaterialfv(GL_FRONT, GL_SHININESS, dark_grey_shininess);
+	glRasterPos2f(-1.0f, -1.0f);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glDrawPixels(rasterizer.GetWidth(), rasterizer.GetHeight(), GL_RGBA, GL_UNSIGNED_BYTE, rasterizer.GetPixels());
 
-	// Move the front grey part very slightly down
-	glPushMatrix();
-	glTranslatef(0.0, 0.06 * robotBodyWidth, 0.20 * robotBodyWidth);  // Very slight downward adjustment
-	glScalef(0.12 * robotBodyWidth, 0.3 * robotBodyWidth, 0.03 * robotBodyWidth);  // Taller and wider
-	glutSolidCube(1.0);
+	glEnable(GL_LIGHTING);
+	glEnable(GL_DEPTH_TEST);
+	glMatrixMode(GL_PROJECTION);
 	glPopMatrix();
+	glMatrixMode(GL_MODELVIEW);
+}
 
-	// Add grey part to the top of the head
-	glPushMatrix();
-	glTranslatef(0.0, 0.2 * robotBodyWidth, 0.01 * robotBodyWidth);  // Small forward adjustment
-	glScalef(0.12 * robotBodyWidth, 0.02 * robotBodyWidth, 0.42 * robotBodyWidth);  // Long and thin grey stripe on top
-	glutSolidCube(1.0);
-	glPopMatrix();
 
-	// Blue eye (upright visor-like stripe)
-	glPushMatrix();
-	glMaterialfv(GL_FRONT, GL_AMBIENT, cyan_ambient);
-	glMaterialfv(GL_FRONT, GL_DIFFUSE, cyan_diffuse);
-	glMaterialfv(GL_FRONT, GL_SPECULAR, cyan_specular);
-	glMaterialfv(GL_FRONT, GL_SHININESS, cyan_shininess);
-
-	// Position the blue visor/eye on the front
-	glTranslatef(0.0, 0.1 * robotBodyWidth, 0.22 * robotBodyWidth);  // Position it on the front
-	glScalef(0.05 * robotBodyWidth, 0.2 * robotBodyWidth, 0.02 * robotBodyWidth);  // Flip dimensions to make it upright
-	glutSolidCube(1.0); // Blue eye
-	glPopMatrix();
+void drawRobot()
+{
+	PROFILE_SCOPE("drawRobot");
+	MATRIX4X4 view;
 
-	glPopMatrix();  // End head drawing
+	glGetFloatv(GL_MODELVIEW_MATRIX, view);
+	recordRobot(view);
+	submitDrawList();
+	glLoadMatrixf(view);
 }
 
-void drawLowerBody()
+// Poses robots[0] and records its visible part groups in drawList
+void recordRobot(const MATRIX4X4& view)
 {
-	// Lower body green section (stationary part)
-	glPushMatrix();
-	glMaterialfv(GL_FRONT, GL_AMBIENT, green_mat_ambient);
-	glMaterialfv(GL_FRONT, GL_SPECULAR, green_mat_specular);
-	glMaterialfv(GL_FRONT, GL_DIFFUSE, green_mat_diffuse);
-	glMaterialfv(GL_FRONT, GL_SHININESS, green_mat_shininess);
-
-	// Position the green section (between the legs) under the upper body but not affected by rotation
-	glTranslatef(0.0, -0.5 * robotBodyLength, 0.0);  // Move to where the green section is positioned
-	glScalef(0.8 * robotBodyWidth, robotBodyLength / 3.0, 0.8 * robotBodyDepth);  // Scale to match the body proportions
-	glutSolidCube(1.0);  // Draw the green section (stationary)
-	glPopMatrix();
-
-	// Left leg
-	glPushMatrix();
-	// Move the leg lower to connect better to the body
-	glTranslatef(0.5 * robotBodyWidth, -0.7 * robotBodyLength, 0.0); // Adjust leg height
-
-	// Hip rotation for walking
-	glRotatef(hipAngleLeft, 1.0, 0.0, 0.0); // Rotate hip joint
-
-	// Upper leg segment - beige
-	glPushMatrix();
-	glMaterialfv(GL_FRONT, GL_AMBIENT, beige_mat_ambient);
-	glMaterialfv(GL_FRONT, GL_SPECULAR, beige_mat_specular);
-	glMaterialfv(GL_FRONT, GL_DIFFUSE, beige_mat_diffuse);
-	glMaterialfv(GL_FRONT, GL_SHININESS, beige_mat_shininess);
-
-	// Rotate and scale the upper leg
-	glRotatef(-15, 1.0, 0.0, 0.0); // Slight rotation for a zig-zag pose
-	glScalef(0.2 * robotBodyWidth, 0.5 * robotBodyLength, 0.2 * robotBodyDepth);
-	glutSolidCube(1.0);
-	glPopMatrix(); // End upper leg segment
-
-	// Add kneecap before moving down for the lower leg
-	glPushMatrix();
-	glMaterialfv(GL_FRONT, GL_AMBIENT, light_brown_mat_ambient);
-	glMaterialfv(GL_FRONT, GL_SPECULAR, light_brown_mat_specular);
-	glMaterialfv(GL_FRONT, GL_DIFFUSE, light_brown_mat_diffuse);
-	glMaterialfv(GL_FRONT, GL_SHININESS, light_brown_mat_shininess);
-
-	// Adjust kneecap placement (slightly forward on the Z-axis)
-	glTranslatef(0.0, -0.25 * robotBodyLength, 0.10 * robotBodyDepth);  // Move kneecap forward slightly
-	glScalef(0.25 * robotBodyWidth, 0.1 * robotBodyLength, 0.25 * robotBodyDepth);  // Scale the kneecap
-	glutSolidCube(1.0);  // Draw kneecap
-	glPopMatrix();
-
-	// Move down for knee joint
-	glTranslatef(0.0, -0.5 * robotBodyLength, 0.0);
-	// Knee rotation
-	glRotatef(kneeAngleLeft, 1.0, 0.0, 0.0); // Rotate knee
-
-	// Lower leg segment - green
-	glPushMatrix();
-	glMaterialfv(GL_FRONT, GL_AMBIENT, green_mat_ambient);
-	glMaterialfv(GL_FRONT, GL_SPECULAR, green_mat_specular);
-	glMaterialfv(GL_FRONT, GL_DIFFUSE, green_mat_diffuse);
-	glMaterialfv(GL_FRONT, GL_SHININESS, green_mat_shininess);
-
-	glRotatef(15, 1.0, 0.0, 0.0); // Rotate to maintain zig-zag pose
-	glScalef(0.2 * robotBodyWidth, 0.5 * robotBodyLength, 0.2 * robotBodyDepth);
-	glutSolidCube(1.0);
-	glPopMatrix(); // End lower leg segment
-
-	// New kneecap between the two green parts
-	glPushMatrix();
-	glMaterialfv(GL_FRONT, GL_AMBIENT, light_brown_mat_ambient);
-	glMaterialfv(GL_FRONT, GL_SPECULAR, light_brown_mat_specular);
-	glMaterialfv(GL_FRONT, GL_DIFFUSE, light_brown_mat_diffuse);
-	glMaterialfv(GL_FRONT, GL_SHININESS, light_brown_mat_shininess);
-
-	// Translate to position the kneecap between the two green parts
-	glTranslatef(0.0, -0.25 * robotBodyLength, 0.0); // Adjust based on the spacing between the two green parts
-	glScalef(0.25 * robotBodyWidth, 0.1 * robotBodyLength, 0.25 * robotBodyDepth);
-	glutSolidCube(1.0);
-	glPopMatrix();
-
-	// Move down for the second (third part) green leg
-	glTranslatef(0.0, -0.5 * robotBodyLength, 0.0);
-	// Lower leg rotation
-	glRotatef(lowerLegAngleLeft, 1.0, 0.0, 0.0);
-
-	// Second green part - same size as the previous green part
-	glPushMatrix();
-	glMaterialfv(GL_FRONT, GL_AMBIENT, green_mat_ambient);
-	glMaterialfv(GL_FRONT, GL_SPECULAR, green_mat_specular);
-	glMaterialfv(GL_FRONT, GL_DIFFUSE, green_mat_diffuse);
-	glMaterialfv(GL_FRONT, GL_SHININESS, green_mat_shininess);
-
-	glRotatef(-15, 1.0, 0.0, 0.0); // Continue zig-zag pose
-	glScalef(0.2 * robotBodyWidth, 0.5 * robotBodyLength, 0.2 * robotBodyDepth);
-	glutSolidCube(1.0);
-	glPopMatrix(); // End second green part
-
-	// Move down for ankle (adjusted to move feet up)
-	glTranslatef(0.0, -0.3 * robotBodyLength, 0.0);  // Reduced from -0.5 to -0.3 for closer connection
-
-	// Ankle rotation
-	glRotatef(ankleAngleLeft, 1.0, 0.0, 0.0); // Rotate ankle
-
-	// Foot segment - light brown
-	glPushMatrix();
-	glMaterialfv(GL_FRONT, GL_AMBIENT, light_brown_mat_ambient);
-	glMaterialfv(GL_FRONT, GL_SPECULAR, light_brown_mat_specular);
-	glMaterialfv(GL_FRONT, GL_DIFFUSE, light_brown_mat_diffuse);
-	glMaterialfv(GL_FRONT, GL_SHININESS, light_brown_mat_shininess);
-
-	// Foot base
-	glPushMatrix();
-	glScalef(0.4 * robotBodyDepth, 0.1 * robotBodyLength, 0.6 * robotBodyWidth); // Foot dimensions
-	glutSolidCube(1.0);
-	glPopMatrix(); // End foot base
-
-	// Add two dents in front of the foot
-	// First front dent
-	glPushMatrix();
-	glTranslatef(-0.15 * robotBodyDepth, 0.0, 0.4 * robotBodyWidth); // Move to the front-left
-	glScalef(0.1 * robotBodyDepth, 0.1 * robotBodyLength, 0.2 * robotBodyWidth); // Small cube for the dent
-	glutSolidCube(1.0);
-	glPopMatrix();
-
-	// Second front dent
-	glPushMatrix();
-	glTranslatef(0.15 * robotBodyDepth, 0.0, 0.4 * robotBodyWidth); // Move to the front-right
-	glScalef(0.1 * robotBodyDepth, 0.1 * robotBodyLength, 0.2 * robotBodyWidth); // Small cube for the dent
-	glutSolidCube(1.0);
-	glPopMatrix();
-
-	// Add two dents in back of the foot
-	// First back dent
-	glPushMatrix();
-	glTranslatef(-0.15 * robotBodyDepth, 0.0, -0.4 * robotBodyWidth); // Move to the back-left
-	glScalef(0.1 * robotBodyDepth, 0.1 * robotBodyLength, 0.2 * robotBodyWidth); // Small cube for the dent
-	glutSolidCube(1.0);
-	glPopMatrix();
-
-	// Second back dent
-	glPushMatrix();
-	glTranslatef(0.15 * robotBodyDepth, 0.0, -0.4 * robotBodyWidth); // Move to the back-right
-	glScalef(0.1 * robotBodyDepth, 0.1 * robotBodyLength, 0.2 * robotBodyWidth); // Small cube for the dent
-	glutSolidCube(1.0);
-	glPopMatrix();
-
-	glPopMatrix(); // End left foot
-
-	glPopMatrix(); // End left leg
-
-	// Right leg (copy of the left leg but mirrored)
-	glPushMatrix();
-	// Move the leg lower to connect better to the body
-	glTranslatef(-0.5 * robotBodyWidth, -0.7 * robotBodyLength, 0.0); // Adjust leg height
-
-	// Hip rotation
-	glRotatef(hipAngleRight, 1.0, 0.0, 0.0); // Rotate hip
-
-	// Upper leg segment - beige
-	glPushMatrix();
-	glMaterialfv(GL_FRONT, GL_AMBIENT, beige_mat_ambient);
-	glMaterialfv(GL_FRONT, GL_SPECULAR, beige_mat_specular);
-	glMaterialfv(GL_FRONT, GL_DIFFUSE, beige_mat_diffuse);
-	glMaterialfv(GL_FRONT, GL_SHININESS, beige_mat_shininess);
-
-	glRotatef(-15, 1.0, 0.0, 0.0); // Zig-zag pose
-	glScalef(0.2 * robotBodyWidth, 0.5 * robotBodyLength, 0.2 * robotBodyDepth);
-	glutSolidCube(1.0);
-	glPopMatrix(); // End upper leg segment
-
-	// Add kneecap
-	glPushMatrix();
-	glMaterialfv(GL_FRONT, GL_AMBIENT, light_brown_mat_ambient);
-	glMaterialfv(GL_FRONT, GL_SPECULAR, light_brown_mat_specular);
-	glMaterialfv(GL_FRONT, GL_DIFFUSE, light_brown_mat_diffuse);
-	glMaterialfv(GL_FRONT, GL_SHININESS, light_brown_mat_shininess);
-
-	// Adjust kneecap placement
-	glTranslatef(0.0, -0.25 * robotBodyLength, 0.10 * robotBodyDepth);  // Move kneecap forward
-	glScalef(0.25 * robotBodyWidth, 0.1 * robotBodyLength, 0.25 * robotBodyDepth);  // Adjust kneecap scale
-	glutSolidCube(1.0);
-	glPopMatrix();
-
-	// Move down for knee
-	glTranslatef(0.0, -0.5 * robotBodyLength, 0.0);
-	// Knee rotation
-	glRotatef(kneeAngleRight, 1.0, 0.0, 0.0); // Rotate knee
-
-	// Lower leg segment - green
-	glPushMatrix();
-	glMaterialfv(GL_FRONT, GL_AMBIENT, green_mat_ambient);
-	glMaterialfv(GL_FRONT, GL_SPECULAR, green_mat_specular);
-	glMaterialfv(GL_FRONT, GL_DIFFUSE, green_mat_diffuse);
-	glMaterialfv(GL_FRONT, GL_SHININESS, green_mat_shininess);
-
-	glRotatef(15, 1.0, 0.0, 0.0); // Zig-zag rotation
-	glScalef(0.2 * robotBodyWidth, 0.5 * robotBodyLength, 0.2 * robotBodyDepth);
-	glutSolidCube(1.0);
-	glPopMatrix(); // End lower leg segment
-
-	// New kneecap between the two green parts (right leg)
-	glPushMatrix();
-	glMaterialfv(GL_FRONT, GL_AMBIENT, light_brown_mat_ambient);
-	glMaterialfv(GL_FRONT, GL_SPECULAR, light_brown_mat_specular);
-	glMaterialfv(GL_FRONT, GL_DIFFUSE, light_brown_mat_diffuse);
-	glMaterialfv(GL_FRONT, GL_SHININESS, light_brown_mat_shininess);
-
-	glTranslatef(0.0, -0.25 * robotBodyLength, 0.0); // Adjust for kneecap position
-	glScalef(0.25 * robotBodyWidth, 0.1 * robotBodyLength, 0.25 * robotBodyDepth);
-	glutSolidCube(1.0);
-	glPopMatrix();
-
-	// Move down for the second green part (right leg)
-	glTranslatef(0.0, -0.5 * robotBodyLength, 0.0);
-	// Lower leg rotation
-	glRotatef(lowerLegAngleRight, 1.0, 0.0, 0.0);
-
-	// Second green part (right leg)
-	glPushMatrix();
-	glMaterialfv(GL_FRONT, GL_AMBIENT, green_mat_ambient);
-	glMaterialfv(GL_FRONT, GL_SPECULAR, green_mat_specular);
-	glMaterialfv(GL_FRONT, GL_DIFFUSE, green_mat_diffuse);
-	glMaterialfv(GL_FRONT, GL_SHININESS, green_mat_shininess);
-
-	glRotatef(-15, 1.0, 0.0, 0.0); // Continue zig-zag pose
-	glScalef(0.2 * robotBodyWidth, 0.5 * robotBodyLength, 0.2 * robotBodyDepth);
-	glutSolidCube(1.0);
-	glPopMatrix(); // End second green part
-
-	// Move down for ankle (adjusted to move feet up)
-	glTranslatef(0.0, -0.3 * robotBodyLength, 0.0);  // Reduced from -0.5 to -0.3 for closer connection
-
-	// Ankle rotation
-	glRotatef(ankleAngleRight, 1.0, 0.0, 0.0); // Rotate ankle
-
-	// Foot segment - light brown
-	glPushMatrix();
-	glMaterialfv(GL_FRONT, GL_AMBIENT, light_brown_mat_ambient);
-	glMaterialfv(GL_FRONT, GL_SPECULAR, light_brown_mat_specular);
-	glMaterialfv(GL_FRONT, GL_DIFFUSE, light_brown_mat_diffuse);
-	glMaterialfv(GL_FRONT, GL_SHININESS, light_brown_mat_shininess);
-
-	// Foot base
-	glPushMatrix();
-	glScalef(0.4 * robotBodyDepth, 0.1 * robotBodyLength, 0.6 * robotBodyWidth); // Foot dimensions
-	glutSolidCube(1.0);
-	glPopMatrix(); // End foot base
-
-	// Add two dents in front of the foot
-	// First front dent
-	glPushMatrix();
-	glTranslatef(-0.15 * robotBodyDepth, 0.0, 0.4 * robotBodyWidth); // Move to the front-left
-	glScalef(0.1 * robotBodyDepth, 0.1 * robotBodyLength, 0.2 * robotBodyWidth); // Small cube for the dent
-	glutSolidCube(1.0);
-	glPopMatrix();
-
-	// Second front dent
-	glPushMatrix();
-	glTranslatef(0.15 * robotBodyDepth, 0.0, 0.4 * robotBodyWidth); // Move to the front-right
-	glScalef(0.1 * robotBodyDepth, 0.1 * robotBodyLength, 0.2 * robotBodyWidth); // Small cube for the dent
-	glutSolidCube(1.0);
-	glPopMatrix();
-
-	// Add two dents in back of the foot
-	// First back dent
-	glPushMatrix();
-	glTranslatef(-0.15 * robotBodyDepth, 0.0, -0.4 * robotBodyWidth); // Move to the back-left
-	glScalef(0.1 * robotBodyDepth, 0.1 * robotBodyLength, 0.2 * robotBodyWidth); // Small cube for the dent
-	glutSolidCube(1.0);
-	glPopMatrix();
-
-	// Second back dent
-	glPushMatrix();
-	glTranslatef(0.15 * robotBodyDepth, 0.0, -0.4 * robotBodyWidth); // Move to the back-right
-	glScalef(0.1 * robotBodyDepth, 0.1 * robotBodyLength, 0.2 * robotBodyWidth); // Small cube for the dent
-	glutSolidCube(1.0);
-	glPopMatrix();
-
-	glPopMatrix(); // End right foot
+	PROFILE_SCOPE("recordRobot");
+	MATRIX4X4 modelview;
+	BBox eyeBounds;
+
+	// One pass over the flattened hierarchy brings the parts under joints that moved up to date
+	gatherJointAngles(renderRobots[0], jointAngles);
+	robotInstance.SetJointAngles(jointAngles);
+	robotInstance.Update();
+
+	drawList.Clear();
+	for (int g = 0; g < bakedRobot.GetNumGroups(); g++) {
+		int node = bakedRobot.GetGroupNode(g);
+
+		// Skip groups whose bounds end up outside the view frustum
+		modelview = node >= 0 ? view * robotInstance.GetWorldMatrix(node) : view;
+		TransformBounds(modelview, bakedRobot.GetGroupBounds(g), eyeBounds);
+		if (!eyeFrustum.IsBoxVisible(eyeBounds))
+			continue;
+
+		drawList.Add(modelview, robotMaterialIDs[bakedRobot.GetGroupMaterial(g)], g);
+	}
 
-	glPopMatrix(); // End right leg
+	if (sortDrawList)
+		drawList.Sort();
 }
 
-void drawLeftArm()
+// Copies a pose's joint angles into the array the robot graph is posed with
+void gatherJointAngles(const RobotPose& pose, float* angles)
 {
-	// Set the material for the arm (green)
-	glMaterialfv(GL_FRONT, GL_AMBIENT, green_mat_ambient);
-	glMaterialfv(GL_FRONT, GL_SPECULAR, green_mat_specular);
-	glMaterialfv(GL_FRONT, GL_DIFFUSE, green_mat_diffuse);
-	glMaterialfv(GL_FRONT, GL_SHININESS, green_mat_shininess);
-
-	glPushMatrix();
-	// Position upper arm higher to connect with the body
-	glTranslatef(0.5 * robotBodyWidth + 0.5 * upperArmWidth, 0.3 * robotBodyLength, 0.0); // Adjusted Y position to connect with body
-
-	// Draw upper arm (green part)
-	glPushMatrix();
-	glScalef(upperArmWidth, 0.6 * upperArmLength, upperArmWidth); // Upper part is shorter
-	glutSolidCube(1.0);
-	glPopMatrix();
-
-	// Add the elbow joint (grey part)
-	glPushMatrix();
-	glMaterialfv(GL_FRONT, GL_AMBIENT, dark_grey_ambient);
-	glMaterialfv(GL_FRONT, GL_SPECULAR, dark_grey_specular);
-	glMaterialfv(GL_FRONT, GL_DIFFUSE, dark_grey_diffuse);
-	glMaterialfv(GL_FRONT, GL_SHININESS, dark_grey_shininess);
-
-	// Position and scale the elbow
-	glTranslatef(0.0, -0.5 * 0.6 * upperArmLength, 0.0); // Adjust based on upper arm length
-	glScalef(1.2 * upperArmWidth, 0.1 * upperArmLength, 1.2 * upperArmWidth); // Slightly larger elbow joint
-	glutSolidCube(1.0);  // Draw elbow
-	glPopMatrix();
-
-	// Move down for the lower arm and translate further forward along Z-axis
-	glTranslatef(0.0, -0.9 * 0.6 * upperArmLength, 1.1); // Slightly increased forward translation along the Z-axis
-
-	// Apply rotation to the lower arm for an angled effect
-	glRotatef(-30.0, 1.0, 0.0, 0.0); // Rotate around the X-axis to make the lower arm angled
-
-	// Draw lower arm (green part)
-	glPushMatrix();
-	glMaterialfv(GL_FRONT, GL_AMBIENT, green_mat_ambient);  // Set back to green for the lower arm
-	glMaterialfv(GL_FRONT, GL_SPECULAR, green_mat_specular);
-	glMaterialfv(GL_FRONT, GL_DIFFUSE, green_mat_diffuse);
-	glMaterialfv(GL_FRONT, GL_SHININESS, green_mat_shininess);
-
-	glScalef(upperArmWidth, 0.6 * upperArmLength, upperArmWidth); // Lower part is also shorter
-	glutSolidCube(1.0);
-	glPopMatrix();
-
-	// Now draw the hand
-	glMaterialfv(GL_FRONT, GL_AMBIENT, dark_grey_ambient);
-	glMaterialfv(GL_FRONT, GL_SPECULAR, dark_grey_specular);
-	glMaterialfv(GL_FRONT, GL_DIFFUSE, dark_grey_diffuse);
-	glMaterialfv(GL_FRONT, GL_SHININESS, dark_grey_shininess);
+	for (int i = 0; i < NUM_ROBOT_JOINTS; i++)
+		angles[i] = pose.joints[i];
+	if (!spinCannon)
+		angles[JOINT_CANNON] = 0.0f;  // Only spins while the cannon is on
+}
 
-	// Position the hand slightly above and more inside the lower arm
-	glPushMatrix();
-	glTranslatef(0.0, -0.35 * 0.6 * upperArmLength - 0.15, 0.0);  // Adjusted Y position to bring the hand inside the lower arm
-	glScalef(0.7 * upperArmWidth, 0.5 * upperArmLength, 0.7 * upperArmWidth);  // Scale for the hand
-	glutSolidCube(1.0);  // Hand (palm)
-
-	// Add the fingers
-	float fingerWidth = 0.06 * upperArmWidth; // Thicker fingers
-	float fingerLength = 0.05 * upperArmLength; // Shorter length for fingers
-
-	// Draw 5 fingers
-	for (int i = -2; i <= 2; i++) {
-		glPushMatrix();
-		glTranslatef(i * (0.12 * upperArmWidth), -0.2 * (0.3 * upperArmLength), 0.0);  // Move fingers up
-		glScalef(fingerWidth, fingerLength, fingerWidth);  // Scale fingers to thicker and shorter size
-		glutSolidCube(1.0);
-		glPopMatrix();
+void submitDrawList()
+{
+	PROFILE_SCOPE("submitDrawList");
+	for (int i = 0; i < drawList.GetNumItems(); i++) {
+		const DrawItem& item = drawList.GetItem(i);
+
+		glLoadMatrixf(item.matrix);
+		PROFILE_COUNT(COUNTER_GL_CALLS, 1);
+		materials.Bind(item.material);
+		drawRobotGroup(item.mesh);
 	}
-
-	glPopMatrix();  // End of hand
-	glPopMatrix();  // End of arm
 }
 
-void drawRightArm()
+void drawRobotGroup(int group)
 {
-	// Set material properties for the arm (green)
-	glMaterialfv(GL_FRONT, GL_AMBIENT, green_mat_ambient);
-	glMaterialfv(GL_FRONT, GL_SPECULAR, green_mat_specular);
-	glMaterialfv(GL_FRONT, GL_DIFFUSE, green_mat_diffuse);
-	glMaterialfv(GL_FRONT, GL_SHININESS, green_mat_shininess);
-
-
-	glPushMatrix();
-
-	// Adjust translation to mirror the left arm, move it up and forward slightly
-	glTranslatef(-(0.5 * robotBodyWidth + 0.5 * upperArmWidth), 0.3 * robotBodyLength, 0.2 * robotBodyDepth); // Adjust Y-value for correct height
-
-	glRotatef(-45.0, 1.0, 0.0, 0.0); // Tilt arm forward
-
-	// Draw upper arm (green part)
-	glPushMatrix();
-	glScalef(upperArmWidth, 0.6 * upperArmLength, upperArmWidth); // Upper part is shorter
-	glutSolidCube(1.0);
-	glPopMatrix();
-
-	// Add the brown elbow joint
-	glPushMatrix();
-	glMaterialfv(GL_FRONT, GL_AMBIENT, dark_grey_ambient);
-	glMaterialfv(GL_FRONT, GL_SPECULAR, dark_grey_specular);
-	glMaterialfv(GL_FRONT, GL_DIFFUSE, dark_grey_diffuse);
-	glMaterialfv(GL_FRONT, GL_SHININESS, dark_grey_shininess);
-
-	// Position and scale the elbow
-	glTranslatef(0.0, -0.5 * 0.6 * upperArmLength, 0.0); // Position the elbow under the upper arm
-	glScalef(1.2 * upperArmWidth, 0.1 * upperArmLength, 1.2 * upperArmWidth); // Slightly larger elbow joint
-	glutSolidCube(1.0);  // Draw elbow
-	glPopMatrix();
-
-	// Move down for the lower arm, starting from the elbow
-	glTranslatef(0.0, -0.75 * 0.8 * upperArmLength, 1.3); // Move the lower arm further forward along Z-axis
-
-	// Apply rotation to the lower arm for an angled effect
-	glRotatef(-25.0, 1.0, 0.0, 0.0); // Rotate around the X-axis for angle
-
-	// Draw lower arm (green part)
-	glPushMatrix();
-	glMaterialfv(GL_FRONT, GL_AMBIENT, green_mat_ambient);  // Set back to green for the lower arm
-	glMaterialfv(GL_FRONT, GL_SPECULAR, green_mat_specular);
-	glMaterialfv(GL_FRONT, GL_DIFFUSE, green_mat_diffuse);
-	glMaterialfv(GL_FRONT, GL_SHININESS, green_mat_shininess);
-
-	glScalef(upperArmWidth, 0.7 * upperArmLength, upperArmWidth); // Same size of the lower arm
-	glutSolidCube(1.0);
-	glPopMatrix();
-
-	// Now handle the cannon attached to the lower arm
-	glMaterialfv(GL_FRONT, GL_AMBIENT, dark_grey_ambient);
-	glMaterialfv(GL_FRONT, GL_SPECULAR, dark_grey_specular);
-	glMaterialfv(GL_FRONT, GL_DIFFUSE, dark_grey_diffuse);
-	glMaterialfv(GL_FRONT, GL_SHININESS, dark_grey_shininess);
-
-	// Position the cannon at the end of the lower arm
-	glPushMatrix();
-	glTranslatef(0.0, -0.4 * upperArmLength - 0.4 * gunLength, 0.0);  // Position cannon directly at the lower arm's end
+	bakedRobot.Draw(group);
+}
 
-	// Apply cannon spin along its Y-axis (screw-like spin)
-	if (spinCannon) {
-		glRotatef(cannonSpinAngle, 0.0, 1.0, 0.0);  // Spin along the Y-axis
+// submitDrawList() for the software renderer
+void rasterizeDrawList()
+{
+	PROFILE_SCOPE("rasterizeDrawList");
+	for (int i = 0; i < drawList.GetNumItems(); i++) {
+		const DrawItem& item = drawList.GetItem(i);
+		int group = item.mesh;
+
+		rasterizer.DrawMesh(item.matrix, materials.GetMaterial(item.material),
+			bakedRobot.GetGroupVertices(group), bakedRobot.GetGroupNumVertices(group),
+			bakedRobot.GetGroupIndices(group), bakedRobot.GetGroupNumIndices(group));
 	}
+}
 
-	// Draw the gun (cannon body)
-	glPushMatrix();
-	glScalef(gunWidth, gunLength, gunDepth);
-	glutSolidCube(1.0);  // Cannon body
-	glPopMatrix();
-
-	// Draw the cannon barrel (cylinder)
-	glPushMatrix();
-	glTranslatef(0.0, -0.5 * gunLength, 0.0);  // Move to the end of the cannon
-	glRotatef(90.0, 1.0, 0.0, 0.0);  // Align the cylinder properly
-	GLUquadric* quad = gluNewQuadric();
-	gluCylinder(quad, 1.5, 1.5, 5.0, 40, 20);  // Barrel
-	glPopMatrix();
-
-	// Draw the orange projectile inside the cannon
-	glPushMatrix();
-	glMaterialfv(GL_FRONT, GL_AMBIENT, red_orange_ambient);
-	glMaterialfv(GL_FRONT, GL_DIFFUSE, red_orange_diffuse);
-	glMaterialfv(GL_FRONT, GL_SPECULAR, red_orange_specular);
-	glMaterialfv(GL_FRONT, GL_SHININESS, red_orange_shininess);
-	glTranslatef(0.0, -2.5 * gunLength, 0.0);  // Inside the cannon
-	glScalef(gunWidth * 0.5, gunLength * 0.1, gunDepth * 0.5);
-	glutSolidCube(1.0);  // The orange projectile
-	glPopMatrix();
-
-	// Draw the magazine under the cannon
-	glPushMatrix();
-	glTranslatef(0.0, -gunLength - 1.0, 0.0);  // Position magazine below the cannon
-	glScalef(gunWidth * 0.8, gunLength * 0.4, gunDepth * 0.8);  // Scale the magazine
-	glutSolidCube(1.0);
-	glPopMatrix();
-
-	glPopMatrix();  // End cannon drawing
-	glPopMatrix();  // End arm drawing
+void updateStatsTitle()
+{
+	char title[512];
+
+	sprintf(title, "3D Hierarchical Example - %s, robot draws %d, parts culled %d/%d, ground chunks drawn %d/%d, material binds %d issued/%d skipped, "
+		"state changes %d recorded/%d %s, robots drawn %d/%d, nodes recomputed %d robot/%d crowd, frame %d %.2f ms from %d requests",
+		softwareRendering ? "software" : "GL", drawList.GetNumItems(), eyeFrustum.GetNumCulled(), eyeFrustum.GetNumTested(),
+		groundTerrain->GetNumChunksDrawn(), groundTerrain->GetNumChunksSelected(),
+		materials.GetNumBindsIssued(), materials.GetNumBindsSkipped(),
+		drawList.GetNumStateChangesRecorded(), drawList.GetNumStateChanges(), sortDrawList ? "sorted" : "unsorted",
+		crowd.GetNumRobotsDrawn() + 1, (int)robots.size(),
+		robotInstance.GetNumRecomputed(), crowd.GetNumNodesRecomputed(), framesDrawn, frameMilliseconds, numRedisplayRequests);
+	glutSetWindowTitle(title);
 }
 
 void reshape(int w, int h)
@@ -859,97 +582,216 @@ void reshape(int w, int h)
 
 	glMatrixMode(GL_PROJECTION);
 	glLoadIdentity();
-	gluPerspective(60.0, (GLdouble)w / h, 0.2, 100.0); // Increased far clipping plane from 40.0 to 100.0
+	gluPerspective(60.0, (GLdouble)w / h, 0.2, farPlane); // 100.0 for a single robot, further for a crowd
 
 	glMatrixMode(GL_MODELVIEW);
 	glLoadIdentity();
 
 	// Set up the camera at position (0, 6, 35) looking at the origin
 	gluLookAt(0.0, 6.0, 35.0, 0.0, 0.0, 0.0, 0.0, 1.0, 0.0);
-}
 
+	rasterizer.SetSize(w, h);
+}
 
-bool stop = false;
 
-void stepAnimation(int value)
+// Marks the scene as changed. Requests are merged: the first one posts a
+// redisplay, or sets a timer for the next refresh if a frame was drawn less
+// than refreshInterval ago, and the rest wait for that frame.
+void requestRedisplay()
 {
-	if (walking) {
-		// Move legs in opposite directions
-		if (walkingForward) {
-			// Move left leg forward, right leg backward
-			if (hipAngleLeft < 50.0f) {
-				hipAngleLeft += 2.0f;   // Raise left hip
-				kneeAngleLeft -= 1.5f;  // Bend left knee
-				ankleAngleLeft += 1.0f; // Raise left ankle
-				lowerLegAngleLeft += 2.0f; // Rotate the lower leg at the new joint
-			}
+	if (headless)
+		return;  // runHeadless() draws every frame itself
+	numRedisplayRequests++;
+	if (redisplayPosted || redisplayTimerPending)
+		return;
+
+	double wait = lastFrameTime + refreshInterval - elapsedSeconds();
+	if (wait <= 0.0) {
+		redisplayPosted = true;
+		glutPostRedisplay();
+	}
+	else {
+		redisplayTimerPending = true;
+		glutTimerFunc((unsigned int)(wait * 1000.0) + 1, redisplayTimer, 0);
+	}
+}
 
-			if (hipAngleRight > -50.0f) {
-				hipAngleRight -= 2.0f;   // Lower right hip
-				kneeAngleRight += 1.5f;  // Straighten right knee
-				ankleAngleRight -= 1.0f; // Lower right ankle
-				lowerLegAngleRight -= 2.0f; // Rotate the lower leg at the new joint
-			}
+void redisplayTimer(int value)
+{
+	redisplayTimerPending = false;
+	redisplayPosted = true;
+	glutPostRedisplay();
+}
 
-			// If both legs have reached their maximum angles, switch direction
-			if (hipAngleLeft >= 50.0f && hipAngleRight <= -50.0f) {
-				walkingForward = false;  // Switch to moving backward
-			}
-		}
-		else { // Move legs in reverse direction (reset position)
-			// Move left leg backward, right leg forward
-			if (hipAngleLeft > 0.0f) {
-				hipAngleLeft -= 2.0f;   // Lower left hip
-				kneeAngleLeft += 1.5f;  // Straighten left knee
-				ankleAngleLeft -= 1.0f; // Lower left ankle
-				lowerLegAngleLeft -= 2.0f; // Reset the lower leg joint angle
-			}
+// While anything animates, each frame requests the next one from display()
+void startSimulation()
+{
+	if (simulationRunning)
+		return;
+	simulationRunning = true;
+	simClock.Reset(elapsedSeconds());
+	snapRenderState();
+	requestRedisplay();
+}
 
-			if (hipAngleRight < 0.0f) {
-				hipAngleRight += 2.0f;   // Raise right hip
-				kneeAngleRight -= 1.5f;  // Bend right knee
-				ankleAngleRight += 1.0f; // Raise right ankle
-				lowerLegAngleRight += 2.0f; // Rotate the lower leg at the new joint
-			}
+// One fixed 10 ms tick of every animation
+void simulationStep()
+{
+	float step = (float)simClock.GetStepSeconds();
+
+	if (walking || IsClipFading(robots[0].animation))
+		AnimateRobot(robots[0], step);
+
+	// The crowd only needs the gait time and how far it has faded in
+	if (walking || crowdWalkWeight > 0.0f) {
+		crowdWalkTime += step;
+		crowdWalkWeight += walking ? step / walkFadeSeconds : -step / walkFadeSeconds;
+		if (crowdWalkWeight > 1.0f)
+			crowdWalkWeight = 1.0f;
+		if (crowdWalkWeight < 0.0f)
+			crowdWalkWeight = 0.0f;
+	}
 
-			// If both legs have returned to their starting angles, switch direction
-			if (hipAngleLeft <= 0.0f && hipAngleRight >= 0.0f) {
-				walkingForward = true;   // Switch to moving forward
-			}
+	if (spinCannon) {
+		float& cannonSpinAngle = robots[0].joints[JOINT_CANNON];
+		cannonSpinAngle += 5.0f;  // Increment the cannon spin angle to rotate the cannon
+		if (cannonSpinAngle > 360.0f) {
+			cannonSpinAngle -= 360.0f;  // Reset the angle after a full rotation
 		}
+	}
+}
 
-		glutPostRedisplay();  // Trigger redraw
-
-		// Continue the walking animation if walking is still active
-		if (walking) {
-			glutTimerFunc(10, stepAnimation, 0);  // Continue walking
+// Runs the simulation steps due by now and fills renderRobots for this frame
+void advanceSimulation()
+{
+	PROFILE_SCOPE("advanceSimulation");
+	if (simulationRunning && !walking && !spinCannon && !IsClipFading(robots[0].animation) && crowdWalkWeight <= 0.0f) {
+		simulationRunning = false;  // Nothing left to animate, frames stop until something changes
+		snapRenderState();
+	}
+	if (simulationRunning) {
+		int steps = simClock.Advance(elapsedSeconds());
+		for (int i = 0; i < steps; i++) {
+			if (i == steps - 1)
+				snapRenderState();
+			simulationStep();
 		}
 	}
+
+	// The main robot is blended between its last two simulated states
+	float alpha = simulationRunning ? simClock.GetAlpha() : 1.0f;
+	renderRobots.resize(robots.size());
+	BlendRobotPoses(previousRobot, robots[0], alpha, renderRobots[0]);
+
+	// The crowd is posed straight from the gait at this frame's exact time
+	if (robots.size() > 1)
+		PoseRobotsFromGait(&robots[1], (int)robots.size() - 1,
+			previousWalkTime + (crowdWalkTime - previousWalkTime) * alpha,
+			previousWalkWeight + (crowdWalkWeight - previousWalkWeight) * alpha, &renderRobots[1], jobs);
 }
 
-void cannonAnimation(int value)
+// Makes the previous simulation state the current one, after changing robots directly
+void snapRenderState()
 {
-	if (spinCannon)
-	{
-		cannonSpinAngle += 5.0f;  // Increment the cannon spin angle to rotate the cannon
-		if (cannonSpinAngle > 360.0f) {
-			cannonSpinAngle -= 360.0f;  // Reset the angle after a full rotation
+	previousRobot = robots[0];
+	previousWalkTime = crowdWalkTime;
+	previousWalkWeight = crowdWalkWeight;
+}
+
+double elapsedSeconds()
+{
+	static std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+	if (headless)
+		return headlessTime;
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+// Draws numFrames frames of the robot walking with its cannon spinning into an
+// offscreen context, or with the software renderer and no GL at all, and
+// prints their timing. Returns the process exit status: 0 on success, 1 if GL
+// reported errors, 2 if no context could be created and 3 if the last frame
+// could not be written to imagePath or the profile to tracePath.
+int runHeadless(int numFrames, int width, int height, int crowdSize, const char* imagePath, bool software,
+	const char* tracePath)
+{
+	HeadlessContext context;
+	double totalMs = 0.0, minMs = 0.0, maxMs = 0.0;
+	int numErrors = 0;
+
+	if (width <= 0 || height <= 0 || (!software && !context.Create(width, height)))
+		return 2;
+	headless = true;
+	softwareRendering = software;
+
+	if (software)
+		initScene();
+	else
+		initOpenGL(width, height);
+	setCrowdSize(crowdSize > 1 ? crowdSize : 1);
+	farPlane = robots.size() > 1 ? 3000.0 : 100.0;
+	if (software)
+		rasterizer.SetSize(width, height);
+	else
+		reshape(width, height);
+
+	walking = true;
+	StartRobotWalk(robots[0], walkFadeSeconds);
+	spinCannon = true;
+	startSimulation();
+
+	for (int f = 0; f < numFrames; f++) {
+		std::chrono::steady_clock::time_point frameStart = std::chrono::steady_clock::now();
+		headlessTime += refreshInterval;
+		display();
+		if (!software)
+			glFinish();  // Count the rendering, not just the submission
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+
+		totalMs += ms;
+		minMs = f == 0 || ms < minMs ? ms : minMs;
+		maxMs = f == 0 || ms > maxMs ? ms : maxMs;
+		for (GLenum error = software ? GL_NO_ERROR : glGetError(); error != GL_NO_ERROR; error = glGetError()) {
+			if (numErrors++ < 10)
+				fprintf(stderr, "headless: frame %d: GL error 0x%x\n", f, error);
 		}
-		glutPostRedisplay();  // Redraw to show the updated cannon position
-		glutTimerFunc(10, cannonAnimation, 0);  // Continue spinning the cannon
 	}
-}
 
-void resetJointAngles() {
-	hipAngleLeft = 0.0f;
-	kneeAngleLeft = 0.0f;
-	ankleAngleLeft = 0.0f;
-	lowerLegAngleLeft = 0.0f;
+	printf("headless: %d frames at %dx%d, %d robots, %s renderer, %d threads, ms per frame mean %.3f min %.3f max %.3f, GL errors %d\n",
+		numFrames, width, height, (int)robots.size(), software ? "software" : "GL", jobs->GetNumThreads(),
+		totalMs / numFrames, minMs, maxMs, numErrors);
+	fflush(stdout);
+
+	int status = numErrors > 0 ? 1 : 0;
+	bool saved = !imagePath || (software ?
+		HeadlessContext::WriteImage(imagePath, rasterizer.GetPixels(), width, height, 4) : context.SaveImage(imagePath));
+	if (!saved) {
+		fprintf(stderr, "headless: could not write %s\n", imagePath);
+		status = 3;
+	}
+	if (tracePath && !writeProfile(tracePath))
+		status = 3;
+	delete jobs;
+	jobs = NULL;
+	return status;
+}
 
-	hipAngleRight = 0.0f;
-	kneeAngleRight = 0.0f;
-	ankleAngleRight = 0.0f;
-	lowerLegAngleRight = 0.0f;
+// Writes the frames recorded so far as a Chrome trace and prints their frame
+// time percentiles. Only has something to write in a ROBOT3D_PROFILE build.
+bool writeProfile(const char* tracePath)
+{
+#ifdef ROBOT3D_PROFILE
+	GetProfiler().PrintSummary(stdout);
+	fflush(stdout);
+	if (!GetProfiler().WriteChromeTrace(tracePath)) {
+		fprintf(stderr, "profile: could not write %s\n", tracePath);
+		return false;
+	}
+	printf("profile: trace written to %s\n", tracePath);
+	return true;
+#else
+	fprintf(stderr, "profile: not built with ROBOT3D_PROFILE\n");
+	return false;
+#endif
 }
 
 void keyboard(unsigned char key, int x, int y)
@@ -986,155 +828,173 @@ void keyboard(unsigned char key, int x, int y)
 	case '4':  // Top-down view
 		cameraView = 3;
 		break;
+	case 'v':  // Toggle statistics in the window title
+		showStats = !showStats;
+		if (!showStats)
+			glutSetWindowTitle("3D Hierarchical Example");
+		break;
+	case 's':  // Toggle material-sorted submission of the robot parts
+		sortDrawList = !sortDrawList;
+		break;
+	case 'x':  // Toggle between GL and the software renderer
+		softwareRendering = !softwareRendering;
+		break;
+	case 'p':  // Write the frames profiled so far to robot3d_trace.json
+		writeProfile("robot3d_trace.json");
+		return;
 	case 'w':  // Start/Stop walking
 		walking = !walking;
 		if (walking) {
-			glutTimerFunc(10, stepAnimation, 0);  // Start walking animation
+			StartRobotWalk(robots[0], walkFadeSeconds);
 		}
 		else {
-			resetJointAngles();  // Reset joint angles when walking stops
-			glutPostRedisplay(); // Trigger a redraw to reflect the reset angles
+			StopRobotWalk(robots[0], walkFadeSeconds);  // Legs ease back to standing
 		}
+		startSimulation();
+		snapRenderState();
+		break;
+	case 'r':  // Cycle the number of robots in the crowd
+		crowdSizeIndex = (crowdSizeIndex + 1) % (sizeof(crowdSizes) / sizeof(crowdSizes[0]));
+		setCrowdSize(crowdSizes[crowdSizeIndex]);
+		snapRenderState();
+		farPlane = robots.size() > 1 ? 3000.0 : 100.0;
+		reshape(glutGet(GLUT_WINDOW_WIDTH), glutGet(GLUT_WINDOW_HEIGHT));
 		break;
 	case 'c':  // Toggle cannon spinning
 		spinCannon = !spinCannon;
 		if (spinCannon) {
-			glutTimerFunc(10, cannonAnimation, 0);
+			startSimulation();
 		}
 		break;
 	default:
-		break;
-	}
-	glutPostRedisplay();
-}
-
-void animationHandler(int param)
-{
-	if (!stop)
-	{
-		shoulderAngle += 1.0;
-		glutPostRedisplay();
-		glutTimerFunc(10, animationHandler, 0);
+		return;  // Not a key this program uses, nothing changed
 	}
+	requestRedisplay();
 }
 
 void functionKeys(int key, int x, int y)
 {
+	float* joints = robots[0].joints;  // The keys only move the main robot
+
 	switch (key)
 	{
 	case GLUT_KEY_LEFT:
 		// Control right knee when 'k' is pressed
 		if (selectedJoint == 1) {
-			kneeAngleRight += 2.0f;  // Rotate right knee
+			joints[JOINT_KNEE_RIGHT] += 2.0f;  // Rotate right knee
 		}
 		// Control right hip when 'h' is pressed
 		else if (selectedJoint == 2) {
-			hipAngleRight += 2.0f;   // Rotate right hip
+			joints[JOINT_HIP_RIGHT] += 2.0f;   // Rotate right hip
 		}
 		// Control neck
 		else if (selectedJoint == 3) {
-			neckAngle += 2.0f;     // Rotate neck (left turn)
+			joints[JOINT_NECK] += 2.0f;     // Rotate neck (left turn)
 		}
 		// Control body rotation
 		else if (selectedJoint == 4) {
-			robotAngle += 2.0f;    // Rotate body (left)
-			if (robotAngle > 360.0f) {
-				robotAngle -= 360.0f;
+			joints[JOINT_BODY] += 2.0f;    // Rotate body (left)
+			if (joints[JOINT_BODY] > 360.0f) {
+				joints[JOINT_BODY] -= 360.0f;
 			}
 		}
 		// Rotate lower left leg
 		else if (selectedJoint == 5) {
-			lowerLegAngleLeft += 2.0f;  // Rotate lower left leg
+			joints[JOINT_LOWER_LEG_LEFT] += 2.0f;  // Rotate lower left leg
 		}
 		// Rotate ankle
 		else if (selectedJoint == 6) {
-			ankleAngleLeft += 2.0f;
+			joints[JOINT_ANKLE_LEFT] += 2.0f;
 		}
 		break;
 
 	case GLUT_KEY_RIGHT:
 		// Control right knee when 'k' is pressed
 		if (selectedJoint == 1) {
-			kneeAngleRight -= 2.0f;  // Rotate right knee in the opposite direction
+			joints[JOINT_KNEE_RIGHT] -= 2.0f;  // Rotate right knee in the opposite direction
 		}
 		// Control right hip when 'h' is pressed
 		else if (selectedJoint == 2) {
-			hipAngleRight -= 2.0f;   // Rotate right hip in the opposite direction
+			joints[JOINT_HIP_RIGHT] -= 2.0f;   // Rotate right hip in the opposite direction
 		}
 		// Control neck
 		else if (selectedJoint == 3) {
-			neckAngle -= 2.0f;     // Rotate neck (right turn)
+			joints[JOINT_NECK] -= 2.0f;     // Rotate neck (right turn)
 		}
 		// Control body rotation
 		else if (selectedJoint == 4) {
-			robotAngle -= 2.0f;    // Rotate body (right)
-			if (robotAngle < -360.0f) {
-				robotAngle += 360.0f;
+			joints[JOINT_BODY] -= 2.0f;    // Rotate body (right)
+			if (joints[JOINT_BODY] < -360.0f) {
+				joints[JOINT_BODY] += 360.0f;
 			}
 		}
 		// Rotate lower left leg in opposite direction
 		else if (selectedJoint == 5) {
-			lowerLegAngleLeft -= 2.0f;  // Rotate lower left leg in the opposite direction
+			joints[JOINT_LOWER_LEG_LEFT] -= 2.0f;  // Rotate lower left leg in the opposite direction
 		}
 		// Rotate ankle
 		else if (selectedJoint == 6) {
-			ankleAngleLeft -= 2.0f;
+			joints[JOINT_ANKLE_LEFT] -= 2.0f;
 		}
 		break;
 
 	case GLUT_KEY_UP:
 		// Control left knee when 'k' is pressed
 		if (selectedJoint == 1) {
-			kneeAngleLeft += 2.0f;  // Rotate left knee
+			joints[JOINT_KNEE_LEFT] += 2.0f;  // Rotate left knee
 		}
 		// Control left hip when 'h' is pressed
 		else if (selectedJoint == 2) {
-			hipAngleLeft += 2.0f;   // Rotate left hip
+			joints[JOINT_HIP_LEFT] += 2.0f;   // Rotate left hip
 		}
 		// Control neck
 		else if (selectedJoint == 3) {
-			neckAngle += 2.0f;     // Rotate neck (upward turn - simulating look up)
+			joints[JOINT_NECK] += 2.0f;     // Rotate neck (upward turn - simulating look up)
 		}
 		else if (selectedJoint == 4) {
-			robotAngle += 2.0f;    // Optional: You can add more functionality for the body here
+			joints[JOINT_BODY] += 2.0f;    // Optional: You can add more functionality for the body here
 		}
 		// Rotate lower left leg in opposite direction
 		else if (selectedJoint == 5) {
-			lowerLegAngleLeft += 2.0f;  // Rotate lower left leg in the opposite direction
+			joints[JOINT_LOWER_LEG_LEFT] += 2.0f;  // Rotate lower left leg in the opposite direction
 		}
 		// Rotate ankle
 		else if (selectedJoint == 6) {
-			ankleAngleLeft += 2.0f;
+			joints[JOINT_ANKLE_LEFT] += 2.0f;
 		}
 		break;
 
 	case GLUT_KEY_DOWN:
 		// Control left knee when 'k' is pressed
 		if (selectedJoint == 1) {
-			kneeAngleLeft -= 2.0f;  // Rotate left knee in the opposite direction
+			joints[JOINT_KNEE_LEFT] -= 2.0f;  // Rotate left knee in the opposite direction
 		}
 		// Control left hip when 'h' is pressed
 		else if (selectedJoint == 2) {
-			hipAngleLeft -= 2.0f;   // Rotate left hip in the opposite direction
+			joints[JOINT_HIP_LEFT] -= 2.0f;   // Rotate left hip in the opposite direction
 		}
 		// Control neck
 		else if (selectedJoint == 3) {
-			neckAngle -= 2.0f;     // Rotate neck (downward turn - simulating look down)
+			joints[JOINT_NECK] -= 2.0f;     // Rotate neck (downward turn - simulating look down)
 		}
 		else if (selectedJoint == 4) {
-			robotAngle -= 2.0f;    // Optional: You can add more functionality for the body here
+			joints[JOINT_BODY] -= 2.0f;    // Optional: You can add more functionality for the body here
 		}
 		// Rotate lower left leg
 		else if (selectedJoint == 5) {
-			lowerLegAngleLeft -= 2.0f;  // Rotate lower left leg
+			joints[JOINT_LOWER_LEG_LEFT] -= 2.0f;  // Rotate lower left leg
 		}
 		// Rotate ankle
 		else if (selectedJoint == 6) {
-			ankleAngleLeft -= 2.0f;
+			joints[JOINT_ANKLE_LEFT] -= 2.0f;
 		}
 		break;
+
+	default:
+		return;  // Not a key this program uses, nothing changed
 	}
-	glutPostRedisplay();   // Trigger redraw to apply changes
+	snapRenderState();
+	requestRedisplay();   // Trigger redraw to apply changes
 }
 
 // Mouse button callback - use only if you want to
@@ -1160,8 +1020,7 @@ void mouse(int button, int state, int x, int y)
 	default:
 		break;
 	}
-
-	glutPostRedisplay();   // Trigger a window redisplay
+	// The buttons do not change anything on screen yet, so no redisplay is requested
 }
 
 // Mouse motion callback - use only if you want to
@@ -1171,6 +1030,5 @@ void mouseMotionHandler(int xMouse, int yMouse)
 	{
 		;
 	}
-
-	glutPostRedisplay();   // Trigger a window redisplay
+	// Neither does dragging
 }
@@ -0,0 +1,295 @@
+#ifdef _WIN32
+#include <windows.h>
+#endif
+#include <GL/gl.h>
+#include <math.h>
+#include <vector>
+#include "VECTOR3D.h"
+#include "MATRIX4X4.h"
+#include "Frustum.h"
+#include "SceneGraph.h"
+#include "RobotModel.h"
+#include "PrimitiveCache.h"
+#include "MaterialRegistry.h"
+#include "JobSystem.h"
+#include "SoftwareRasterizer.h"
+#include "Profiler.h"
+#include "RobotCrowd.h"
+
+// Robots are drawn this many vertices at a time at most, which keeps the
+// client arrays GL reads per call in cache-friendly sizes
+static const int kMaxChunkVertices = 65536;
+
+static void UnionBounds(BBox& bounds, const BBox& box) {
+    if (box.min.x < bounds.min.x) bounds.min.x = box.min.x;
+    if (box.min.y < bounds.min.y) bounds.min.y = box.min.y;
+    if (box.min.z < bounds.min.z) bounds.min.z = box.min.z;
+    if (box.max.x > bounds.max.x) bounds.max.x = box.max.x;
+    if (box.max.y > bounds.max.y) bounds.max.y = box.max.y;
+    if (box.max.z > bounds.max.z) bounds.max.z = box.max.z;
+}
+
+RobotCrowd::RobotCrowd() {
+    graph = NULL;
+    materialRegistry = NULL;
+    materialIDs = NULL;
+    for (int i = 0; i < NUM_ROBOT_PRIMITIVES; i++)
+        meshes[i] = NULL;
+    robotVisible = NULL;
+    visibleCapacity = 0;
+    updateRobots = NULL;
+    numNodesRecomputed = 0;
+}
+
+RobotCrowd::~RobotCrowd() {
+    delete[] robotVisible;
+}
+
+void RobotCrowd::Init(SceneGraph* graph, MaterialRegistry* registry, const int* materialIDs,
+    const PrimitiveMesh** meshes, const BBox* bounds) {
+    this->graph = graph;
+    this->materialRegistry = registry;
+    instances.clear();
+    visibleRobots.clear();
+    this->materialIDs = materialIDs;
+    for (int i = 0; i < NUM_ROBOT_PRIMITIVES; i++)
+        this->meshes[i] = meshes[i];
+
+    // Sort the parts by material and lay out one robot's share of each batch
+    for (int m = 0; m < NUM_ROBOT_MATERIALS; m++) {
+        Batch& batch = batches[m];
+        batch.nodes.clear();
+        batch.verticesPerRobot = 0;
+        batch.indicesPerRobot = 0;
+        for (int i = 0; i < graph->GetNumNodes(); i++) {
+            const SceneNode& node = graph->GetNode(i);
+            if (node.material != m || node.primitive < 0 || !meshes[node.primitive])
+                continue;
+            batch.nodes.push_back(i);
+            batch.verticesPerRobot += meshes[node.primitive]->numVertices;
+            batch.indicesPerRobot += meshes[node.primitive]->numIndices;
+        }
+
+        batch.robotsPerChunk = batch.verticesPerRobot > 0 ? kMaxChunkVertices / batch.verticesPerRobot : 0;
+        if (batch.robotsPerChunk < 1)
+            batch.robotsPerChunk = 1;
+        batch.chunkIndices.clear();
+        if (batch.nodes.empty())
+            continue;
+
+        GLuint base = 0;
+        for (int r = 0; r < batch.robotsPerChunk; r++) {
+            for (size_t n = 0; n < batch.nodes.size(); n++) {
+                const PrimitiveMesh* mesh = meshes[graph->GetNode(batch.nodes[n]).primitive];
+                for (int i = 0; i < mesh->numIndices; i++)
+                    batch.chunkIndices.push_back(base + mesh->indices[i]);
+                base += mesh->numVertices;
+            }
+        }
+    }
+
+    // Crowd robots only ever walk, so one box around a full walk cycle holds
+    // every pose they can be drawn in
+    RobotPose pose;
+    BBox box;
+    bool first = true;
+
+    InitRobotPose(pose);
+    StartRobotWalk(pose, 0.0f);
+    for (int tick = 0; tick <= 60; tick++) {
+        graph->UpdateWorldMatrices(pose.joints);
+        for (int i = 0; i < graph->GetNumNodes(); i++) {
+            const SceneNode& node = graph->GetNode(i);
+            if (node.primitive < 0)
+                continue;
+            TransformBounds(graph->GetWorldMatrix(i), bounds[node.primitive], box);
+            if (first)
+                robotBounds = box;
+            else
+                UnionBounds(robotBounds, box);
+            first = false;
+        }
+        AnimateRobot(pose, 0.01f);
+    }
+}
+
+void RobotCrowd::BoundsJob(void* data, int begin, int end) {
+    PROFILE_SCOPE("RobotCrowd::BoundsJob");
+    RobotCrowd* crowd = (RobotCrowd*)data;
+    MATRIX4X4 placement;
+
+    for (int r = begin; r < end; r++) {
+        GetRobotPlacement(crowd->updateRobots[r], placement);
+        TransformBounds(placement, crowd->robotBounds, crowd->worldBounds[r]);
+    }
+}
+
+void RobotCrowd::PoseJob(void* data, int begin, int end) {
+    PROFILE_SCOPE("RobotCrowd::PoseJob");
+    RobotCrowd* crowd = (RobotCrowd*)data;
+    MATRIX4X4 placement;
+
+    for (int v = begin; v < end; v++) {
+        int r = crowd->visibleRobots[v];
+        const RobotPose& pose = crowd->updateRobots[r];
+        SceneGraphInstance& instance = crowd->instances[r];
+        GetRobotPlacement(pose, placement);
+        instance.SetPlacement(placement);
+        instance.SetJointAngles(pose.joints);
+        crowd->slotRecomputed[v] = instance.Update();
+
+        // The arrays still hold this robot from last time, only moved parts need writing
+        bool rewriteAll = v >= (int)crowd->previousVisible.size() || crowd->previousVisible[v] != r;
+        if (!rewriteAll && crowd->slotRecomputed[v] == 0)
+            continue;
+
+        for (int m = 0; m < NUM_ROBOT_MATERIALS; m++) {
+            Batch& batch = crowd->batches[m];
+            if (batch.nodes.empty())
+                continue;
+
+            GLfloat* dst = &batch.vertices[(size_t)v * batch.verticesPerRobot * 6];
+            for (size_t n = 0; n < batch.nodes.size(); n++) {
+                int node = batch.nodes[n];
+                const PrimitiveMesh* mesh = crowd->meshes[crowd->graph->GetNode(node).primitive];
+                if (rewriteAll || instance.WasRecomputed(node))
+                    crowd->AddMesh(mesh, instance.GetWorldMatrix(node), dst);
+                dst += mesh->numVertices * 6;
+            }
+        }
+    }
+}
+
+void RobotCrowd::Update(const RobotPose* robots, int count, Frustum* frustum, JobSystem* jobs) {
+    PROFILE_SCOPE("RobotCrowd::Update");
+    previousVisible.swap(visibleRobots);
+    visibleRobots.clear();
+    numNodesRecomputed = 0;
+    if (count <= 0 || !graph)
+        return;
+    updateRobots = robots;
+
+    // Robots new to the crowd start with every node dirty
+    int numInstances = (int)instances.size();
+    if (count > numInstances) {
+        instances.resize(count);
+        for (int r = numInstances; r < count; r++)
+            instances[r].Init(graph);
+    }
+
+    // Cull whole robots first, their boxes only need the placement matrix
+    if (count > visibleCapacity) {
+        delete[] robotVisible;
+        visibleCapacity = count;
+        robotVisible = new bool[visibleCapacity];
+    }
+    worldBounds.resize(count);
+    if (jobs)
+        jobs->ParallelFor(count, 0, BoundsJob, this);
+    else
+        BoundsJob(this, 0, count);
+
+    if (frustum)
+        frustum->CullBoxes(&worldBounds[0], count, robotVisible);
+    else {
+        for (int r = 0; r < count; r++)
+            robotVisible[r] = true;
+    }
+    for (int r = 0; r < count; r++) {
+        if (robotVisible[r])
+            visibleRobots.push_back(r);
+    }
+
+    int numVisible = (int)visibleRobots.size();
+    if (numVisible == 0)
+        return;
+    for (int m = 0; m < NUM_ROBOT_MATERIALS; m++)
+        batches[m].vertices.resize((size_t)numVisible * batches[m].verticesPerRobot * 6);
+    slotRecomputed.resize(numVisible);
+
+    if (jobs)
+        jobs->ParallelFor(numVisible, 0, PoseJob, this);
+    else
+        PoseJob(this, 0, numVisible);
+    for (int v = 0; v < numVisible; v++)
+        numNodesRecomputed += slotRecomputed[v];
+}
+
+void RobotCrowd::AddMesh(const PrimitiveMesh* mesh, const MATRIX4X4& m, GLfloat* dst) {
+    // Normals go through the cofactor matrix, the inverse transpose scaled by
+    // the determinant. GL_NORMALIZE takes care of the scale, only its sign matters.
+    const float* e = m.entries;
+    VECTOR3D a(e[0], e[1], e[2]), b(e[4], e[5], e[6]), c(e[8], e[9], e[10]);
+    VECTOR3D na = b.CrossProduct(c), nb = c.CrossProduct(a), nc = a.CrossProduct(b);
+    if (a.DotProduct(na) < 0.0f) {
+        na = -na;
+        nb = -nb;
+        nc = -nc;
+    }
+
+    const GLfloat* src = mesh->vertices;
+    for (int v = 0; v < mesh->numVertices; v++, src += 6, dst += 6) {
+        float x = src[0], y = src[1], z = src[2];
+        float nx = src[3], ny = src[4], nz = src[5];
+        dst[0] = e[0] * x + e[4] * y + e[8] * z + e[12];
+        dst[1] = e[1] * x + e[5] * y + e[9] * z + e[13];
+        dst[2] = e[2] * x + e[6] * y + e[10] * z + e[14];
+        dst[3] = na.x * nx + nb.x * ny + nc.x * nz;
+        dst[4] = na.y * nx + nb.y * ny + nc.y * nz;
+        dst[5] = na.z * nx + nb.z * ny + nc.z * nz;
+    }
+}
+
+void RobotCrowd::Draw() {
+    PROFILE_SCOPE("RobotCrowd::Draw");
+    int numVisible = (int)visibleRobots.size();
+    if (numVisible == 0)
+        return;
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_NORMAL_ARRAY);
+
+    for (int m = 0; m < NUM_ROBOT_MATERIALS; m++) {
+        const Batch& batch = batches[m];
+        if (batch.nodes.empty())
+            continue;
+        if (materialRegistry)
+            materialRegistry->Bind(materialIDs[m]);
+
+        // Every chunk starts a whole number of robots in, so the same indices serve them all
+        for (int first = 0; first < numVisible; first += batch.robotsPerChunk) {
+            int robotsInChunk = numVisible - first < batch.robotsPerChunk ? numVisible - first : batch.robotsPerChunk;
+            const GLfloat* v = &batch.vertices[(size_t)first * batch.verticesPerRobot * 6];
+            glVertexPointer(3, GL_FLOAT, 6 * sizeof(GLfloat), v);
+            glNormalPointer(GL_FLOAT, 6 * sizeof(GLfloat), v + 3);
+            glDrawElements(GL_TRIANGLES, robotsInChunk * batch.indicesPerRobot, GL_UNSIGNED_INT, &batch.chunkIndices[0]);
+            PROFILE_COUNT(COUNTER_GL_CALLS, 3);
+            PROFILE_COUNT(COUNTER_DRAW_CALLS, 1);
+            PROFILE_COUNT(COUNTER_VERTICES, robotsInChunk * batch.indicesPerRobot);
+        }
+    }
+
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    PROFILE_COUNT(COUNTER_GL_CALLS, 4);  // the client state
+}
+
+void RobotCrowd::Rasterize(SoftwareRasterizer& rasterizer, const MATRIX4X4& view) const {
+    PROFILE_SCOPE("RobotCrowd::Rasterize");
+    int numVisible = (int)visibleRobots.size();
+    if (numVisible == 0 || !materialRegistry)
+        return;
+
+    for (int m = 0; m < NUM_ROBOT_MATERIALS; m++) {
+        const Batch& batch = batches[m];
+        if (batch.nodes.empty())
+            continue;
+        const Material& material = materialRegistry->GetMaterial(materialIDs[m]);
+
+        for (int first = 0; first < numVisible; first += batch.robotsPerChunk) {
+            int robotsInChunk = numVisible - first < batch.robotsPerChunk ? numVisible - first : batch.robotsPerChunk;
+            rasterizer.DrawMesh(view, material, &batch.vertices[(size_t)first * batch.verticesPerRobot * 6],
+                robotsInChunk * batch.verticesPerRobot, &batch.chunkIndices[0], robotsInChunk * batch.indicesPerRobot);
+        }
+    }
+}
@@ -0,0 +1,84 @@
+#ifndef ROBOTCROWD_H
+#define ROBOTCROWD_H
+
+#include <vector>
+#include "VECTOR3D.h"
+#include "MATRIX4X4.h"
+#include "Frustum.h"
+#include "SceneGraph.h"
+#include "RobotModel.h"
+
+class MaterialRegistry;
+class JobSystem;
+class SoftwareRasterizer;
+struct PrimitiveMesh;
+
+// Draws many robots, each with its own RobotPose, without a GL matrix or
+// material change per part. Update() poses every visible robot and transforms
+// its parts on the CPU into world space vertex arrays, one per material, split
+// across a JobSystem's threads. Draw() then only has to hand those arrays to
+// GL, a few glDrawElements calls per material however many robots there are.
+// Robots whose bounds are outside the frustum are not posed at all. Each
+// robot keeps its world matrices between updates, and a robot drawn in the
+// same place in the arrays as last time only has the parts that moved
+// rewritten, so a crowd standing still costs little more than culling.
+class RobotCrowd {
+private:
+    // World space triangles of every visible robot for one material. Each
+    // robot gets the same number of vertices, so robot k's parts always
+    // start at k * verticesPerRobot and every chunk shares one index list.
+    struct Batch {
+        std::vector<int> nodes;         // graph nodes drawn with this material
+        int verticesPerRobot;
+        int indicesPerRobot;
+        int robotsPerChunk;             // robots per glDrawElements call
+        std::vector<GLuint> chunkIndices;
+        std::vector<GLfloat> vertices;  // interleaved position and normal, 6 floats per vertex
+    };
+
+    SceneGraph* graph;
+    MaterialRegistry* materialRegistry;
+    const int* materialIDs;                               // registry IDs by RobotMaterial
+    const PrimitiveMesh* meshes[NUM_ROBOT_PRIMITIVES];    // geometry by RobotPrimitive
+    Batch batches[NUM_ROBOT_MATERIALS];
+    BBox robotBounds;  // around every walk cycle pose, relative to the robot origin
+
+    std::vector<BBox> worldBounds;
+    bool* robotVisible;
+    int visibleCapacity;
+    std::vector<int> visibleRobots;
+    std::vector<int> previousVisible;        // visibleRobots of the last Update()
+    std::vector<SceneGraphInstance> instances;  // per robot, world matrices kept between updates
+    std::vector<int> slotRecomputed;         // nodes recomputed per visible robot
+    int numNodesRecomputed;
+    const RobotPose* updateRobots;  // the array Update() is working on
+
+    static void BoundsJob(void* data, int begin, int end);
+    static void PoseJob(void* data, int begin, int end);
+    void AddMesh(const PrimitiveMesh* mesh, const MATRIX4X4& m, GLfloat* dst);
+
+public:
+    RobotCrowd();
+    ~RobotCrowd();
+
+    // graph must already hold the robot built by BuildRobotGraph(). bounds
+    // gives the object space box of each RobotPrimitive.
+    void Init(SceneGraph* graph, MaterialRegistry* registry, const int* materialIDs,
+        const PrimitiveMesh** meshes, const BBox* bounds);
+
+    // Culls robots[0..count) against a world space frustum, NULL to keep them
+    // all, and builds the vertex arrays of the rest. Makes no GL calls. jobs
+    // may be NULL to do the work on the calling thread.
+    void Update(const RobotPose* robots, int count, Frustum* frustum, JobSystem* jobs);
+
+    // Draws what the last Update() built, with the view matrix as the current modelview
+    void Draw();
+
+    // Draw() for the software renderer. Needs the MaterialRegistry given to Init().
+    void Rasterize(SoftwareRasterizer& rasterizer, const MATRIX4X4& view) const;
+
+    int GetNumRobotsDrawn() const { return (int)visibleRobots.size(); }
+    int GetNumNodesRecomputed() const { return numNodesRecomputed; }  // by the last Update()
+};
+
+#endif  // ROBOTCROWD_H
@@ -0,0 +1,795 @@
+/*******************************************************************
+  Robot model: builds the robot's part hierarchy as a SceneGraph
+********************************************************************/
+#ifdef _WIN32
+#include <windows.h>
+#endif
+#include <GL/gl.h>
+#include <math.h>
+#include <string.h>
+#include <vector>
+#include "VECTOR3D.h"
+#include "SceneGraph.h"
+#include "AnimationClip.h"
+#include "Gait.h"
+#include "MaterialRegistry.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+#include "RobotModel.h"
+
+// Note how everything depends on robot body dimensions so that can scale entire robot proportionately
+// just by changing robot body scale
+float robotBodyWidth = 12.0;
+float robotBodyLength = 10.0;
+float robotBodyDepth = 8.0;
+float headWidth = 0.3 * robotBodyWidth;
+float headLength = headWidth;
+float headDepth = headWidth;
+float upperArmLength = robotBodyLength;
+float upperArmWidth = 0.2 * robotBodyWidth;
+float gunWidth = upperArmWidth;
+float gunLength = upperArmLength / 2.0;
+float gunDepth = upperArmWidth;
+float stanchionLength = robotBodyLength;
+float stanchionRadius = 0.1 * robotBodyDepth;
+float baseWidth = 1.5 * robotBodyWidth;
+float baseLength = 0.4 * stanchionLength;
+
+// Robot RGBA material properties by RobotMaterial: ambient, diffuse, specular and shininess
+static const Material robotMaterials[NUM_ROBOT_MATERIALS] = {
+	{ { 0.6f, 0.5f, 0.3f, 1.0f }, { 0.7f, 0.6f, 0.4f, 1.0f }, { 0.1f, 0.1f, 0.1f, 1.0f }, 30.0f },        // beige
+	{ { 0.1f, 0.1f, 0.1f, 1.0f }, { 0.15f, 0.15f, 0.15f, 1.0f }, { 0.2f, 0.2f, 0.2f, 1.0f }, 50.0f },     // dark grey
+	{ { 0.02f, 0.15f, 0.02f, 1.0f }, { 0.05f, 0.2f, 0.05f, 0.1f }, { 0.2f, 0.2f, 0.2f, 1.0f }, 100.0f },  // green
+	{ { 0.3f, 0.2f, 0.1f, 1.0f }, { 0.4f, 0.3f, 0.2f, 1.0f }, { 0.1f, 0.1f, 0.1f, 1.0f }, 30.0f },        // light brown
+	{ { 0.8f, 0.2f, 0.0f, 1.0f }, { 0.9f, 0.3f, 0.1f, 1.0f }, { 0.8f, 0.2f, 0.1f, 1.0f }, 32.0f },        // red orange
+	{ { 1.0f, 1.0f, 1.0f, 1.0f }, { 1.0f, 1.0f, 1.0f, 1.0f }, { 0.5f, 0.5f, 0.5f, 1.0f }, 50.0f },        // white
+	{ { 0.0f, 1.0f, 1.0f, 1.0f }, { 0.0f, 1.0f, 1.0f, 1.0f }, { 0.1f, 0.1f, 0.1f, 1.0f }, 30.0f },        // cyan
+};
+
+// Prototypes for functions in this module
+static void buildBody(SceneBuilder& b);
+static void buildHead(SceneBuilder& b);
+static void buildLowerBody(SceneBuilder& b, int* socketNodes);
+static void buildLeftArm(SceneBuilder& b, int* socketNodes);
+static void buildRightArm(SceneBuilder& b, int* socketNodes);
+static float blendAngle(float a, float b, float t);
+static AnimationClip* buildWalkClip();
+static AnimationClip* buildStandClip();
+
+void RegisterRobotMaterials(MaterialRegistry& registry, int* materialIDs)
+{
+	for (int i = 0; i < NUM_ROBOT_MATERIALS; i++)
+		materialIDs[i] = registry.Register(robotMaterials[i]);
+}
+
+// Leg joints of the walk and their angles halfway through the cycle
+static const int walkJoints[8] = {
+	JOINT_HIP_LEFT, JOINT_KNEE_LEFT, JOINT_ANKLE_LEFT, JOINT_LOWER_LEG_LEFT,
+	JOINT_HIP_RIGHT, JOINT_KNEE_RIGHT, JOINT_ANKLE_RIGHT, JOINT_LOWER_LEG_RIGHT,
+};
+static const float walkAmplitudes[8] = {
+	50.0f,    // left hip swings forward
+	-37.5f,   // left knee bends
+	25.0f,    // left ankle raises
+	50.0f,    // left lower leg
+	-50.0f,   // right hip swings back
+	37.5f,    // right knee straightens
+	-25.0f,   // right ankle lowers
+	-50.0f,   // right lower leg
+};
+static const GaitParams robotGait = { 0.5f, 1.0f, 1.0f, 8, walkJoints, walkAmplitudes };
+
+const GaitParams& GetRobotGait()
+{
+	return robotGait;
+}
+
+// The gait is piecewise linear, so keys at its start, peak and end give the clip exactly
+static AnimationClip* buildWalkClip()
+{
+	float duration = robotGait.period / robotGait.speed;
+	float keyTimes[3] = { 0.0f, 0.5f * duration, duration };
+	float keyAngles[8][3];
+	float joints[NUM_ROBOT_JOINTS];
+
+	for (int k = 0; k < 3; k++) {
+		EvaluateGait(robotGait, keyTimes[k], 1.0f, joints);
+		for (int i = 0; i < 8; i++)
+			keyAngles[i][k] = joints[walkJoints[i]];
+	}
+
+	AnimationClip* clip = new AnimationClip(NUM_ROBOT_JOINTS, duration, true);
+	for (int i = 0; i < 8; i++)
+		clip->AddTrack(walkJoints[i], 3, keyTimes, keyAngles[i]);
+	clip->Build();
+	return clip;
+}
+
+static AnimationClip* buildStandClip()
+{
+	static const float time = 0.0f, angle = 0.0f;
+	AnimationClip* clip = new AnimationClip(NUM_ROBOT_JOINTS, 0.0f, false);
+	for (int i = 0; i < 8; i++)
+		clip->AddTrack(walkJoints[i], 1, &time, &angle);
+	clip->Build();
+	return clip;
+}
+
+const AnimationClip* GetRobotWalkClip()
+{
+	static const AnimationClip* clip = buildWalkClip();
+	return clip;
+}
+
+const AnimationClip* GetRobotStandClip()
+{
+	static const AnimationClip* clip = buildStandClip();
+	return clip;
+}
+
+void InitRobotPose(RobotPose& pose)
+{
+	for (int i = 0; i < NUM_ROBOT_JOINTS; i++)
+		pose.joints[i] = 0.0f;
+	pose.position.Set(0.0, 0.0, 0.0);
+	pose.heading = 0.0f;
+	pose.walkOffset = 0.0f;
+	InitClipPlayback(pose.animation);
+	PlayClip(pose.animation, GetRobotStandClip(), 0.0f, 0.0f);
+}
+
+void StartRobotWalk(RobotPose& pose, float fadeSeconds)
+{
+	PlayClip(pose.animation, GetRobotWalkClip(), pose.walkOffset, fadeSeconds);
+	AnimateRobot(pose, 0.0f);
+}
+
+void StopRobotWalk(RobotPose& pose, float fadeSeconds)
+{
+	PlayClip(pose.animation, GetRobotStandClip(), 0.0f, fadeSeconds);
+	AnimateRobot(pose, 0.0f);
+}
+
+void AnimateRobot(RobotPose& pose, float seconds)
+{
+	// EvaluateClip works on kMaxClipChannels floats, the ones past the joints must not be garbage
+	float channels[kMaxClipChannels] = {};
+
+	AdvanceClip(pose.animation, seconds);
+	memcpy(channels, pose.joints, sizeof(pose.joints));
+	EvaluateClip(pose.animation, channels);
+	memcpy(pose.joints, channels, sizeof(pose.joints));
+}
+
+static float blendAngle(float a, float b, float t)
+{
+	float d = b - a;
+	if (d > 180.0f)
+		d -= 360.0f;
+	else if (d < -180.0f)
+		d += 360.0f;
+	return a + d * t;
+}
+
+void BlendRobotPoses(const RobotPose& a, const RobotPose& b, float t, RobotPose& result)
+{
+	for (int i = 0; i < NUM_ROBOT_JOINTS; i++)
+		result.joints[i] = blendAngle(a.joints[i], b.joints[i], t);
+	result.position = a.position + (b.position - a.position) * t;
+	result.heading = blendAngle(a.heading, b.heading, t);
+	result.walkOffset = b.walkOffset;
+	result.animation = b.animation;
+}
+
+void GetRobotPlacement(const RobotPose& pose, MATRIX4X4& placement)
+{
+	MATRIX4X4 rotation;
+
+	placement.SetTranslation(pose.position);
+	rotation.SetRotationY(pose.heading);
+	placement *= rotation;
+}
+
+// What a ComputeRobotWorldMatrices() call shares with its jobs
+struct KinematicsWork {
+	const SceneGraph* graph;
+	const RobotPose* robots;
+	MATRIX4X4* world;
+};
+
+static void kinematicsJob(void* data, int begin, int end)
+{
+	KinematicsWork* work = (KinematicsWork*)data;
+	int numNodes = work->graph->GetNumNodes();
+	MATRIX4X4 placement;
+
+	for (int i = begin; i < end; i++) {
+		GetRobotPlacement(work->robots[i], placement);
+		work->graph->ComputeWorldMatrices(work->robots[i].joints, placement, work->world + i * numNodes);
+	}
+}
+
+void ComputeRobotWorldMatrices(const SceneGraph& graph, const RobotPose* robots, int count,
+	MATRIX4X4* world, JobSystem* jobs)
+{
+	KinematicsWork work;
+
+	work.graph = &graph;
+	work.robots = robots;
+	work.world = world;
+	if (jobs)
+		jobs->ParallelFor(count, 0, kinematicsJob, &work);
+	else
+		kinematicsJob(&work, 0, count);
+}
+
+// What a PoseRobotsFromGait() call shares with its jobs
+struct GaitWork {
+	const RobotPose* robots;
+	RobotPose* poses;
+	float baseTime;
+	float weight;
+};
+
+static void gaitJob(void* data, int begin, int end)
+{
+	PROFILE_SCOPE("gaitJob");
+	const GaitWork* work = (const GaitWork*)data;
+	const GaitParams& gait = GetRobotGait();
+	const int blockSize = 256;
+	float times[blockSize];
+	float swings[blockSize];
+
+	for (int first = begin; first < end; first += blockSize) {
+		int count = end - first < blockSize ? end - first : blockSize;
+		for (int i = 0; i < count; i++)
+			times[i] = work->baseTime + work->robots[first + i].walkOffset;
+		EvaluateGaitBatch(gait, count, times, swings);
+		for (int i = 0; i < count; i++) {
+			RobotPose& pose = work->poses[first + i];
+			pose = work->robots[first + i];
+			ApplyGaitSwing(gait, swings[i], work->weight, pose.joints);
+		}
+	}
+}
+
+void PoseRobotsFromGait(const RobotPose* robots, int count, double time, float weight,
+	RobotPose* poses, JobSystem* jobs)
+{
+	const GaitParams& gait = GetRobotGait();
+	GaitWork work;
+
+	// Wrapping the time once keeps the per-robot times small enough for floats
+	work.robots = robots;
+	work.poses = poses;
+	work.baseTime = (float)fmod(time, gait.period / gait.speed);
+	work.weight = weight;
+	if (jobs)
+		jobs->ParallelFor(count, 0, gaitJob, &work);
+	else
+		gaitJob(&work, 0, count);
+}
+
+void BuildRobotGraph(SceneGraph& graph, int* socketNodes)
+{
+	SceneBuilder b(graph);
+
+	// 1. The lower body (green part and legs) with no rotation
+	b.PushMatrix();
+	buildLowerBody(b, socketNodes);
+	b.PopMatrix();
+
+	// 2. The upper body, rotated on the base
+	b.PushMatrix();
+	b.Joint(JOINT_BODY, 0.0, 1.0, 0.0);
+
+	// The upper body components: torso, head, arms
+	buildBody(b);      // Beige, black parts (upper torso)
+	buildHead(b);      // Head
+	buildLeftArm(b, socketNodes);   // Left arm
+	buildRightArm(b, socketNodes);  // Right arm
+
+	b.PopMatrix();
+}
+
+static void buildBody(SceneBuilder& b)
+{
+	// Top Part (Beige, wide)
+	b.PushMatrix();
+	// Set material properties for the beige top part
+	b.SetMaterial(MATERIAL_BEIGE);
+
+	// Position and scale the top part
+	b.Translate(0.0, 0.5 * robotBodyLength, 0.0);  // Top part is at the top
+	b.Scale(robotBodyWidth, robotBodyLength / 3.0, robotBodyDepth);  // Wide part, 1/3 of total height
+	b.Primitive(PRIMITIVE_CUBE);
+	b.PopMatrix();
+
+	// Middle Part (Black, thin and long)
+	b.PushMatrix();
+	// Set material properties for the black middle part
+	b.SetMaterial(MATERIAL_DARK_GREY);
+
+	// Position and scale the middle part
+	b.Translate(0.0, 0.0, 0.0);  // Middle part stays in the center
+	b.Scale(0.4 * robotBodyWidth, robotBodyLength / 2.0, 0.4 * robotBodyDepth);  // Thin and long part
+	b.Primitive(PRIMITIVE_CUBE);
+	b.PopMatrix();
+
+	// No longer drawing the green bottom part here; it will now be drawn as part of the lower body.
+}
+
+static void buildHead(SceneBuilder& b)
+{
+	b.SetMaterial(MATERIAL_DARK_GREY);
+
+	b.PushMatrix();
+	// Apply neck rotation
+	b.Joint(JOINT_NECK, 0.0, 1.0, 0.0);  // Rotate neck along Y-axis
+	b.Translate(0, 0.5 * robotBodyLength + 1.0 * headLength, 0); // Move head above the body
+
+	// Draw the head (white part)
+	b.PushMatrix();
+	b.SetMaterial(MATERIAL_WHITE);
+
+	b.Scale(0.4 * robotBodyWidth, 0.4 * robotBodyWidth, 0.4 * robotBodyWidth);
+	b.Primitive(PRIMITIVE_CUBE);
+	b.PopMatrix();
+
+	b.SetMaterial(MATERIAL_GREEN);
+
+	// Draw left side of the head
+	b.PushMatrix();
+	b.Translate(-0.2 * robotBodyWidth, 0, 0);  // Move to left
+	b.Scale(0.01 * robotBodyWidth, 0.4 * robotBodyWidth, 0.4 * robotBodyWidth);
+	b.Primitive(PRIMITIVE_CUBE);
+	b.PopMatrix();
+
+	// Draw right side of the head
+	b.PushMatrix();
+	b.Translate(0.2 * robotBodyWidth, 0, 0);  // Move to right
+	b.Scale(0.01 * robotBodyWidth, 0.4 * robotBodyWidth, 0.4 * robotBodyWidth);
+	b.Primitive(PRIMITIVE_CUBE);
+	b.PopMatrix();
+
+	// Grey stripe positioned just behind the blue and in front of the white, move very slightly down
+	b.SetMaterial(MATERIAL_DARK_GREY);
+
+	// Move the front grey part very slightly down
+	b.PushMatrix();
+	b.Translate(0.0, 0.06 * robotBodyWidth, 0.20 * robotBodyWidth);  // Very slight downward adjustment
+	b.Scale(0.12 * robotBodyWidth, 0.3 * robotBodyWidth, 0.03 * robotBodyWidth);  // Taller and wider
+	b.Primitive(PRIMITIVE_CUBE);
+	b.PopMatrix();
+
+	// Add grey part to the top of the head
+	b.PushMatrix();
+	b.Translate(0.0, 0.2 * robotBodyWidth, 0.01 * robotBodyWidth);  // Small forward adjustment
+	b.Scale(0.12 * robotBodyWidth, 0.02 * robotBodyWidth, 0.42 * robotBodyWidth);  // Long and thin grey stripe on top
+	b.Primitive(PRIMITIVE_CUBE);
+	b.PopMatrix();
+
+	// Blue eye (upright visor-like stripe)
+	b.PushMatrix();
+	b.SetMaterial(MATERIAL_CYAN);
+
+	// Position the blue visor/eye on the front
+	b.Translate(0.0, 0.1 * robotBodyWidth, 0.22 * robotBodyWidth);  // Position it on the front
+	b.Scale(0.05 * robotBodyWidth, 0.2 * robotBodyWidth, 0.02 * robotBodyWidth);  // Flip dimensions to make it upright
+	b.Primitive(PRIMITIVE_CUBE); // Blue eye
+	b.PopMatrix();
+
+	b.PopMatrix();  // End head drawing
+}
+
+static void buildLowerBody(SceneBuilder& b, int* socketNodes)
+{
+	// Lower body green section (stationary part)
+	b.PushMatrix();
+	b.SetMaterial(MATERIAL_GREEN);
+
+	// Position the green section (between the legs) under the upper body but not affected by rotation
+	b.Translate(0.0, -0.5 * robotBodyLength, 0.0);  // Move to where the green section is positioned
+	b.Scale(0.8 * robotBodyWidth, robotBodyLength / 3.0, 0.8 * robotBodyDepth);  // Scale to match the body proportions
+	b.Primitive(PRIMITIVE_CUBE);  // Draw the green section (stationary)
+	b.PopMatrix();
+
+	// Left leg
+	b.PushMatrix();
+	// Move the leg lower to connect better to the body
+	b.Translate(0.5 * robotBodyWidth, -0.7 * robotBodyLength, 0.0); // Adjust leg height
+
+	// Hip rotation for walking
+	b.Joint(JOINT_HIP_LEFT, 1.0, 0.0, 0.0); // Rotate hip joint
+
+	// Upper leg segment - beige
+	b.PushMatrix();
+	b.SetMaterial(MATERIAL_BEIGE);
+
+	// Rotate and scale the upper leg
+	b.Rotate(-15, 1.0, 0.0, 0.0); // Slight rotation for a zig-zag pose
+	b.Scale(0.2 * robotBodyWidth, 0.5 * robotBodyLength, 0.2 * robotBodyDepth);
+	b.Primitive(PRIMITIVE_CUBE);
+	b.PopMatrix(); // End upper leg segment
+
+	// Add kneecap before moving down for the lower leg
+	b.PushMatrix();
+	b.SetMaterial(MATERIAL_LIGHT_BROWN);
+
+	// Adjust kneecap placement (slightly forward on the Z-axis)
+	b.Translate(0.0, -0.25 * robotBodyLength, 0.10 * robotBodyDepth);  // Move kneecap forward slightly
+	b.Scale(0.25 * robotBodyWidth, 0.1 * robotBodyLength, 0.25 * robotBodyDepth);  // Scale the kneecap
+	b.Primitive(PRIMITIVE_CUBE);  // Draw kneecap
+	b.PopMatrix();
+
+	// Move down for knee joint
+	b.Translate(0.0, -0.5 * robotBodyLength, 0.0);
+	// Knee rotation
+	b.Joint(JOINT_KNEE_LEFT, 1.0, 0.0, 0.0); // Rotate knee
+
+	// Lower leg segment - green
+	b.PushMatrix();
+	b.SetMaterial(MATERIAL_GREEN);
+
+	b.Rotate(15, 1.0, 0.0, 0.0); // Rotate to maintain zig-zag pose
+	b.Scale(0.2 * robotBodyWidth, 0.5 * robotBodyLength, 0.2 * robotBodyDepth);
+	b.Primitive(PRIMITIVE_CUBE);
+	b.PopMatrix(); // End lower leg segment
+
+	// New kneecap between the two green parts
+	b.PushMatrix();
+	b.SetMaterial(MATERIAL_LIGHT_BROWN);
+
+	// Translate to position the kneecap between the two green parts
+	b.Translate(0.0, -0.25 * robotBodyLength, 0.0); // Adjust based on the spacing between the two green parts
+	b.Scale(0.25 * robotBodyWidth, 0.1 * robotBodyLength, 0.25 * robotBodyDepth);
+	b.Primitive(PRIMITIVE_CUBE);
+	b.PopMatrix();
+
+	// Move down for the second (third part) green leg
+	b.Translate(0.0, -0.5 * robotBodyLength, 0.0);
+	// Lower leg rotation
+	b.Joint(JOINT_LOWER_LEG_LEFT, 1.0, 0.0, 0.0);
+
+	// Second green part - same size as the previous green part
+	b.PushMatrix();
+	b.SetMaterial(MATERIAL_GREEN);
+
+	b.Rotate(-15, 1.0, 0.0, 0.0); // Continue zig-zag pose
+	b.Scale(0.2 * robotBodyWidth, 0.5 * robotBodyLength, 0.2 * robotBodyDepth);
+	b.Primitive(PRIMITIVE_CUBE);
+	b.PopMatrix(); // End second green part
+
+	// Move down for ankle (adjusted to move feet up)
+	b.Translate(0.0, -0.3 * robotBodyLength, 0.0);  // Reduced from -0.5 to -0.3 for closer connection
+
+	// Ankle rotation
+	b.Joint(JOINT_ANKLE_LEFT, 1.0, 0.0, 0.0); // Rotate ankle
+
+	// Foot segment - light brown
+	b.PushMatrix();
+	b.SetMaterial(MATERIAL_LIGHT_BROWN);
+
+	// Foot base
+	b.PushMatrix();
+	b.Scale(0.4 * robotBodyDepth, 0.1 * robotBodyLength, 0.6 * robotBodyWidth); // Foot dimensions
+	b.Primitive(PRIMITIVE_CUBE);
+	b.PopMatrix(); // End foot base
+
+	// Socket where the sole meets the ground
+	b.PushMatrix();
+	b.Translate(0.0, -0.05 * robotBodyLength, 0.0);
+	socketNodes[SOCKET_FOOT_LEFT] = b.Locator();
+	b.PopMatrix();
+
+	// Add two dents in front of the foot
+	// First front dent
+	b.PushMatrix();
+	b.Translate(-0.15 * robotBodyDepth, 0.0, 0.4 * robotBodyWidth); // Move to the front-left
+	b.Scale(0.1 * robotBodyDepth, 0.1 * robotBodyLength, 0.2 * robotBodyWidth); // Small cube for the dent
+	b.Primitive(PRIMITIVE_CUBE);
+	b.PopMatrix();
+
+	// Second front dent
+	b.PushMatrix();
+	b.Translate(0.15 * robotBodyDepth, 0.0, 0.4 * robotBodyWidth); // Move to the front-right
+	b.Scale(0.1 * robotBodyDepth, 0.1 * robotBodyLength, 0.2 * robotBodyWidth); // Small cube for the dent
+	b.Primitive(PRIMITIVE_CUBE);
+	b.PopMatrix();
+
+	// Add two dents in back of the foot
+	// First back dent
+	b.PushMatrix();
+	b.Translate(-0.15 * robotBodyDepth, 0.0, -0.4 * robotBodyWidth); // Move to the back-left
+	b.Scale(0.1 * robotBodyDepth, 0.1 * robotBodyLength, 0.2 * robotBodyWidth); // Small cube for the dent
+	b.Primitive(PRIMITIVE_CUBE);
+	b.PopMatrix();
+
+	// Second back dent
+	b.PushMatrix();
+	b.Translate(0.15 * robotBodyDepth, 0.0, -0.4 * robotBodyWidth); // Move to the back-right
+	b.Scale(0.1 * robotBodyDepth, 0.1 * robotBodyLength, 0.2 * robotBodyWidth); // Small cube for the dent
+	b.Primitive(PRIMITIVE_CUBE);
+	b.PopMatrix();
+
+	b.PopMatrix(); // End left foot
+
+	b.PopMatrix(); // End left leg
+
+	// Right leg (copy of the left leg but mirrored)
+	b.PushMatrix();
+	// Move the leg lower to connect better to the body
+	b.Translate(-0.5 * robotBodyWidth, -0.7 * robotBodyLength, 0.0); // Adjust leg height
+
+	// Hip rotation
+	b.Joint(JOINT_HIP_RIGHT, 1.0, 0.0, 0.0); // Rotate hip
+
+	// Upper leg segment - beige
+	b.PushMatrix();
+	b.SetMaterial(MATERIAL_BEIGE);
+
+	b.Rotate(-15, 1.0, 0.0, 0.0); // Zig-zag pose
+	b.Scale(0.2 * robotBodyWidth, 0.5 * robotBodyLength, 0.2 * robotBodyDepth);
+	b.Primitive(PRIMITIVE_CUBE);
+	b.PopMatrix(); // End upper leg segment
+
+	// Add kneecap
+	b.PushMatrix();
+	b.SetMaterial(MATERIAL_LIGHT_BROWN);
+
+	// Adjust kneecap placement
+	b.Translate(0.0, -0.25 * robotBodyLength, 0.10 * robotBodyDepth);  // Move kneecap forward
+	b.Scale(0.25 * robotBodyWidth, 0.1 * robotBodyLength, 0.25 * robotBodyDepth);  // Adjust kneecap scale
+	b.Primitive(PRIMITIVE_CUBE);
+	b.PopMatrix();
+
+	// Move down for knee
+	b.Translate(0.0, -0.5 * robotBodyLength, 0.0);
+	// Knee rotation
+	b.Joint(JOINT_KNEE_RIGHT, 1.0, 0.0, 0.0); // Rotate knee
+
+	// Lower leg segment - green
+	b.PushMatrix();
+	b.SetMaterial(MATERIAL_GREEN);
+
+	b.Rotate(15, 1.0, 0.0, 0.0); // Zig-zag rotation
+	b.Scale(0.2 * robotBodyWidth, 0.5 * robotBodyLength, 0.2 * robotBodyDepth);
+	b.Primitive(PRIMITIVE_CUBE);
+	b.PopMatrix(); // End lower leg segment
+
+	// New kneecap between the two green parts (right leg)
+	b.PushMatrix();
+	b.SetMaterial(MATERIAL_LIGHT_BROWN);
+
+	b.Translate(0.0, -0.25 * robotBodyLength, 0.0); // Adjust for kneecap position
+	b.Scale(0.25 * robotBodyWidth, 0.1 * robotBodyLength, 0.25 * robotBodyDepth);
+	b.Primitive(PRIMITIVE_CUBE);
+	b.PopMatrix();
+
+	// Move down for the second green part (right leg)
+	b.Translate(0.0, -0.5 * robotBodyLength, 0.0);
+	// Lower leg rotation
+	b.Joint(JOINT_LOWER_LEG_RIGHT, 1.0, 0.0, 0.0);
+
+	// Second green part (right leg)
+	b.PushMatrix();
+	b.SetMaterial(MATERIAL_GREEN);
+
+	b.Rotate(-15, 1.0, 0.0, 0.0); // Continue zig-zag pose
+	b.Scale(0.2 * robotBodyWidth, 0.5 * robotBodyLength, 0.2 * robotBodyDepth);
+	b.Primitive(PRIMITIVE_CUBE);
+	b.PopMatrix(); // End second green part
+
+	// Move down for ankle (adjusted to move feet up)
+	b.Translate(0.0, -0.3 * robotBodyLength, 0.0);  // Reduced from -0.5 to -0.3 for closer connection
+
+	// Ankle rotation
+	b.Joint(JOINT_ANKLE_RIGHT, 1.0, 0.0, 0.0); // Rotate ankle
+
+	// Foot segment - light brown
+	b.PushMatrix();
+	b.SetMaterial(MATERIAL_LIGHT_BROWN);
+
+	// Foot base
+	b.PushMatrix();
+	b.Scale(0.4 * robotBodyDepth, 0.1 * robotBodyLength, 0.6 * robotBodyWidth); // Foot dimensions
+	b.Primitive(PRIMITIVE_CUBE);
+	b.PopMatrix(); // End foot base
+
+	// Socket where the sole meets the ground
+	b.PushMatrix();
+	b.Translate(0.0, -0.05 * robotBodyLength, 0.0);
+	socketNodes[SOCKET_FOOT_RIGHT] = b.Locator();
+	b.PopMatrix();
+
+	// Add two dents in front of the foot
+	// First front dent
+	b.PushMatrix();
+	b.Translate(-0.15 * robotBodyDepth, 0.0, 0.4 * robotBodyWidth); // Move to the front-left
+	b.Scale(0.1 * robotBodyDepth, 0.1 * robotBodyLength, 0.2 * robotBodyWidth); // Small cube for the dent
+	b.Primitive(PRIMITIVE_CUBE);
+	b.PopMatrix();
+
+	// Second front dent
+	b.PushMatrix();
+	b.Translate(0.15 * robotBodyDepth, 0.0, 0.4 * robotBodyWidth); // Move to the front-right
+	b.Scale(0.1 * robotBodyDepth, 0.1 * robotBodyLength, 0.2 * robotBodyWidth); // Small cube for the dent
+	b.Primitive(PRIMITIVE_CUBE);
+	b.PopMatrix();
+
+	// Add two dents in back of the foot
+	// First back dent
+	b.PushMatrix();
+	b.Translate(-0.15 * robotBodyDepth, 0.0, -0.4 * robotBodyWidth); // Move to the back-left
+	b.Scale(0.1 * robotBodyDepth, 0.1 * robotBodyLength, 0.2 * robotBodyWidth); // Small cube for the dent
+	b.Primitive(PRIMITIVE_CUBE);
+	b.PopMatrix();
+
+	// Second back dent
+	b.PushMatrix();
+	b.Translate(0.15 * robotBodyDepth, 0.0, -0.4 * robotBodyWidth); // Move to the back-right
+	b.Scale(0.1 * robotBodyDepth, 0.1 * robotBodyLength, 0.2 * robotBodyWidth); // Small cube for the dent
+	b.Primitive(PRIMITIVE_CUBE);
+	b.PopMatrix();
+
+	b.PopMatrix(); // End right foot
+
+	b.PopMatrix(); // End right leg
+}
+
+static void buildLeftArm(SceneBuilder& b, int* socketNodes)
+{
+	// Set the material for the arm (green)
+	b.SetMaterial(MATERIAL_GREEN);
+
+	b.PushMatrix();
+	// Position upper arm higher to connect with the body
+	b.Translate(0.5 * robotBodyWidth + 0.5 * upperArmWidth, 0.3 * robotBodyLength, 0.0); // Adjusted Y position to connect with body
+
+	// Draw upper arm (green part)
+	b.PushMatrix();
+	b.Scale(upperArmWidth, 0.6 * upperArmLength, upperArmWidth); // Upper part is shorter
+	b.Primitive(PRIMITIVE_CUBE);
+	b.PopMatrix();
+
+	// Add the elbow joint (grey part)
+	b.PushMatrix();
+	b.SetMaterial(MATERIAL_DARK_GREY);
+
+	// Position and scale the elbow
+	b.Translate(0.0, -0.5 * 0.6 * upperArmLength, 0.0); // Adjust based on upper arm length
+	b.Scale(1.2 * upperArmWidth, 0.1 * upperArmLength, 1.2 * upperArmWidth); // Slightly larger elbow joint
+	b.Primitive(PRIMITIVE_CUBE);  // Draw elbow
+	b.PopMatrix();
+
+	// Move down for the lower arm and translate further forward along Z-axis
+	b.Translate(0.0, -0.9 * 0.6 * upperArmLength, 1.1); // Slightly increased forward translation along the Z-axis
+
+	// Apply rotation to the lower arm for an angled effect
+	b.Rotate(-30.0, 1.0, 0.0, 0.0); // Rotate around the X-axis to make the lower arm angled
+
+	// Draw lower arm (green part)
+	b.PushMatrix();
+	b.SetMaterial(MATERIAL_GREEN);  // Set back to green for the lower arm
+
+	b.Scale(upperArmWidth, 0.6 * upperArmLength, upperArmWidth); // Lower part is also shorter
+	b.Primitive(PRIMITIVE_CUBE);
+	b.PopMatrix();
+
+	// Now draw the hand
+	b.SetMaterial(MATERIAL_DARK_GREY);
+
+	// Position the hand slightly above and more inside the lower arm
+	b.PushMatrix();
+	b.Translate(0.0, -0.35 * 0.6 * upperArmLength - 0.15, 0.0);  // Adjusted Y position to bring the hand inside the lower arm
+	socketNodes[SOCKET_HAND_LEFT] = b.Locator();  // Socket at the centre of the palm
+	b.Scale(0.7 * upperArmWidth, 0.5 * upperArmLength, 0.7 * upperArmWidth);  // Scale for the hand
+	b.Primitive(PRIMITIVE_CUBE);  // Hand (palm)
+
+	// Add the fingers
+	float fingerWidth = 0.06 * upperArmWidth; // Thicker fingers
+	float fingerLength = 0.05 * upperArmLength; // Shorter length for fingers
+
+	// Draw 5 fingers
+	for (int i = -2; i <= 2; i++) {
+		b.PushMatrix();
+		b.Translate(i * (0.12 * upperArmWidth), -0.2 * (0.3 * upperArmLength), 0.0);  // Move fingers up
+		b.Scale(fingerWidth, fingerLength, fingerWidth);  // Scale fingers to thicker and shorter size
+		b.Primitive(PRIMITIVE_CUBE);
+		b.PopMatrix();
+	}
+
+	b.PopMatrix();  // End of hand
+	b.PopMatrix();  // End of arm
+}
+
+static void buildRightArm(SceneBuilder& b, int* socketNodes)
+{
+	// Set material properties for the arm (green)
+	b.SetMaterial(MATERIAL_GREEN);
+
+	b.PushMatrix();
+
+	// Adjust translation to mirror the left arm, move it up and forward slightly
+	b.Translate(-(0.5 * robotBodyWidth + 0.5 * upperArmWidth), 0.3 * robotBodyLength, 0.2 * robotBodyDepth); // Adjust Y-value for correct height
+
+	b.Rotate(-45.0, 1.0, 0.0, 0.0); // Tilt arm forward
+
+	// Draw upper arm (green part)
+	b.PushMatrix();
+	b.Scale(upperArmWidth, 0.6 * upperArmLength, upperArmWidth); // Upper part is shorter
+	b.Primitive(PRIMITIVE_CUBE);
+	b.PopMatrix();
+
+	// Add the brown elbow joint
+	b.PushMatrix();
+	b.SetMaterial(MATERIAL_DARK_GREY);
+
+	// Position and scale the elbow
+	b.Translate(0.0, -0.5 * 0.6 * upperArmLength, 0.0); // Position the elbow under the upper arm
+	b.Scale(1.2 * upperArmWidth, 0.1 * upperArmLength, 1.2 * upperArmWidth); // Slightly larger elbow joint
+	b.Primitive(PRIMITIVE_CUBE);  // Draw elbow
+	b.PopMatrix();
+
+	// Move down for the lower arm, starting from the elbow
+	b.Translate(0.0, -0.75 * 0.8 * upperArmLength, 1.3); // Move the lower arm further forward along Z-axis
+
+	// Apply rotation to the lower arm for an angled effect
+	b.Rotate(-25.0, 1.0, 0.0, 0.0); // Rotate around the X-axis for angle
+
+	// Draw lower arm (green part)
+	b.PushMatrix();
+	b.SetMaterial(MATERIAL_GREEN);  // Set back to green for the lower arm
+
+	b.Scale(upperArmWidth, 0.7 * upperArmLength, upperArmWidth); // Same size of the lower arm
+	b.Primitive(PRIMITIVE_CUBE);
+	b.PopMatrix();
+
+	// Now handle the cannon attached to the lower arm
+	b.SetMaterial(MATERIAL_DARK_GREY);
+
+	// Position the cannon at the end of the lower arm
+	b.PushMatrix();
+	b.Translate(0.0, -0.4 * upperArmLength - 0.4 * gunLength, 0.0);  // Position cannon directly at the lower arm's end
+
+	// Apply cannon spin along its Y-axis (screw-like spin), the angle stays 0 while the cannon is not spinning
+	b.Joint(JOINT_CANNON, 0.0, 1.0, 0.0);  // Spin along the Y-axis
+
+	// Draw the gun (cannon body)
+	b.PushMatrix();
+	b.Scale(gunWidth, gunLength, gunDepth);
+	b.Primitive(PRIMITIVE_CUBE);  // Cannon body
+	b.PopMatrix();
+
+	// Draw the cannon barrel (cylinder)
+	b.PushMatrix();
+	b.Translate(0.0, -0.5 * gunLength, 0.0);  // Move to the end of the cannon
+	b.Rotate(90.0, 1.0, 0.0, 0.0);  // Align the cylinder properly
+	b.Scale(1.5, 1.5, 5.0);  // Barrel radius and length
+	b.Primitive(PRIMITIVE_BARREL);
+	b.PopMatrix();
+
+	// Socket at the open end of the barrel, 5 units past where it starts
+	b.PushMatrix();
+	b.Translate(0.0, -0.5 * gunLength - 5.0, 0.0);
+	socketNodes[SOCKET_CANNON_MUZZLE] = b.Locator();
+	b.PopMatrix();
+
+	// Draw the orange projectile inside the cannon
+	b.PushMatrix();
+	b.SetMaterial(MATERIAL_RED_ORANGE);
+	b.Translate(0.0, -2.5 * gunLength, 0.0);  // Inside the cannon
+	b.Scale(gunWidth * 0.5, gunLength * 0.1, gunDepth * 0.5);
+	b.Primitive(PRIMITIVE_CUBE);  // The orange projectile
+	b.PopMatrix();
+
+	// Draw the magazine under the cannon
+	b.PushMatrix();
+	b.Translate(0.0, -gunLength - 1.0, 0.0);  // Position magazine below the cannon
+	b.Scale(gunWidth * 0.8, gunLength * 0.4, gunDepth * 0.8);  // Scale the magazine
+	b.Primitive(PRIMITIVE_CUBE);
+	b.PopMatrix();
+
+	b.PopMatrix();  // End cannon drawing
+	b.PopMatrix();  // End arm drawing
+}
@@ -0,0 +1,119 @@
+#ifndef ROBOTMODEL_H
+#define ROBOTMODEL_H
+
+#include "SceneGraph.h"
+#include "AnimationClip.h"
+#include "Gait.h"
+
+class MaterialRegistry;
+class JobSystem;
+
+// Joints of the robot, used as indices into an array of joint angles in degrees
+enum RobotJoint {
+	JOINT_BODY,             // robotAngle, upper body rotation on the base
+	JOINT_NECK,
+	JOINT_HIP_LEFT,
+	JOINT_KNEE_LEFT,
+	JOINT_LOWER_LEG_LEFT,
+	JOINT_ANKLE_LEFT,
+	JOINT_HIP_RIGHT,
+	JOINT_KNEE_RIGHT,
+	JOINT_LOWER_LEG_RIGHT,
+	JOINT_ANKLE_RIGHT,
+	JOINT_CANNON,           // cannonSpinAngle
+	NUM_ROBOT_JOINTS
+};
+
+// Materials the robot parts are drawn with
+enum RobotMaterial {
+	MATERIAL_BEIGE,
+	MATERIAL_DARK_GREY,
+	MATERIAL_GREEN,
+	MATERIAL_LIGHT_BROWN,
+	MATERIAL_RED_ORANGE,
+	MATERIAL_WHITE,
+	MATERIAL_CYAN,
+	NUM_ROBOT_MATERIALS
+};
+
+// Shapes the robot parts are made of
+enum RobotPrimitive {
+	PRIMITIVE_CUBE,         // unit cube, like glutSolidCube(1.0)
+	PRIMITIVE_BARREL,       // open unit cylinder along +z, like gluCylinder(quad, 1.0, 1.0, 1.0, ...)
+	NUM_ROBOT_PRIMITIVES
+};
+
+// Everything that differs between two robots: the joint angles they are posed
+// with, where they stand and where they are in their animation
+struct RobotPose {
+	float joints[NUM_ROBOT_JOINTS];  // degrees, indexed by RobotJoint
+	VECTOR3D position;               // robot origin in world space
+	float heading;                   // degrees about +y
+	float walkOffset;                // seconds into the walk cycle this robot starts at
+	ClipPlayback animation;          // drives the leg joints
+};
+
+// Points on the robot other code needs in world space: where the feet meet
+// the ground, the left hand and where a shot leaves the cannon
+enum RobotSocket {
+	SOCKET_FOOT_LEFT,
+	SOCKET_FOOT_RIGHT,
+	SOCKET_HAND_LEFT,
+	SOCKET_CANNON_MUZZLE,   // barrel axis at the open end, pointing along the node's -y
+	NUM_ROBOT_SOCKETS
+};
+
+// The robot's walk, indexed by RobotJoint: the original 10 ms tick cycle of
+// 2 degrees of hip swing a tick out to +/-50 degrees and back, with the
+// knees, ankles and lower legs following at 1.5, 1 and 2 degrees
+const GaitParams& GetRobotGait();
+
+// The robot's clips. Their channels are RobotJoint and only the leg joints
+// have tracks.
+const AnimationClip* GetRobotWalkClip();   // one cycle of the gait, looping
+const AnimationClip* GetRobotStandClip();  // legs straight
+
+// Puts a robot at the origin, standing still with every joint at zero
+void InitRobotPose(RobotPose& pose);
+
+// Plays the walk from pose.walkOffset, or the stand clip, fading over fadeSeconds
+void StartRobotWalk(RobotPose& pose, float fadeSeconds);
+void StopRobotWalk(RobotPose& pose, float fadeSeconds);
+
+// Advances the robot's animation and poses its leg joints from it
+void AnimateRobot(RobotPose& pose, float seconds);
+
+// Poses robots[0..count) straight from the gait into poses, robot i at
+// time + robots[i].walkOffset with the walk blended in by weight. The gait
+// phases are evaluated a block of robots at a time in one vectorized pass.
+// jobs may be NULL to do the work on the calling thread.
+void PoseRobotsFromGait(const RobotPose* robots, int count, double time, float weight,
+	RobotPose* poses, JobSystem* jobs);
+
+// Pose a fraction t of the way from a to b, angles turning the short way round
+void BlendRobotPoses(const RobotPose& a, const RobotPose& b, float t, RobotPose& result);
+
+// Matrix placing the robot origin in the world from pose.position and pose.heading
+void GetRobotPlacement(const RobotPose& pose, MATRIX4X4& placement);
+
+// Adds the robot hierarchy to graph, rooted at the robot origin.
+// socketNodes[RobotSocket] receives the graph nodes of the sockets.
+void BuildRobotGraph(SceneGraph& graph, int* socketNodes);
+
+// Forward kinematics without GL: the world matrix of every node of graph for
+// count robots, written robot after robot into world, which must hold
+// count * graph.GetNumNodes() matrices. jobs may be NULL to do the work on
+// the calling thread.
+void ComputeRobotWorldMatrices(const SceneGraph& graph, const RobotPose* robots, int count,
+	MATRIX4X4* world, JobSystem* jobs);
+
+// World position of a socket from one robot's matrices
+inline VECTOR3D GetRobotSocketPosition(const MATRIX4X4* world, const int* socketNodes, RobotSocket socket)
+{
+	return world[socketNodes[socket]].GetTranslation();
+}
+
+// Registers the robot materials, materialIDs[RobotMaterial] receives their IDs
+void RegisterRobotMaterials(MaterialRegistry& registry, int* materialIDs);
+
+#endif	// ROBOTMODEL_H
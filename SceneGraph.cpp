@@ -0,0 +1,188 @@
+#include <math.h>
+#include <string.h>
+#include <vector>
+#include "VECTOR3D.h"
+#include "MATRIX4X4.h"
+#include "SceneGraph.h"
+
+int SceneGraph::AddNode(const SceneNode& node) {
+    nodes.push_back(node);
+    world.push_back(MATRIX4X4());
+    return (int)nodes.size() - 1;
+}
+
+void SceneGraph::Clear() {
+    nodes.clear();
+    world.clear();
+}
+
+void SceneGraph::UpdateWorldMatrices(const float* jointAngles) {
+    if (!nodes.empty())
+        ComputeWorldMatrices(jointAngles, MATRIX4X4(), &world[0]);
+}
+
+// world = parent * local * rotation(jointAngles[joint] degrees about jointAxis)
+static void ComputeNodeMatrix(const SceneNode& node, const float* jointAngles, const MATRIX4X4& parent, MATRIX4X4& world) {
+    if (node.joint >= 0) {
+        MATRIX4X4 rotation;
+        rotation.SetRotationAxis(jointAngles[node.joint], node.jointAxis);
+        world = parent * (node.local * rotation);
+    }
+    else
+        world = parent * node.local;
+}
+
+void SceneGraph::ComputeWorldMatrices(const float* jointAngles, const MATRIX4X4& placement, MATRIX4X4* world) const {
+    for (size_t i = 0; i < nodes.size(); i++) {
+        const SceneNode& node = nodes[i];
+
+        // Parents come first, so the parent's world matrix is already final
+        ComputeNodeMatrix(node, jointAngles, node.parent >= 0 ? world[node.parent] : placement, world[i]);
+    }
+}
+
+SceneGraphInstance::SceneGraphInstance() {
+    graph = NULL;
+    numRecomputed = 0;
+}
+
+void SceneGraphInstance::Init(const SceneGraph* graph) {
+    int numNodes = graph->GetNumNodes();
+    int numJoints = 0;
+
+    this->graph = graph;
+    jointNodes.clear();
+    for (int i = 0; i < numNodes; i++) {
+        int joint = graph->GetNode(i).joint;
+        if (joint < 0)
+            continue;
+        jointNodes.push_back(i);
+        if (joint >= numJoints)
+            numJoints = joint + 1;
+    }
+    world.assign(numNodes, MATRIX4X4());
+    angles.assign(numJoints, 0.0f);
+    dirty.assign(numNodes, 1);
+    recomputed.assign(numNodes, 0);
+    placement.LoadIdentity();
+    numRecomputed = 0;
+}
+
+void SceneGraphInstance::SetJointAngles(const float* jointAngles) {
+    for (size_t j = 0; j < jointNodes.size(); j++) {
+        int node = jointNodes[j];
+        if (jointAngles[graph->GetNode(node).joint] != angles[graph->GetNode(node).joint])
+            dirty[node] = 1;
+    }
+    if (!angles.empty())
+        memcpy(&angles[0], jointAngles, angles.size() * sizeof(float));
+}
+
+void SceneGraphInstance::SetPlacement(const MATRIX4X4& placement) {
+    if (placement == this->placement)
+        return;
+    this->placement = placement;
+    for (size_t i = 0; i < dirty.size(); i++) {
+        if (graph->GetNode((int)i).parent < 0)
+            dirty[i] = 1;
+    }
+}
+
+int SceneGraphInstance::Update() {
+    numRecomputed = 0;
+    for (size_t i = 0; i < world.size(); i++) {
+        const SceneNode& node = graph->GetNode((int)i);
+
+        // A node is stale if it changed itself or its parent was just recomputed
+        bool stale = dirty[i] || (node.parent >= 0 && recomputed[node.parent]);
+        dirty[i] = 0;
+        recomputed[i] = stale;
+        if (!stale)
+            continue;
+
+        const float* jointAngles = angles.empty() ? NULL : &angles[0];
+        ComputeNodeMatrix(node, jointAngles, node.parent >= 0 ? world[node.parent] : placement, world[i]);
+        numRecomputed++;
+    }
+    return numRecomputed;
+}
+
+SceneBuilder::SceneBuilder(SceneGraph& graph) {
+    this->graph = &graph;
+    current.parent = -1;
+    current.local.LoadIdentity();
+    material = -1;
+}
+
+void SceneBuilder::PushMatrix() {
+    stack.push_back(current);
+}
+
+void SceneBuilder::PopMatrix() {
+    if (stack.empty())
+        return;
+    current = stack.back();
+    stack.pop_back();
+}
+
+void SceneBuilder::Translate(float x, float y, float z) {
+    MATRIX4X4 t;
+    t.SetTranslation(VECTOR3D(x, y, z));
+    current.local *= t;
+}
+
+void SceneBuilder::Rotate(float angle, float x, float y, float z) {
+    MATRIX4X4 r;
+    r.SetRotationAxis(angle, VECTOR3D(x, y, z));
+    current.local *= r;
+}
+
+void SceneBuilder::Scale(float x, float y, float z) {
+    MATRIX4X4 s;
+    s.SetScale(VECTOR3D(x, y, z));
+    current.local *= s;
+}
+
+void SceneBuilder::SetMaterial(int material) {
+    this->material = material;
+}
+
+int SceneBuilder::Joint(int joint, float x, float y, float z) {
+    SceneNode node;
+
+    node.parent = current.parent;
+    node.local = current.local;
+    node.joint = joint;
+    node.jointAxis.Set(x, y, z);
+    node.material = -1;
+    node.primitive = -1;
+
+    // Later transforms are relative to the new node
+    current.parent = graph->AddNode(node);
+    current.local.LoadIdentity();
+    return current.parent;
+}
+
+int SceneBuilder::Primitive(int primitive) {
+    SceneNode node;
+
+    node.parent = current.parent;
+    node.local = current.local;
+    node.joint = -1;
+    node.jointAxis.LoadZero();
+    node.material = material;
+    node.primitive = primitive;
+    return graph->AddNode(node);
+}
+
+int SceneBuilder::Locator() {
+    SceneNode node;
+
+    node.parent = current.parent;
+    node.local = current.local;
+    node.joint = -1;
+    node.jointAxis.LoadZero();
+    node.material = -1;
+    node.primitive = -1;
+    return graph->AddNode(node);
+}
@@ -0,0 +1,109 @@
+#ifndef SCENEGRAPH_H
+#define SCENEGRAPH_H
+
+#include <vector>
+#include "VECTOR3D.h"
+#include "MATRIX4X4.h"
+
+// One node of a retained transform hierarchy. Matrices are column-major, the
+// layout glLoadMatrixf takes.
+struct SceneNode {
+    int parent;         // index of the parent node, -1 for a root; always lower than this node's index
+    MATRIX4X4 local;    // fixed transform relative to the parent
+    int joint;          // joint whose angle rotates this node after local, -1 for none
+    VECTOR3D jointAxis; // axis of that rotation
+    int material;       // material to draw with, -1 for none
+    int primitive;      // primitive to draw, -1 for a transform-only node
+};
+
+// A scene hierarchy stored as a flat array in parent-before-child order, so
+// every world matrix can be produced by a single front to back pass.
+class SceneGraph {
+private:
+    std::vector<SceneNode> nodes;
+    std::vector<MATRIX4X4> world;
+
+public:
+    int AddNode(const SceneNode& node);  // Returns the index of the new node
+    void Clear();
+
+    // world = parent world * local * rotation(jointAngles[joint] degrees about jointAxis)
+    void UpdateWorldMatrices(const float* jointAngles);
+
+    // The same pass into a caller's array of GetNumNodes() matrices, with
+    // placement in front of every root. Leaves the graph untouched, so any
+    // number of threads can pose their own copies of the model at once.
+    void ComputeWorldMatrices(const float* jointAngles, const MATRIX4X4& placement, MATRIX4X4* world) const;
+
+    int GetNumNodes() const { return (int)nodes.size(); }
+    const SceneNode& GetNode(int node) const { return nodes[node]; }
+    const MATRIX4X4& GetWorldMatrix(int node) const { return world[node]; }
+};
+
+// One posed copy of a SceneGraph that keeps its world matrices between
+// updates. A changed joint angle marks the nodes that joint rotates dirty, a
+// changed placement marks the roots, and Update() recomputes only those
+// nodes and their descendants. A copy that did not move costs a scan of its
+// flags and no matrix products.
+class SceneGraphInstance {
+private:
+    const SceneGraph* graph;
+    std::vector<MATRIX4X4> world;
+    std::vector<int> jointNodes;           // nodes rotated by a joint
+    std::vector<float> angles;             // joint angles the matrices were computed with
+    std::vector<unsigned char> dirty;      // changed since the last Update()
+    std::vector<unsigned char> recomputed; // recomputed by the last Update()
+    MATRIX4X4 placement;
+    int numRecomputed;
+
+public:
+    SceneGraphInstance();
+
+    // Sizes the instance for graph, every node dirty. Call again if the graph changes.
+    void Init(const SceneGraph* graph);
+
+    // jointAngles holds one angle for every joint the graph uses
+    void SetJointAngles(const float* jointAngles);
+    void SetPlacement(const MATRIX4X4& placement);
+
+    // Brings the dirty nodes and their descendants up to date, returns how many that was
+    int Update();
+
+    int GetNumRecomputed() const { return numRecomputed; }
+    bool WasRecomputed(int node) const { return recomputed[node] != 0; }
+    const MATRIX4X4& GetWorldMatrix(int node) const { return world[node]; }
+};
+
+// Builds a SceneGraph with calls that mirror the fixed-function GL ones, so
+// hierarchical drawing code can be turned into graph construction line by
+// line. Transforms accumulate until the next Joint() or Primitive() call
+// turns them into a node's local matrix. Like glMaterial, the current
+// material is not saved by PushMatrix/PopMatrix.
+class SceneBuilder {
+private:
+    struct State {
+        int parent;
+        MATRIX4X4 local;
+    };
+
+    SceneGraph* graph;
+    State current;
+    std::vector<State> stack;
+    int material;
+
+public:
+    SceneBuilder(SceneGraph& graph);
+
+    void PushMatrix();
+    void PopMatrix();
+    void Translate(float x, float y, float z);
+    void Rotate(float angle, float x, float y, float z);  // degrees, like glRotatef
+    void Scale(float x, float y, float z);
+    void SetMaterial(int material);
+
+    int Joint(int joint, float x, float y, float z);  // Starts a node rotated by a joint about (x, y, z)
+    int Primitive(int primitive);                     // Adds a drawable node under the current transform
+    int Locator();                                    // Adds a transform-only node marking a point of interest
+};
+
+#endif  // SCENEGRAPH_H
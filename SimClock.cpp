@@ -0,0 +1,34 @@
+#include "SimClock.h"
+
+SimClock::SimClock(double stepSeconds, double maxFrameSeconds) {
+    this->stepSeconds = stepSeconds;
+    this->maxFrameSeconds = maxFrameSeconds;
+    lastTime = 0.0;
+    accumulator = 0.0;
+    started = false;
+}
+
+void SimClock::Reset(double now) {
+    lastTime = now;
+    accumulator = 0.0;
+    started = true;
+}
+
+int SimClock::Advance(double now) {
+    if (!started) {
+        Reset(now);
+        return 0;
+    }
+
+    double elapsed = now - lastTime;
+    lastTime = now;
+    if (elapsed < 0.0)
+        elapsed = 0.0;
+    if (elapsed > maxFrameSeconds)
+        elapsed = maxFrameSeconds;
+
+    accumulator += elapsed;
+    int steps = (int)(accumulator / stepSeconds);
+    accumulator -= steps * stepSeconds;
+    return steps;
+}
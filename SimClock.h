@@ -0,0 +1,30 @@
+#ifndef SIMCLOCK_H
+#define SIMCLOCK_H
+
+// Turns elapsed real time into a whole number of fixed simulation steps.
+// Time left over after the last whole step is kept for the next Advance()
+// and, as GetAlpha(), says how far rendering should interpolate from the
+// previous simulation state towards the current one. So animation runs at
+// the same speed however fast or irregularly frames are drawn. A frame that
+// took longer than maxFrameSeconds only catches up that much, so a stall
+// slows the animation down briefly instead of making every later frame
+// spend its time catching up.
+class SimClock {
+private:
+    double stepSeconds;
+    double maxFrameSeconds;
+    double lastTime;
+    double accumulator;   // real time not yet turned into steps, under one step
+    bool started;
+
+public:
+    SimClock(double stepSeconds = 0.01, double maxFrameSeconds = 0.25);
+
+    void Reset(double now);   // Restarts from now with nothing accumulated
+    int Advance(double now);  // Returns the number of steps to run to catch up with now
+
+    float GetAlpha() const { return (float)(accumulator / stepSeconds); }  // 0 to 1
+    double GetStepSeconds() const { return stepSeconds; }
+};
+
+#endif  // SIMCLOCK_H
@@ -0,0 +1,459 @@
+#ifdef _WIN32
+#include <windows.h>
+#endif
+#include <GL/gl.h>
+#include <math.h>
+#include <string.h>
+#include <vector>
+#include "VECTOR3D.h"
+#include "MATRIX4X4.h"
+#include "VectorSIMD.h"
+#include "MaterialRegistry.h"
+#include "JobSystem.h"
+#include "SoftwareRasterizer.h"
+#include "Profiler.h"
+
+// Side of a screen tile in pixels, a multiple of the SIMD width
+static const int kTileSize = 64;
+
+// Meshes with fewer vertices than this are lit on the calling thread
+static const int kMinParallelVertices = 2048;
+
+SoftwareRasterizer::SoftwareRasterizer() {
+    width = height = stride = 0;
+    depth = red = green = blue = NULL;
+    pixels = NULL;
+    clearColor[0] = clearColor[1] = clearColor[2] = 0.0f;
+    tileSize = kTileSize;
+    tilesX = tilesY = 0;
+    projection.LoadIdentity();
+    numLights = 0;
+    sceneAmbient[0] = sceneAmbient[1] = sceneAmbient[2] = 0.2f;  // GL_LIGHT_MODEL_AMBIENT default
+    jobs = NULL;
+}
+
+SoftwareRasterizer::~SoftwareRasterizer() {
+    FreeBuffers();
+}
+
+void SoftwareRasterizer::FreeBuffers() {
+    delete[] depth;
+    delete[] red;
+    delete[] green;
+    delete[] blue;
+    delete[] pixels;
+    depth = red = green = blue = NULL;
+    pixels = NULL;
+}
+
+void SoftwareRasterizer::SetSize(int width, int height) {
+    if (width == this->width && height == this->height)
+        return;
+    FreeBuffers();
+    if (width <= 0 || height <= 0) {
+        this->width = this->height = stride = 0;
+        tilesX = tilesY = 0;
+        bins.clear();
+        return;
+    }
+
+#ifdef VECTOR_SIMD_WIDTH
+    int simdWidth = VECTOR_SIMD_WIDTH;
+#else
+    int simdWidth = 1;
+#endif
+    this->width = width;
+    this->height = height;
+    tilesX = (width + tileSize - 1) / tileSize;
+    tilesY = (height + tileSize - 1) / tileSize;
+
+    // Whole tiles of columns, so a SIMD group never straddles two tiles or runs off a row
+    stride = (tilesX * tileSize + simdWidth - 1) / simdWidth * simdWidth;
+    depth = new float[stride * height];
+    red = new float[stride * height];
+    green = new float[stride * height];
+    blue = new float[stride * height];
+    pixels = new unsigned char[width * height * 4];
+    bins.assign(tilesX * tilesY, std::vector<int>());
+}
+
+void SoftwareRasterizer::SetLights(const RasterLight* lights, int count, const float* sceneAmbient) {
+    numLights = count < 2 ? count : 2;
+    for (int i = 0; i < numLights; i++)
+        this->lights[i] = lights[i];
+    for (int c = 0; c < 3; c++)
+        this->sceneAmbient[c] = sceneAmbient[c];
+}
+
+void SoftwareRasterizer::Clear(float r, float g, float b) {
+    // The buffers themselves are cleared tile by tile in Finish()
+    clearColor[0] = r;
+    clearColor[1] = g;
+    clearColor[2] = b;
+    triangles.clear();
+    for (size_t t = 0; t < bins.size(); t++)
+        bins[t].clear();
+}
+
+void SoftwareRasterizer::LightVertex(const VECTOR3D& eye, const VECTOR3D& normal, const Material& material,
+    ClipVertex& out) const {
+    float color[3];
+
+    for (int c = 0; c < 3; c++)
+        color[c] = sceneAmbient[c] * material.ambient[c];
+
+    for (int i = 0; i < numLights; i++) {
+        const RasterLight& light = lights[i];
+        VECTOR3D toLight = light.position - eye;
+        toLight.Normalize();
+        float diffuse = normal.DotProduct(toLight);
+        float specular = 0.0f;
+
+        // Non-local viewer: the half vector uses a view direction of +z
+        if (diffuse > 0.0f) {
+            VECTOR3D half = toLight + VECTOR3D(0.0f, 0.0f, 1.0f);
+            half.Normalize();
+            float facing = normal.DotProduct(half);
+            if (facing > 0.0f)
+                specular = powf(facing, material.shininess);
+        }
+        else
+            diffuse = 0.0f;
+
+        for (int c = 0; c < 3; c++)
+            color[c] += light.ambient[c] * material.ambient[c] + diffuse * light.diffuse[c] * material.diffuse[c] +
+                specular * light.specular[c] * material.specular[c];
+    }
+
+    out.r = color[0] < 1.0f ? color[0] : 1.0f;
+    out.g = color[1] < 1.0f ? color[1] : 1.0f;
+    out.b = color[2] < 1.0f ? color[2] : 1.0f;
+}
+
+void SoftwareRasterizer::VertexJob(void* data, int begin, int end) {
+    PROFILE_SCOPE("SoftwareRasterizer::VertexJob");
+    VertexWork* work = (VertexWork*)data;
+    const float* e = work->modelviewProjection.entries;
+
+    for (int v = begin; v < end; v++) {
+        const float* src = work->positions + v * work->vertexStride;
+        const float* n = work->normals + v * work->vertexStride;
+        VECTOR3D position(src[0], src[1], src[2]);
+        VECTOR3D normal = work->normalX * n[0] + work->normalY * n[1] + work->normalZ * n[2];
+        normal.Normalize();  // GL_NORMALIZE
+
+        ClipVertex& out = work->out[v];
+        work->rasterizer->LightVertex(work->modelview->GetTransformedVECTOR3D(position), normal, *work->material, out);
+        out.x = e[0] * src[0] + e[4] * src[1] + e[8] * src[2] + e[12];
+        out.y = e[1] * src[0] + e[5] * src[1] + e[9] * src[2] + e[13];
+        out.z = e[2] * src[0] + e[6] * src[1] + e[10] * src[2] + e[14];
+        out.w = e[3] * src[0] + e[7] * src[1] + e[11] * src[2] + e[15];
+    }
+}
+
+void SoftwareRasterizer::DrawMesh(const MATRIX4X4& modelview, const Material& material,
+    const float* positions, const float* normals, int vertexStride, int numVertices,
+    GLenum mode, const unsigned int* indices, int numIndices) {
+    if (numVertices <= 0 || numIndices < 3 || width == 0)
+        return;
+    PROFILE_COUNT(COUNTER_VERTICES, numVertices);
+
+    // Normals go through the cofactor matrix, the normalize afterwards takes care of its scale
+    const float* m = modelview.entries;
+    VECTOR3D a(m[0], m[1], m[2]), b(m[4], m[5], m[6]), c(m[8], m[9], m[10]);
+    VertexWork work;
+    work.rasterizer = this;
+    work.modelview = &modelview;
+    work.modelviewProjection = projection * modelview;
+    work.normalX = b.CrossProduct(c);
+    work.normalY = c.CrossProduct(a);
+    work.normalZ = a.CrossProduct(b);
+    if (a.DotProduct(work.normalX) < 0.0f) {
+        work.normalX = -work.normalX;
+        work.normalY = -work.normalY;
+        work.normalZ = -work.normalZ;
+    }
+    work.material = &material;
+    work.positions = positions;
+    work.normals = normals;
+    work.vertexStride = vertexStride;
+    clipVertices.resize(numVertices);
+    work.out = &clipVertices[0];
+
+    if (jobs && numVertices >= kMinParallelVertices)
+        jobs->ParallelFor(numVertices, 0, VertexJob, &work);
+    else
+        VertexJob(&work, 0, numVertices);
+
+    if (mode != GL_TRIANGLE_STRIP) {
+        for (int i = 0; i + 2 < numIndices; i += 3)
+            ClipTriangle(clipVertices[indices[i]], clipVertices[indices[i + 1]], clipVertices[indices[i + 2]]);
+        return;
+    }
+
+    // Every other strip triangle has its first two corners swapped to keep the
+    // winding, as GL does. Degenerate joins between rows are skipped.
+    for (int i = 0; i + 2 < numIndices; i++) {
+        unsigned int a = indices[i], b = indices[i + 1], c = indices[i + 2];
+        if (a == b || b == c || a == c)
+            continue;
+        if (i & 1)
+            ClipTriangle(clipVertices[b], clipVertices[a], clipVertices[c]);
+        else
+            ClipTriangle(clipVertices[a], clipVertices[b], clipVertices[c]);
+    }
+}
+
+void SoftwareRasterizer::ClipTriangle(const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2) {
+    const ClipVertex* in[3] = { &v0, &v1, &v2 };
+    unsigned int outside = 0x3F;
+    bool behindNear = false;
+
+    // Drop triangles wholly outside one frustum plane
+    for (int i = 0; i < 3; i++) {
+        const ClipVertex& v = *in[i];
+        unsigned int code = 0;
+        if (v.x < -v.w) code |= 1;
+        if (v.x > v.w) code |= 2;
+        if (v.y < -v.w) code |= 4;
+        if (v.y > v.w) code |= 8;
+        if (v.z < -v.w) code |= 16;
+        if (v.z > v.w) code |= 32;
+        outside &= code;
+        behindNear |= (code & 16) != 0;
+    }
+    if (outside)
+        return;
+    if (!behindNear) {
+        AddTriangle(v0, v1, v2);
+        return;
+    }
+
+    // Cut off the part in front of the near plane, z = -w, leaving up to four corners
+    ClipVertex polygon[4];
+    int count = 0;
+    for (int i = 0; i < 3; i++) {
+        const ClipVertex& p = *in[i];
+        const ClipVertex& q = *in[(i + 1) % 3];
+        float dp = p.z + p.w, dq = q.z + q.w;
+        if (dp >= 0.0f)
+            polygon[count++] = p;
+        if ((dp >= 0.0f) != (dq >= 0.0f)) {
+            float t = dp / (dp - dq);
+            ClipVertex& r = polygon[count++];
+            r.x = p.x + (q.x - p.x) * t;
+            r.y = p.y + (q.y - p.y) * t;
+            r.z = p.z + (q.z - p.z) * t;
+            r.w = p.w + (q.w - p.w) * t;
+            r.r = p.r + (q.r - p.r) * t;
+            r.g = p.g + (q.g - p.g) * t;
+            r.b = p.b + (q.b - p.b) * t;
+        }
+    }
+    for (int i = 1; i + 1 < count; i++)
+        AddTriangle(polygon[0], polygon[i], polygon[i + 1]);
+}
+
+void SoftwareRasterizer::AddTriangle(const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2) {
+    const ClipVertex* v[3] = { &v0, &v1, &v2 };
+    double x[3], y[3], z[3];
+
+    // Window coordinates, y up from the bottom row like GL. The setup runs in
+    // double: near the far plane depth only changes in the fifth decimal
+    // place, and thin distant triangles lose that much to cancellation in float.
+    for (int i = 0; i < 3; i++) {
+        double invW = 1.0 / v[i]->w;
+        x[i] = (v[i]->x * invW + 1.0) * 0.5 * width;
+        y[i] = (v[i]->y * invW + 1.0) * 0.5 * height;
+        z[i] = (v[i]->z * invW + 1.0) * 0.5;
+    }
+
+    double area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+    if (fabs(area) < 1e-8)
+        return;
+
+    double minX = x[0], maxX = x[0], minY = y[0], maxY = y[0];
+    for (int i = 1; i < 3; i++) {
+        if (x[i] < minX) minX = x[i];
+        if (x[i] > maxX) maxX = x[i];
+        if (y[i] < minY) minY = y[i];
+        if (y[i] > maxY) maxY = y[i];
+    }
+    if (maxX < 0.0 || maxY < 0.0 || minX > width || minY > height)
+        return;
+
+    Triangle t;
+    t.minX = minX > 0.0 ? (int)minX : 0;
+    t.minY = minY > 0.0 ? (int)minY : 0;
+    t.maxX = maxX < width - 1 ? (int)maxX : width - 1;
+    t.maxY = maxY < height - 1 ? (int)maxY : height - 1;
+
+    // Edge i is opposite vertex i and equals area there. Flipping clockwise
+    // triangles keeps the inside positive.
+    double sign = area > 0.0 ? 1.0 : -1.0;
+    for (int i = 0; i < 3; i++) {
+        int j = (i + 1) % 3, k = (i + 2) % 3;
+        t.edgeA[i] = (float)(-(y[k] - y[j]) * sign);
+        t.edgeB[i] = (float)((x[k] - x[j]) * sign);
+        t.edgeC[i] = (float)(((y[k] - y[j]) * x[j] - (x[k] - x[j]) * y[j]) * sign);
+    }
+
+    // Each attribute plane from its differences along the edges out of vertex 0
+    double values[4][3] = {
+        { z[0], z[1], z[2] },
+        { v0.r, v1.r, v2.r },
+        { v0.g, v1.g, v2.g },
+        { v0.b, v1.b, v2.b }
+    };
+    float* planes[4] = { &t.zA, &t.rA, &t.gA, &t.bA };
+    for (int p = 0; p < 4; p++) {
+        double d1 = values[p][1] - values[p][0], d2 = values[p][2] - values[p][0];
+        double a = (d1 * (y[2] - y[0]) - d2 * (y[1] - y[0])) / area;
+        double b = (d2 * (x[1] - x[0]) - d1 * (x[2] - x[0])) / area;
+        planes[p][0] = (float)a;
+        planes[p][1] = (float)b;
+        planes[p][2] = (float)(values[p][0] - a * x[0] - b * y[0]);
+    }
+
+    int index = (int)triangles.size();
+    triangles.push_back(t);
+    for (int ty = t.minY / tileSize; ty <= t.maxY / tileSize; ty++) {
+        for (int tx = t.minX / tileSize; tx <= t.maxX / tileSize; tx++)
+            bins[ty * tilesX + tx].push_back(index);
+    }
+}
+
+void SoftwareRasterizer::RasterizeTile(int tile) {
+    int x0 = (tile % tilesX) * tileSize;
+    int y0 = (tile / tilesX) * tileSize;
+    int x1 = x0 + tileSize < width ? x0 + tileSize - 1 : width - 1;
+    int y1 = y0 + tileSize < height ? y0 + tileSize - 1 : height - 1;
+
+    for (int y = y0; y <= y1; y++) {
+        int row = y * stride;
+        for (int x = x0; x < x0 + tileSize; x++) {
+            depth[row + x] = 1.0f;
+            red[row + x] = clearColor[0];
+            green[row + x] = clearColor[1];
+            blue[row + x] = clearColor[2];
+        }
+    }
+
+    const std::vector<int>& bin = bins[tile];
+    for (size_t i = 0; i < bin.size(); i++) {
+        const Triangle& t = triangles[bin[i]];
+        int startX = t.minX > x0 ? t.minX : x0;
+        int endX = t.maxX < x1 ? t.maxX : x1;
+        int startY = t.minY > y0 ? t.minY : y0;
+        int endY = t.maxY < y1 ? t.maxY : y1;
+
+#ifdef VECTOR_SIMD_WIDTH
+        // Groups start on a multiple of the SIMD width, x0 is one too
+        startX -= (startX - x0) % VECTOR_SIMD_WIDTH;
+        float laneOffsets[VECTOR_SIMD_WIDTH];
+        for (int l = 0; l < VECTOR_SIMD_WIDTH; l++)
+            laneOffsets[l] = (float)l;
+        vfloat lanes = VLoad(laneOffsets);
+        vfloat zero = VSet(0.0f);
+        vfloat a0 = VSet(t.edgeA[0]), a1 = VSet(t.edgeA[1]), a2 = VSet(t.edgeA[2]);
+        vfloat zA = VSet(t.zA), rA = VSet(t.rA), gA = VSet(t.gA), bA = VSet(t.bA);
+
+        for (int y = startY; y <= endY; y++) {
+            float py = y + 0.5f;
+            vfloat row0 = VSet(t.edgeB[0] * py + t.edgeC[0]);
+            vfloat row1 = VSet(t.edgeB[1] * py + t.edgeC[1]);
+            vfloat row2 = VSet(t.edgeB[2] * py + t.edgeC[2]);
+            vfloat rowZ = VSet(t.zB * py + t.zC);
+            vfloat rowR = VSet(t.rB * py + t.rC);
+            vfloat rowG = VSet(t.gB * py + t.gC);
+            vfloat rowB = VSet(t.bB * py + t.bC);
+            int row = y * stride;
+
+            for (int x = startX; x <= endX; x += VECTOR_SIMD_WIDTH) {
+                vfloat px = VAdd(VSet(x + 0.5f), lanes);
+                vfloat inside = VAnd(VAnd(VGreaterEqual(VAdd(VMul(a0, px), row0), zero),
+                    VGreaterEqual(VAdd(VMul(a1, px), row1), zero)), VGreaterEqual(VAdd(VMul(a2, px), row2), zero));
+                vfloat z = VAdd(VMul(zA, px), rowZ);
+                vfloat oldZ = VLoad(depth + row + x);
+                vfloat pass = VAnd(inside, VGreater(oldZ, z));  // GL_LESS
+
+                VStore(depth + row + x, VSelect(pass, z, oldZ));
+                VStore(red + row + x, VSelect(pass, VAdd(VMul(rA, px), rowR), VLoad(red + row + x)));
+                VStore(green + row + x, VSelect(pass, VAdd(VMul(gA, px), rowG), VLoad(green + row + x)));
+                VStore(blue + row + x, VSelect(pass, VAdd(VMul(bA, px), rowB), VLoad(blue + row + x)));
+            }
+        }
+#else
+        // Same order of operations as the SIMD loop, so both give the same image
+        for (int y = startY; y <= endY; y++) {
+            float py = y + 0.5f;
+            float row0 = t.edgeB[0] * py + t.edgeC[0];
+            float row1 = t.edgeB[1] * py + t.edgeC[1];
+            float row2 = t.edgeB[2] * py + t.edgeC[2];
+            float rowZ = t.zB * py + t.zC;
+            int row = y * stride;
+
+            for (int x = startX; x <= endX; x++) {
+                float px = x + 0.5f;
+                if (t.edgeA[0] * px + row0 < 0.0f || t.edgeA[1] * px + row1 < 0.0f || t.edgeA[2] * px + row2 < 0.0f)
+                    continue;
+                float z = t.zA * px + rowZ;
+                if (!(z < depth[row + x]))
+                    continue;
+                depth[row + x] = z;
+                red[row + x] = t.rA * px + (t.rB * py + t.rC);
+                green[row + x] = t.gA * px + (t.gB * py + t.gC);
+                blue[row + x] = t.bA * px + (t.bB * py + t.bC);
+            }
+        }
+#endif
+    }
+}
+
+void SoftwareRasterizer::TileJob(void* data, int begin, int end) {
+    PROFILE_SCOPE("SoftwareRasterizer::TileJob");
+    SoftwareRasterizer* rasterizer = (SoftwareRasterizer*)data;
+    for (int tile = begin; tile < end; tile++)
+        rasterizer->RasterizeTile(tile);
+}
+
+static unsigned char ToByte(float value) {
+    if (value <= 0.0f)
+        return 0;
+    if (value >= 1.0f)
+        return 255;
+    return (unsigned char)(value * 255.0f + 0.5f);
+}
+
+void SoftwareRasterizer::ResolveJob(void* data, int begin, int end) {
+    PROFILE_SCOPE("SoftwareRasterizer::ResolveJob");
+    SoftwareRasterizer* rasterizer = (SoftwareRasterizer*)data;
+    for (int y = begin; y < end; y++) {
+        const float* r = rasterizer->red + y * rasterizer->stride;
+        const float* g = rasterizer->green + y * rasterizer->stride;
+        const float* b = rasterizer->blue + y * rasterizer->stride;
+        unsigned char* dst = rasterizer->pixels + y * rasterizer->width * 4;
+        for (int x = 0; x < rasterizer->width; x++, dst += 4) {
+            dst[0] = ToByte(r[x]);
+            dst[1] = ToByte(g[x]);
+            dst[2] = ToByte(b[x]);
+            dst[3] = 255;
+        }
+    }
+}
+
+void SoftwareRasterizer::Finish() {
+    PROFILE_SCOPE("SoftwareRasterizer::Finish");
+    if (width == 0)
+        return;
+
+    // One tile per job: how long a tile takes depends on how much of the scene lands in it
+    if (jobs) {
+        jobs->ParallelFor(tilesX * tilesY, 1, TileJob, this);
+        jobs->ParallelFor(height, 0, ResolveJob, this);
+    }
+    else {
+        TileJob(this, 0, tilesX * tilesY);
+        ResolveJob(this, 0, height);
+    }
+}
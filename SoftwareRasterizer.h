@@ -0,0 +1,125 @@
+#ifndef SOFTWARERASTERIZER_H
+#define SOFTWARERASTERIZER_H
+
+#include <vector>
+#include "VECTOR3D.h"
+#include "MATRIX4X4.h"
+#include "MaterialRegistry.h"
+
+class JobSystem;
+
+// A positional light in eye space, the values glLightfv sets
+struct RasterLight {
+    VECTOR3D position;
+    float ambient[3];
+    float diffuse[3];
+    float specular[3];
+};
+
+// Draws lit triangle meshes on the CPU, reproducing the fixed-function
+// pipeline the GL path sets up: per-vertex lighting with GL_NORMALIZE and a
+// non-local viewer, colors interpolated across each triangle (Gouraud) and a
+// GL_LESS depth test. DrawMesh() lights and projects vertices straight away
+// and bins the resulting triangles into screen tiles; Finish() then shades
+// the tiles in parallel, each thread owning whole tiles, testing several
+// pixels at once against the edge functions. Triangles in a tile keep their
+// submission order, so the image is the same for any number of threads.
+// Colors are interpolated linearly in screen space, not perspective correct.
+class SoftwareRasterizer {
+private:
+    // A vertex after lighting and projection, in clip space
+    struct ClipVertex {
+        float x, y, z, w;
+        float r, g, b;
+    };
+
+    // Each attribute as a plane a * x + b * y + c over pixel centres
+    struct Triangle {
+        float edgeA[3], edgeB[3], edgeC[3];  // inside where all three are >= 0
+        float zA, zB, zC;
+        float rA, rB, rC;
+        float gA, gB, gC;
+        float bA, bB, bC;
+        int minX, minY, maxX, maxY;          // pixel bounds, inclusive
+    };
+
+    int width, height;
+    int stride;                 // floats per buffer row, width padded to the SIMD width
+    float* depth;               // window z, 0 near to 1 far
+    float* red;                 // the color buffer as separate float planes
+    float* green;
+    float* blue;
+    unsigned char* pixels;      // RGBA bytes, rows bottom up like glReadPixels
+    float clearColor[3];
+
+    int tileSize;
+    int tilesX, tilesY;
+    std::vector<std::vector<int> > bins;  // triangle indices per tile, in submission order
+    std::vector<Triangle> triangles;
+    std::vector<ClipVertex> clipVertices;
+
+    MATRIX4X4 projection;
+    RasterLight lights[2];
+    int numLights;
+    float sceneAmbient[3];
+    JobSystem* jobs;
+
+    // What a DrawMesh() call shares with its vertex jobs
+    struct VertexWork {
+        SoftwareRasterizer* rasterizer;
+        const MATRIX4X4* modelview;
+        MATRIX4X4 modelviewProjection;
+        VECTOR3D normalX, normalY, normalZ;  // columns of the normal matrix
+        const Material* material;
+        const float* positions;
+        const float* normals;
+        int vertexStride;                    // floats from one vertex to the next
+        ClipVertex* out;
+    };
+
+    static void VertexJob(void* data, int begin, int end);
+    static void TileJob(void* data, int begin, int end);
+    static void ResolveJob(void* data, int begin, int end);
+    void LightVertex(const VECTOR3D& eye, const VECTOR3D& normal, const Material& material, ClipVertex& out) const;
+    void AddTriangle(const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2);
+    void ClipTriangle(const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2);
+    void RasterizeTile(int tile);
+    void FreeBuffers();
+
+public:
+    SoftwareRasterizer();
+    ~SoftwareRasterizer();
+
+    void SetSize(int width, int height);
+    void SetJobSystem(JobSystem* jobs) { this->jobs = jobs; }  // NULL to do everything on the calling thread
+    void SetProjection(const MATRIX4X4& projection) { this->projection = projection; }
+
+    // Up to two lights, positions already in eye space, plus the light model ambient
+    void SetLights(const RasterLight* lights, int count, const float* sceneAmbient);
+
+    // Starts a frame: clears to color and to the far depth and empties the bins
+    void Clear(float r, float g, float b);
+
+    // Draws what glDrawElements(mode) would with this modelview and material,
+    // mode GL_TRIANGLES or GL_TRIANGLE_STRIP. Vertex v's position is the 3
+    // floats at positions + v * vertexStride, its normal the same in normals.
+    void DrawMesh(const MATRIX4X4& modelview, const Material& material,
+        const float* positions, const float* normals, int vertexStride, int numVertices,
+        GLenum mode, const unsigned int* indices, int numIndices);
+
+    // Triangles from interleaved position and normal, 6 floats per vertex
+    void DrawMesh(const MATRIX4X4& modelview, const Material& material,
+        const float* vertices, int numVertices, const unsigned int* indices, int numIndices) {
+        DrawMesh(modelview, material, vertices, vertices + 3, 6, numVertices, GL_TRIANGLES, indices, numIndices);
+    }
+
+    // Shades every tile and packs the pixels
+    void Finish();
+
+    int GetWidth() const { return width; }
+    int GetHeight() const { return height; }
+    const unsigned char* GetPixels() const { return pixels; }
+    int GetNumTriangles() const { return (int)triangles.size(); }  // binned since Clear()
+};
+
+#endif  // SOFTWARERASTERIZER_H
@@ -0,0 +1,352 @@
+#ifdef _WIN32
+#include <windows.h>
+#endif
+#include <GL/gl.h>
+#include <math.h>
+#include <vector>
+#include "VECTOR3D.h"
+#include "QuadMesh.h"
+#include "Terrain.h"
+#include "Profiler.h"
+
+// Chunks that have not been drawn for this many frames give their mesh back
+static const int kChunkKeepFrames = 120;
+
+Terrain::Terrain(VECTOR3D center, float size, int chunkSize, int maxDepth, float lodFactor) {
+    // Stitching relies on coarser edge vertices landing on finer ones, so round
+    // the chunk resolution up to a power of two
+    int n = 1;
+    while (n < chunkSize)
+        n *= 2;
+
+    this->baseY = center.y;
+    this->chunkSize = n;
+    this->maxDepth = maxDepth < 0 ? 0 : maxDepth;
+    this->lodFactor = lodFactor;
+    heightFunc = NULL;
+    frame = 0;
+    numChunksDrawn = 0;
+    selectedVisible = NULL;
+    visibleCapacity = 0;
+
+    mat_ambient = VECTOR3D(0.0f, 0.0f, 0.0f);
+    mat_diffuse = VECTOR3D(0.9f, 0.5f, 0.0f);
+    mat_specular = VECTOR3D(0.0f, 0.0f, 0.0f);
+    mat_shininess = 0.0;
+    materialRegistry = NULL;
+    materialID = -1;
+
+    CreateNode(center.x - 0.5f * size, center.z - 0.5f * size, size, 0);
+}
+
+Terrain::~Terrain() {
+    for (size_t i = 0; i < nodes.size(); i++)
+        FreeChunk(nodes[i]);
+    if (selectedVisible)
+        delete[] selectedVisible;
+}
+
+void Terrain::SetHeightFunction(TerrainHeightFunc func) {
+    heightFunc = func;
+
+    // Existing chunks were built from the old heights
+    for (size_t i = 0; i < nodes.size(); i++)
+        FreeChunk(nodes[i]);
+}
+
+void Terrain::SetMaterial(VECTOR3D ambient, VECTOR3D diffuse, VECTOR3D specular, double shininess) {
+    mat_ambient = ambient;
+    mat_diffuse = diffuse;
+    mat_specular = specular;
+    mat_shininess = shininess;
+    materialRegistry = NULL;
+
+    for (size_t i = 0; i < nodes.size(); i++) {
+        if (nodes[i].mesh)
+            nodes[i].mesh->SetMaterial(ambient, diffuse, specular, shininess);
+    }
+}
+
+void Terrain::UseMaterial(MaterialRegistry* registry, int material) {
+    materialRegistry = registry;
+    materialID = material;
+
+    for (size_t i = 0; i < nodes.size(); i++) {
+        if (nodes[i].mesh)
+            nodes[i].mesh->UseMaterial(registry, material);
+    }
+}
+
+int Terrain::CreateNode(float x0, float z0, float size, int depth) {
+    TerrainNode node;
+
+    node.x0 = x0;
+    node.z0 = z0;
+    node.size = size;
+    node.depth = depth;
+    node.children[0] = node.children[1] = node.children[2] = node.children[3] = -1;
+    node.split = false;
+    node.mesh = NULL;
+    node.edgeStride[0] = node.edgeStride[1] = node.edgeStride[2] = node.edgeStride[3] = 1;
+    node.lastUsedFrame = 0;
+
+    nodes.push_back(node);
+    return (int)nodes.size() - 1;
+}
+
+float Terrain::SampleHeight(float x, float z) const {
+    return heightFunc ? heightFunc(x, z) : 0.0f;
+}
+
+void Terrain::Update(const VECTOR3D& eye) {
+    PROFILE_SCOPE("Terrain::Update");
+    frame++;
+    selected.clear();
+    SelectNodes(0, eye);
+
+    // Stitching needs the complete selection, so it runs as a second pass
+    selectedBounds.resize(selected.size());
+    for (size_t i = 0; i < selected.size(); i++) {
+        TerrainNode& node = nodes[selected[i]];
+
+        if (!node.mesh)
+            BuildChunk(node);
+        StitchChunk(node);
+        node.lastUsedFrame = frame;
+        selectedBounds[i] = node.bounds;
+    }
+
+    for (size_t i = 0; i < nodes.size(); i++) {
+        if (nodes[i].mesh && nodes[i].lastUsedFrame < frame - kChunkKeepFrames)
+            FreeChunk(nodes[i]);
+    }
+}
+
+void Terrain::SelectNodes(int node, const VECTOR3D& eye) {
+    // nodes may grow while recursing, so only index it, never keep a reference
+    float half = 0.5f * nodes[node].size;
+    VECTOR3D center(nodes[node].x0 + half, baseY, nodes[node].z0 + half);
+    center.y += SampleHeight(center.x, center.z);
+
+    float distance = (eye - center).GetLength();
+    if (nodes[node].depth >= maxDepth || distance >= lodFactor * nodes[node].size) {
+        nodes[node].split = false;
+        selected.push_back(node);
+        return;
+    }
+
+    if (nodes[node].children[0] < 0) {
+        float x0 = nodes[node].x0;
+        float z0 = nodes[node].z0;
+        int depth = nodes[node].depth + 1;
+        int c0 = CreateNode(x0, z0, half, depth);
+        int c1 = CreateNode(x0 + half, z0, half, depth);
+        int c2 = CreateNode(x0, z0 + half, half, depth);
+        int c3 = CreateNode(x0 + half, z0 + half, half, depth);
+
+        nodes[node].children[0] = c0;
+        nodes[node].children[1] = c1;
+        nodes[node].children[2] = c2;
+        nodes[node].children[3] = c3;
+    }
+
+    nodes[node].split = true;
+    for (int i = 0; i < 4; i++)
+        SelectNodes(nodes[node].children[i], eye);
+}
+
+int Terrain::LeafAt(float x, float z) const {
+    int node = 0;
+
+    if (x < nodes[0].x0 || z < nodes[0].z0 || x >= nodes[0].x0 + nodes[0].size || z >= nodes[0].z0 + nodes[0].size)
+        return -1;
+
+    while (nodes[node].split) {
+        float half = 0.5f * nodes[node].size;
+        int child = (x >= nodes[node].x0 + half ? 1 : 0) + (z >= nodes[node].z0 + half ? 2 : 0);
+        node = nodes[node].children[child];
+    }
+    return node;
+}
+
+int Terrain::LeafDepthAt(float x, float z) const {
+    int node = LeafAt(x, z);
+    return node >= 0 ? nodes[node].depth : -1;
+}
+
+bool Terrain::GetSurfaceHeight(float x, float z, float& height) const {
+    int leaf = LeafAt(x, z);
+    if (leaf < 0 || !nodes[leaf].mesh)
+        return false;
+
+    const TerrainNode& node = nodes[leaf];
+    const QuadMesh* mesh = node.mesh;
+    int n = chunkSize;
+    float step = node.size / n;
+
+    // Grid position of (x, z), rows running towards -z from the +z edge
+    float u = (x - node.x0) / step;
+    float v = (node.z0 + node.size - z) / step;
+    int col = u < n - 1 ? (int)u : n - 1;
+    int row = v < n - 1 ? (int)v : n - 1;
+    float s = u - col;
+    float t = v - row;
+
+    // Interpolate across the quad's triangle holding the point, the quads are
+    // drawn split along their (row, col) to (row + 1, col + 1) diagonal
+    int rowLength = n + 1;
+    int v00 = row * rowLength + col;
+    float h00 = mesh->GetPosition(v00).y;
+    float h11 = mesh->GetPosition(v00 + rowLength + 1).y;
+    if (s >= t) {
+        float h01 = mesh->GetPosition(v00 + 1).y;
+        height = h00 + s * (h01 - h00) + t * (h11 - h01);
+    } else {
+        float h10 = mesh->GetPosition(v00 + rowLength).y;
+        height = h00 + t * (h10 - h00) + s * (h11 - h10);
+    }
+    return true;
+}
+
+void Terrain::BuildChunk(TerrainNode& node) {
+    int n = chunkSize;
+    float step = node.size / n;
+
+    // Rows run towards -z like the original ground, so start at the +z edge
+    node.mesh = new QuadMesh(n, node.size);
+    node.mesh->InitMesh(n, VECTOR3D(node.x0, baseY, node.z0 + node.size), node.size, node.size,
+        VECTOR3D(1.0f, 0.0f, 0.0f), VECTOR3D(0.0f, 0.0f, -1.0f));
+    node.mesh->SetMaterial(mat_ambient, mat_diffuse, mat_specular, mat_shininess);
+    if (materialRegistry)
+        node.mesh->UseMaterial(materialRegistry, materialID);
+
+    if (heightFunc) {
+        std::vector<float> heights((n + 1) * (n + 1));
+
+        for (int row = 0; row <= n; row++) {
+            for (int col = 0; col <= n; col++)
+                heights[row * (n + 1) + col] = SampleHeight(node.x0 + col * step, node.z0 + node.size - row * step);
+        }
+        node.mesh->SetHeights(0, 0, n + 1, n + 1, &heights[0]);
+    }
+
+    for (int edge = 0; edge < 4; edge++)
+        node.edgeStride[edge] = 1;
+    node.mesh->GetBounds(node.bounds.min, node.bounds.max);
+}
+
+void Terrain::StitchChunk(TerrainNode& node) {
+    int n = chunkSize;
+    float half = 0.5f * node.size;
+    float nudge = 0.5f * node.size / n;
+    float probeX[4] = { node.x0 - nudge, node.x0 + node.size + nudge, node.x0 + half, node.x0 + half };
+    float probeZ[4] = { node.z0 + half, node.z0 + half, node.z0 - nudge, node.z0 + node.size + nudge };
+    std::vector<float> heights(n + 1);
+    bool stitched = false;
+
+    for (int edge = 0; edge < 4; edge++) {
+        // A coarser neighbour spans this whole edge and only has a vertex on every
+        // stride-th one of ours; the ones in between must lie on its edge
+        int neighbourDepth = LeafDepthAt(probeX[edge], probeZ[edge]);
+        int stride = 1;
+        if (neighbourDepth >= 0 && neighbourDepth < node.depth) {
+            int levels = node.depth - neighbourDepth;
+            stride = levels < 30 ? 1 << levels : n;
+            if (stride > n)
+                stride = n;
+        }
+
+        if (stride == node.edgeStride[edge])
+            continue;
+
+        EdgeHeights(node, edge, stride, &heights[0]);
+        switch (edge) {
+        case 0: node.mesh->SetHeights(0, 0, n + 1, 1, &heights[0]); break;  // column 0
+        case 1: node.mesh->SetHeights(0, n, n + 1, 1, &heights[0]); break;  // column n
+        case 2: node.mesh->SetHeights(n, 0, 1, n + 1, &heights[0]); break;  // row n
+        case 3: node.mesh->SetHeights(0, 0, 1, n + 1, &heights[0]); break;  // row 0
+        }
+        node.edgeStride[edge] = stride;
+        stitched = true;
+    }
+
+    if (stitched)
+        node.mesh->GetBounds(node.bounds.min, node.bounds.max);
+}
+
+void Terrain::EdgeHeights(const TerrainNode& node, int edge, int stride, float* heights) const {
+    int n = chunkSize;
+    float step = node.size / n;
+
+    // Sample at every stride-th vertex, in mesh row/column order
+    for (int i = 0; i <= n; i += stride) {
+        float x, z;
+        switch (edge) {
+        case 0: x = node.x0; z = node.z0 + node.size - i * step; break;
+        case 1: x = node.x0 + node.size; z = node.z0 + node.size - i * step; break;
+        case 2: x = node.x0 + i * step; z = node.z0; break;
+        default: x = node.x0 + i * step; z = node.z0 + node.size; break;
+        }
+        heights[i] = SampleHeight(x, z);
+    }
+
+    // and interpolate the rest
+    for (int i = 0; i <= n; i++) {
+        int a = (i / stride) * stride;
+        if (a == i)
+            continue;
+        float t = (float)(i - a) / stride;
+        heights[i] = heights[a] + t * (heights[a + stride] - heights[a]);
+    }
+}
+
+void Terrain::FreeChunk(TerrainNode& node) {
+    if (node.mesh)
+        delete node.mesh;
+    node.mesh = NULL;
+}
+
+// Fills selectedVisible for the chunks Update() selected
+void Terrain::CullSelected(Frustum* frustum) {
+    int count = (int)selected.size();
+
+    if (count > visibleCapacity) {
+        if (selectedVisible)
+            delete[] selectedVisible;
+        selectedVisible = new bool[count];
+        visibleCapacity = count;
+    }
+
+    if (frustum && count > 0)
+        frustum->CullBoxes(&selectedBounds[0], count, selectedVisible);
+    else {
+        for (int i = 0; i < count; i++)
+            selectedVisible[i] = true;
+    }
+}
+
+void Terrain::Draw(Frustum* frustum) {
+    PROFILE_SCOPE("Terrain::Draw");
+    CullSelected(frustum);
+
+    numChunksDrawn = 0;
+    for (int i = 0; i < (int)selected.size(); i++) {
+        if (!selectedVisible[i])
+            continue;
+        nodes[selected[i]].mesh->DrawMeshIndexed(chunkSize);
+        numChunksDrawn++;
+    }
+}
+
+void Terrain::Rasterize(SoftwareRasterizer& rasterizer, const MATRIX4X4& view, Frustum* frustum) {
+    PROFILE_SCOPE("Terrain::Rasterize");
+    CullSelected(frustum);
+
+    numChunksDrawn = 0;
+    for (int i = 0; i < (int)selected.size(); i++) {
+        if (!selectedVisible[i])
+            continue;
+        nodes[selected[i]].mesh->RasterizeIndexed(rasterizer, view, chunkSize);
+        numChunksDrawn++;
+    }
+}
@@ -0,0 +1,86 @@
+#ifndef TERRAIN_H
+#define TERRAIN_H
+
+#include <vector>
+#include "VECTOR3D.h"
+#include "QuadMesh.h"
+#include "Frustum.h"
+
+class SoftwareRasterizer;
+class MATRIX4X4;
+
+// Height of the ground above the terrain base at world position (x, z)
+typedef float (*TerrainHeightFunc)(float x, float z);
+
+// A square ground tiled into QuadMesh chunks held in a quadtree. Every chunk has
+// the same number of quads, so a chunk deeper in the tree covers less ground at
+// a finer spacing. Each frame Update() picks the chunks to draw from the camera
+// distance, which keeps the vertex count roughly constant however large the
+// terrain is, and stitches chunk edges that border a coarser chunk.
+class Terrain {
+private:
+    struct TerrainNode {
+        float x0, z0;       // corner with the smallest x and z
+        float size;         // side length in world units
+        int depth;          // 0 for the root
+        int children[4];    // indices into nodes, -1 until the node is first split
+        bool split;         // children are used instead of this node this frame
+        QuadMesh* mesh;     // only allocated while the node is drawn
+        int edgeStride[4];  // stitching the mesh edges were built with (-x, +x, -z, +z)
+        int lastUsedFrame;
+        BBox bounds;        // of the mesh, valid while mesh is allocated
+    };
+
+    std::vector<TerrainNode> nodes;
+    std::vector<int> selected;  // leaves chosen by the last Update()
+    std::vector<BBox> selectedBounds;
+    bool* selectedVisible;
+    int visibleCapacity;
+    int numChunksDrawn;
+
+    float baseY;
+    int chunkSize;      // quads per chunk side, a power of two
+    int maxDepth;
+    float lodFactor;    // a node is split while the camera is closer than lodFactor * size
+    TerrainHeightFunc heightFunc;
+    int frame;
+
+    VECTOR3D mat_ambient, mat_diffuse, mat_specular;
+    double mat_shininess;
+    MaterialRegistry* materialRegistry;  // if set, chunks bind materialID instead
+    int materialID;
+
+private:
+    int CreateNode(float x0, float z0, float size, int depth);
+    void SelectNodes(int node, const VECTOR3D& eye);
+    int LeafAt(float x, float z) const;
+    void BuildChunk(TerrainNode& node);
+    void StitchChunk(TerrainNode& node);
+    void EdgeHeights(const TerrainNode& node, int edge, int stride, float* heights) const;
+    float SampleHeight(float x, float z) const;
+    void FreeChunk(TerrainNode& node);
+    void CullSelected(Frustum* frustum);
+
+public:
+    Terrain(VECTOR3D center, float size, int chunkSize = 16, int maxDepth = 7, float lodFactor = 2.0f);
+    ~Terrain();
+
+    void SetHeightFunction(TerrainHeightFunc func);  // NULL for a flat ground
+    void SetMaterial(VECTOR3D ambient, VECTOR3D diffuse, VECTOR3D specular, double shininess);
+    void UseMaterial(MaterialRegistry* registry, int material);
+
+    void Update(const VECTOR3D& eye);  // Chooses and prepares the chunks to draw
+    void Draw(Frustum* frustum = NULL);  // Skips chunks outside frustum (world space) if given
+    void Rasterize(SoftwareRasterizer& rasterizer, const MATRIX4X4& view, Frustum* frustum = NULL);
+
+    // Queries over the chunks chosen by the last Update(). Points outside the
+    // terrain give a depth of -1 and no height.
+    int LeafDepthAt(float x, float z) const;  // quadtree depth of the chunk covering (x, z)
+    bool GetSurfaceHeight(float x, float z, float& height) const;  // world y of the ground drawn there, seams stitched
+
+    int GetNumChunksSelected() const { return (int)selected.size(); }
+    int GetNumVerticesSelected() const { return (int)selected.size() * (chunkSize + 1) * (chunkSize + 1); }
+    int GetNumChunksDrawn() const { return numChunksDrawn; }
+};
+
+#endif  // TERRAIN_H
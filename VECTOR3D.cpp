@@ -0,0 +1,113 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+//	VECTOR3D.cpp
+//	Out of line members of VECTOR3D that were declared in VECTOR3D.h but never defined
+//	Angles are in degrees, like glRotatef
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#include <math.h>
+#include "VECTOR3D.h"
+
+static const double kDegreesToRadians = 3.14159265358979323846 / 180.0;
+
+void VECTOR3D::RotateX(double angle)
+{
+	(*this) = GetRotatedX(angle);
+}
+
+VECTOR3D VECTOR3D::GetRotatedX(double angle) const
+{
+	if (angle == 0.0)
+		return (*this);
+
+	float sinAngle = (float)sin(angle * kDegreesToRadians);
+	float cosAngle = (float)cos(angle * kDegreesToRadians);
+
+	return VECTOR3D(x, y * cosAngle - z * sinAngle, y * sinAngle + z * cosAngle);
+}
+
+void VECTOR3D::RotateY(double angle)
+{
+	(*this) = GetRotatedY(angle);
+}
+
+VECTOR3D VECTOR3D::GetRotatedY(double angle) const
+{
+	if (angle == 0.0)
+		return (*this);
+
+	float sinAngle = (float)sin(angle * kDegreesToRadians);
+	float cosAngle = (float)cos(angle * kDegreesToRadians);
+
+	return VECTOR3D(x * cosAngle + z * sinAngle, y, -x * sinAngle + z * cosAngle);
+}
+
+void VECTOR3D::RotateZ(double angle)
+{
+	(*this) = GetRotatedZ(angle);
+}
+
+VECTOR3D VECTOR3D::GetRotatedZ(double angle) const
+{
+	if (angle == 0.0)
+		return (*this);
+
+	float sinAngle = (float)sin(angle * kDegreesToRadians);
+	float cosAngle = (float)cos(angle * kDegreesToRadians);
+
+	return VECTOR3D(x * cosAngle - y * sinAngle, x * sinAngle + y * cosAngle, z);
+}
+
+void VECTOR3D::RotateAxis(double angle, const VECTOR3D& axis)
+{
+	(*this) = GetRotatedAxis(angle, axis);
+}
+
+VECTOR3D VECTOR3D::GetRotatedAxis(double angle, const VECTOR3D& axis) const
+{
+	if (angle == 0.0)
+		return (*this);
+
+	VECTOR3D u = axis;
+	u.Normalize();
+
+	float sinAngle = (float)sin(angle * kDegreesToRadians);
+	float cosAngle = (float)cos(angle * kDegreesToRadians);
+	float oneMinusCos = 1.0f - cosAngle;
+
+	// Rodrigues' rotation, same result as glRotatef(angle, axis)
+	VECTOR3D rotatedX(u.x * u.x * oneMinusCos + cosAngle,
+		u.x * u.y * oneMinusCos - sinAngle * u.z,
+		u.x * u.z * oneMinusCos + sinAngle * u.y);
+	VECTOR3D rotatedY(u.x * u.y * oneMinusCos + sinAngle * u.z,
+		u.y * u.y * oneMinusCos + cosAngle,
+		u.y * u.z * oneMinusCos - sinAngle * u.x);
+	VECTOR3D rotatedZ(u.x * u.z * oneMinusCos - sinAngle * u.y,
+		u.y * u.z * oneMinusCos + sinAngle * u.x,
+		u.z * u.z * oneMinusCos + cosAngle);
+
+	return VECTOR3D(DotProduct(rotatedX), DotProduct(rotatedY), DotProduct(rotatedZ));
+}
+
+void VECTOR3D::PackTo01()
+{
+	(*this) = GetPackedTo01();
+}
+
+VECTOR3D VECTOR3D::GetPackedTo01() const
+{
+	// Map a direction from [-1,1] to [0,1], eg to store a normal as a color
+	VECTOR3D temp(*this);
+	temp.Normalize();
+	temp = temp * 0.5f + VECTOR3D(0.5f, 0.5f, 0.5f);
+	return temp;
+}
+
+bool VECTOR3D::operator==(const VECTOR3D& rhs) const
+{
+	return x == rhs.x && y == rhs.y && z == rhs.z;
+}
+
+VECTOR3D operator*(float scaleFactor, const VECTOR3D& rhs)
+{
+	return rhs * scaleFactor;
+}
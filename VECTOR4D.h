@@ -0,0 +1,112 @@
+//////////////////////////////////////////////////////////////////////////////////////////
+//	VECTOR4D.h
+//	Class declaration for a 4d vector, laid out like VECTOR3D with a w component
+//	Aligned to 16 bytes so it can be loaded straight into an SSE register
+//////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef VECTOR4D_H
+#define VECTOR4D_H
+
+#include "VECTOR3D.h"
+
+class alignas(16) VECTOR4D
+{
+public:
+	//constructors
+	VECTOR4D(void) : x(0.0f), y(0.0f), z(0.0f), w(0.0f)
+	{}
+
+	VECTOR4D(float newX, float newY, float newZ, float newW) : x(newX), y(newY), z(newZ), w(newW)
+	{}
+
+	VECTOR4D(const float* rhs) : x(*rhs), y(*(rhs + 1)), z(*(rhs + 2)), w(*(rhs + 3))
+	{}
+
+	//w defaults to 1 so a VECTOR3D converts to a point
+	VECTOR4D(const VECTOR3D& rhs, float newW = 1.0f) : x(rhs.x), y(rhs.y), z(rhs.z), w(newW)
+	{}
+
+	void Set(float newX, float newY, float newZ, float newW)
+	{
+		x = newX;	y = newY;	z = newZ;	w = newW;
+	}
+
+	void LoadZero(void)
+	{
+		x = y = z = w = 0.0f;
+	}
+	void LoadOne(void)
+	{
+		x = y = z = w = 1.0f;
+	}
+
+	//vector algebra
+	float DotProduct(const VECTOR4D& rhs) const
+	{
+		return x * rhs.x + y * rhs.y + z * rhs.z + w * rhs.w;
+	}
+
+	VECTOR4D lerp(const VECTOR4D& v2, float factor) const
+	{
+		return (*this) * (1.0f - factor) + v2 * factor;
+	}
+
+	//overloaded operators
+	VECTOR4D operator+(const VECTOR4D& rhs) const
+	{
+		return VECTOR4D(x + rhs.x, y + rhs.y, z + rhs.z, w + rhs.w);
+	}
+
+	VECTOR4D operator-(const VECTOR4D& rhs) const
+	{
+		return VECTOR4D(x - rhs.x, y - rhs.y, z - rhs.z, w - rhs.w);
+	}
+
+	VECTOR4D operator*(const float rhs) const
+	{
+		return VECTOR4D(x * rhs, y * rhs, z * rhs, w * rhs);
+	}
+
+	VECTOR4D operator/(const float rhs) const
+	{
+		return (rhs == 0.0f) ? VECTOR4D(0.0f, 0.0f, 0.0f, 0.0f) : VECTOR4D(x / rhs, y / rhs, z / rhs, w / rhs);
+	}
+
+	bool operator==(const VECTOR4D& rhs) const
+	{
+		return x == rhs.x && y == rhs.y && z == rhs.z && w == rhs.w;
+	}
+
+	bool operator!=(const VECTOR4D& rhs) const
+	{
+		return !((*this) == rhs);
+	}
+
+	VECTOR4D operator-(void) const { return VECTOR4D(-x, -y, -z, -w); }
+	VECTOR4D operator+(void) const { return *this; }
+
+	//conversions to VECTOR3D
+	VECTOR3D GetVECTOR3D() const			//drops w
+	{
+		return VECTOR3D(x, y, z);
+	}
+
+	VECTOR3D GetProjectedVECTOR3D() const	//divides by w
+	{
+		if (w == 0.0f || w == 1.0f)
+			return VECTOR3D(x, y, z);
+		float invW = 1.0f / w;
+		return VECTOR3D(x * invW, y * invW, z * invW);
+	}
+
+	//cast to pointer to a (float *) for glVertex4fv etc
+	operator float* () const { return (float*)this; }
+
+	//member variables
+	float x;
+	float y;
+	float z;
+	float w;
+};
+
+#endif	//VECTOR4D_H
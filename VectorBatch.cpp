@@ -0,0 +1,166 @@
+#include <math.h>
+#include "MATRIX4X4.h"
+#include "VectorSIMD.h"
+#include "VectorBatch.h"
+
+// Each function runs whole registers first and leaves i at the first element
+// the scalar tail loop still has to do
+#ifdef VECTOR_SIMD_WIDTH
+#define BATCH_SIMD_LOOP(i, count) for (; i + VECTOR_SIMD_WIDTH <= count; i += VECTOR_SIMD_WIDTH)
+#endif
+
+void BatchAdd(int count,
+    const float* ax, const float* ay, const float* az,
+    const float* bx, const float* by, const float* bz,
+    float* rx, float* ry, float* rz) {
+    int i = 0;
+
+#ifdef VECTOR_SIMD_WIDTH
+    BATCH_SIMD_LOOP(i, count) {
+        VStore(rx + i, VAdd(VLoad(ax + i), VLoad(bx + i)));
+        VStore(ry + i, VAdd(VLoad(ay + i), VLoad(by + i)));
+        VStore(rz + i, VAdd(VLoad(az + i), VLoad(bz + i)));
+    }
+#endif
+    for (; i < count; i++) {
+        rx[i] = ax[i] + bx[i];
+        ry[i] = ay[i] + by[i];
+        rz[i] = az[i] + bz[i];
+    }
+}
+
+void BatchScale(int count,
+    const float* ax, const float* ay, const float* az, float scale,
+    float* rx, float* ry, float* rz) {
+    int i = 0;
+
+#ifdef VECTOR_SIMD_WIDTH
+    vfloat s = VSet(scale);
+    BATCH_SIMD_LOOP(i, count) {
+        VStore(rx + i, VMul(VLoad(ax + i), s));
+        VStore(ry + i, VMul(VLoad(ay + i), s));
+        VStore(rz + i, VMul(VLoad(az + i), s));
+    }
+#endif
+    for (; i < count; i++) {
+        rx[i] = ax[i] * scale;
+        ry[i] = ay[i] * scale;
+        rz[i] = az[i] * scale;
+    }
+}
+
+void BatchDot(int count,
+    const float* ax, const float* ay, const float* az,
+    const float* bx, const float* by, const float* bz,
+    float* result) {
+    int i = 0;
+
+#ifdef VECTOR_SIMD_WIDTH
+    BATCH_SIMD_LOOP(i, count) {
+        VStore(result + i, VDot(VLoad(ax + i), VLoad(ay + i), VLoad(az + i),
+            VLoad(bx + i), VLoad(by + i), VLoad(bz + i)));
+    }
+#endif
+    for (; i < count; i++)
+        result[i] = (ax[i] * bx[i] + ay[i] * by[i]) + az[i] * bz[i];
+}
+
+void BatchCross(int count,
+    const float* ax, const float* ay, const float* az,
+    const float* bx, const float* by, const float* bz,
+    float* rx, float* ry, float* rz) {
+    int i = 0;
+
+#ifdef VECTOR_SIMD_WIDTH
+    BATCH_SIMD_LOOP(i, count) {
+        vfloat cx, cy, cz;
+        VCross(VLoad(ax + i), VLoad(ay + i), VLoad(az + i), VLoad(bx + i), VLoad(by + i), VLoad(bz + i),
+            cx, cy, cz);
+        VStore(rx + i, cx);
+        VStore(ry + i, cy);
+        VStore(rz + i, cz);
+    }
+#endif
+    for (; i < count; i++) {
+        float x = ay[i] * bz[i] - az[i] * by[i];
+        float y = az[i] * bx[i] - ax[i] * bz[i];
+        float z = ax[i] * by[i] - ay[i] * bx[i];
+        rx[i] = x;
+        ry[i] = y;
+        rz[i] = z;
+    }
+}
+
+void BatchNormalize(int count,
+    const float* ax, const float* ay, const float* az,
+    float* rx, float* ry, float* rz) {
+    int i = 0;
+
+#ifdef VECTOR_SIMD_WIDTH
+    BATCH_SIMD_LOOP(i, count) {
+        vfloat x = VLoad(ax + i), y = VLoad(ay + i), z = VLoad(az + i);
+        VNormalize(x, y, z);
+        VStore(rx + i, x);
+        VStore(ry + i, y);
+        VStore(rz + i, z);
+    }
+#endif
+    for (; i < count; i++) {
+        float x = ax[i], y = ay[i], z = az[i];
+        float len2 = (x * x + y * y) + z * z;
+        float inv = len2 > 0.0f ? 1.0f / sqrtf(len2) : 0.0f;
+        rx[i] = x * inv;
+        ry[i] = y * inv;
+        rz[i] = z * inv;
+    }
+}
+
+void BatchLerp(int count,
+    const float* ax, const float* ay, const float* az,
+    const float* bx, const float* by, const float* bz, float factor,
+    float* rx, float* ry, float* rz) {
+    int i = 0;
+
+#ifdef VECTOR_SIMD_WIDTH
+    vfloat f = VSet(factor);
+    BATCH_SIMD_LOOP(i, count) {
+        vfloat x = VLoad(ax + i), y = VLoad(ay + i), z = VLoad(az + i);
+        VStore(rx + i, VAdd(x, VMul(VSub(VLoad(bx + i), x), f)));
+        VStore(ry + i, VAdd(y, VMul(VSub(VLoad(by + i), y), f)));
+        VStore(rz + i, VAdd(z, VMul(VSub(VLoad(bz + i), z), f)));
+    }
+#endif
+    for (; i < count; i++) {
+        rx[i] = ax[i] + (bx[i] - ax[i]) * factor;
+        ry[i] = ay[i] + (by[i] - ay[i]) * factor;
+        rz[i] = az[i] + (bz[i] - az[i]) * factor;
+    }
+}
+
+void BatchTransformPoints(int count, const MATRIX4X4& m,
+    const float* ax, const float* ay, const float* az,
+    float* rx, float* ry, float* rz) {
+    const float* e = m.entries;
+    int i = 0;
+
+#ifdef VECTOR_SIMD_WIDTH
+    // One register per matrix entry, each lane a different point
+    vfloat m0 = VSet(e[0]), m1 = VSet(e[1]), m2 = VSet(e[2]);
+    vfloat m4 = VSet(e[4]), m5 = VSet(e[5]), m6 = VSet(e[6]);
+    vfloat m8 = VSet(e[8]), m9 = VSet(e[9]), m10 = VSet(e[10]);
+    vfloat m12 = VSet(e[12]), m13 = VSet(e[13]), m14 = VSet(e[14]);
+
+    BATCH_SIMD_LOOP(i, count) {
+        vfloat x = VLoad(ax + i), y = VLoad(ay + i), z = VLoad(az + i);
+        VStore(rx + i, VAdd(VAdd(VMul(m0, x), VMul(m4, y)), VAdd(VMul(m8, z), m12)));
+        VStore(ry + i, VAdd(VAdd(VMul(m1, x), VMul(m5, y)), VAdd(VMul(m9, z), m13)));
+        VStore(rz + i, VAdd(VAdd(VMul(m2, x), VMul(m6, y)), VAdd(VMul(m10, z), m14)));
+    }
+#endif
+    for (; i < count; i++) {
+        float x = ax[i], y = ay[i], z = az[i];
+        rx[i] = (e[0] * x + e[4] * y) + (e[8] * z + e[12]);
+        ry[i] = (e[1] * x + e[5] * y) + (e[9] * z + e[13]);
+        rz[i] = (e[2] * x + e[6] * y) + (e[10] * z + e[14]);
+    }
+}
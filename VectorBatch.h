@@ -0,0 +1,52 @@
+#ifndef VECTORBATCH_H
+#define VECTORBATCH_H
+
+#include "MATRIX4X4.h"
+
+// VECTOR3D operations over count vectors at once, stored as separate x, y and
+// z float arrays (the layout QuadMesh keeps its positions and normals in).
+// Every function works one vector at a time in order, so the results may be
+// written over either input. Any count is fine: the part that does not fill a
+// whole SSE/AVX register is done with the same arithmetic in scalar code, so
+// every element gets the same result whichever path it takes.
+
+// r = a + b
+void BatchAdd(int count,
+    const float* ax, const float* ay, const float* az,
+    const float* bx, const float* by, const float* bz,
+    float* rx, float* ry, float* rz);
+
+// r = a * scale
+void BatchScale(int count,
+    const float* ax, const float* ay, const float* az, float scale,
+    float* rx, float* ry, float* rz);
+
+// result[i] = a[i] . b[i]
+void BatchDot(int count,
+    const float* ax, const float* ay, const float* az,
+    const float* bx, const float* by, const float* bz,
+    float* result);
+
+// r = a x b
+void BatchCross(int count,
+    const float* ax, const float* ay, const float* az,
+    const float* bx, const float* by, const float* bz,
+    float* rx, float* ry, float* rz);
+
+// r = a / |a|, zero-length vectors stay zero
+void BatchNormalize(int count,
+    const float* ax, const float* ay, const float* az,
+    float* rx, float* ry, float* rz);
+
+// r = a + (b - a) * factor
+void BatchLerp(int count,
+    const float* ax, const float* ay, const float* az,
+    const float* bx, const float* by, const float* bz, float factor,
+    float* rx, float* ry, float* rz);
+
+// r = m * (a, 1), the affine part of m applied to points
+void BatchTransformPoints(int count, const MATRIX4X4& m,
+    const float* ax, const float* ay, const float* az,
+    float* rx, float* ry, float* rz);
+
+#endif  // VECTORBATCH_H
@@ -0,0 +1,74 @@
+#ifndef VECTORSIMD_H
+#define VECTORSIMD_H
+
+// Thin wrappers over the widest vector unit the compiler is targeting, shared
+// by the code that works on separate x/y/z float arrays. VECTOR_SIMD_WIDTH is
+// the number of floats per register, and is left undefined when there is no
+// vector unit so callers fall back to their scalar loops.
+#if defined(__AVX__)
+#include <immintrin.h>
+#define VECTOR_SIMD_WIDTH 8
+typedef __m256 vfloat;
+static inline vfloat VLoad(const float* p) { return _mm256_loadu_ps(p); }
+static inline void VStore(float* p, vfloat a) { _mm256_storeu_ps(p, a); }
+static inline vfloat VSet(float a) { return _mm256_set1_ps(a); }
+static inline vfloat VAdd(vfloat a, vfloat b) { return _mm256_add_ps(a, b); }
+static inline vfloat VSub(vfloat a, vfloat b) { return _mm256_sub_ps(a, b); }
+static inline vfloat VMul(vfloat a, vfloat b) { return _mm256_mul_ps(a, b); }
+static inline vfloat VDiv(vfloat a, vfloat b) { return _mm256_div_ps(a, b); }
+static inline vfloat VSqrt(vfloat a) { return _mm256_sqrt_ps(a); }
+static inline vfloat VAnd(vfloat a, vfloat b) { return _mm256_and_ps(a, b); }
+static inline vfloat VGreater(vfloat a, vfloat b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+static inline vfloat VGreaterEqual(vfloat a, vfloat b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+static inline vfloat VSelect(vfloat mask, vfloat a, vfloat b) { return _mm256_blendv_ps(b, a, mask); }
+static inline vfloat VMin(vfloat a, vfloat b) { return _mm256_min_ps(a, b); }
+static inline vfloat VFloor(vfloat a) { return _mm256_floor_ps(a); }
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define VECTOR_SIMD_WIDTH 4
+typedef __m128 vfloat;
+static inline vfloat VLoad(const float* p) { return _mm_loadu_ps(p); }
+static inline void VStore(float* p, vfloat a) { _mm_storeu_ps(p, a); }
+static inline vfloat VSet(float a) { return _mm_set1_ps(a); }
+static inline vfloat VAdd(vfloat a, vfloat b) { return _mm_add_ps(a, b); }
+static inline vfloat VSub(vfloat a, vfloat b) { return _mm_sub_ps(a, b); }
+static inline vfloat VMul(vfloat a, vfloat b) { return _mm_mul_ps(a, b); }
+static inline vfloat VDiv(vfloat a, vfloat b) { return _mm_div_ps(a, b); }
+static inline vfloat VSqrt(vfloat a) { return _mm_sqrt_ps(a); }
+static inline vfloat VAnd(vfloat a, vfloat b) { return _mm_and_ps(a, b); }
+static inline vfloat VGreater(vfloat a, vfloat b) { return _mm_cmpgt_ps(a, b); }
+static inline vfloat VGreaterEqual(vfloat a, vfloat b) { return _mm_cmpge_ps(a, b); }
+static inline vfloat VSelect(vfloat mask, vfloat a, vfloat b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+static inline vfloat VMin(vfloat a, vfloat b) { return _mm_min_ps(a, b); }
+static inline vfloat VFloor(vfloat a) {
+    // SSE2 only truncates, step down by one where that rounded a negative value up
+    vfloat t = _mm_cvtepi32_ps(_mm_cvttps_epi32(a));
+    return _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, a), _mm_set1_ps(1.0f)));
+}
+#endif
+
+#ifdef VECTOR_SIMD_WIDTH
+// Three-component helpers on whole registers, one vector per lane
+
+static inline vfloat VDot(vfloat ax, vfloat ay, vfloat az, vfloat bx, vfloat by, vfloat bz) {
+    return VAdd(VAdd(VMul(ax, bx), VMul(ay, by)), VMul(az, bz));
+}
+
+static inline void VCross(vfloat ax, vfloat ay, vfloat az, vfloat bx, vfloat by, vfloat bz,
+    vfloat& cx, vfloat& cy, vfloat& cz) {
+    cx = VSub(VMul(ay, bz), VMul(az, by));
+    cy = VSub(VMul(az, bx), VMul(ax, bz));
+    cz = VSub(VMul(ax, by), VMul(ay, bx));
+}
+
+// Normalizes (x, y, z) in place, leaving zero-length lanes at zero
+static inline void VNormalize(vfloat& x, vfloat& y, vfloat& z) {
+    vfloat len2 = VDot(x, y, z, x, y, z);
+    vfloat inv = VAnd(VGreater(len2, VSet(0.0f)), VDiv(VSet(1.0f), VSqrt(len2)));
+    x = VMul(x, inv);
+    y = VMul(y, inv);
+    z = VMul(z, inv);
+}
+#endif
+
+#endif  // VECTORSIMD_H
@@ -0,0 +1,553 @@
+// Microbenchmarks for the math, mesh, animation, kinematics and crowd code the
+// program spends its CPU time in, run without a window or GL context. Each
+// benchmark is timed over several samples, each long enough to swamp the
+// clock, and the results are written as JSON (default) or CSV so runs can be
+// compared release to release:
+//
+//   robot3d_bench [--csv] [--out FILE] [--filter TEXT] [--min-time SECONDS] [--max-threads N]
+//
+// Benchmarks of code that can run on a JobSystem are repeated for 1, 2, 4, ...
+// threads up to the hardware thread count or --max-threads.
+//
+// Build with "make bench" from the repository root.
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+#include <GL/gl.h>
+#include "VECTOR3D.h"
+#include "MATRIX4X4.h"
+#include "VectorBatch.h"
+#include "VectorSIMD.h"
+#include "QuadMesh.h"
+#include "AnimationClip.h"
+#include "Gait.h"
+#include "SceneGraph.h"
+#include "RobotModel.h"
+#include "PrimitiveCache.h"
+#include "RobotCrowd.h"
+#include "JobSystem.h"
+
+// Timed runs per benchmark, the median is reported
+static const int kNumSamples = 7;
+
+// Results the compiler must not optimize away are summed into this
+static volatile float benchSink;
+
+// Runs a benchmark's operation count times
+typedef void (*BenchFunc)(void* data, long long count);
+
+struct BenchResult {
+    std::string name;
+    int param;            // grid size or robot count, 0 when the benchmark has none
+    int threads;          // JobSystem threads, 1 for code run on the calling thread alone
+    int itemsPerOp;       // vectors, vertices or robots one operation handles
+    long long iterations; // operations per sample
+    double nsPerOp;       // median over the samples
+    double nsPerOpMin;
+    double nsPerOpMax;
+};
+
+struct BenchOptions {
+    double minSeconds;    // total time to spend timing each benchmark
+    const char* filter;   // only run benchmarks whose name contains this
+    int maxThreads;       // largest thread count the threaded benchmarks are run with
+};
+
+static std::vector<BenchResult> results;
+static BenchOptions options;
+
+static double SecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Doubles the operation count until one run fills its share of minSeconds,
+// then times kNumSamples runs of that many operations
+static void RunBenchmark(const char* name, int param, int threads, int itemsPerOp, BenchFunc func, void* data) {
+    if (options.filter && !strstr(name, options.filter))
+        return;
+
+    double sampleSeconds = options.minSeconds / kNumSamples;
+    long long count = 1;
+    func(data, 1);  // Warm up caches and lazily built state
+    for (;;) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        func(data, count);
+        double seconds = SecondsSince(start);
+        if (seconds >= sampleSeconds || count >= (1LL << 40))
+            break;
+        // Aim a little past the target so the loop ends in one or two more steps
+        long long next = seconds > 0.0 ? (long long)(count * sampleSeconds * 1.2 / seconds) : count * 2;
+        count = next > count * 100 ? count * 100 : (next > count ? next : count * 2);
+    }
+
+    double samples[kNumSamples];
+    for (int s = 0; s < kNumSamples; s++) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        func(data, count);
+        samples[s] = SecondsSince(start) * 1e9 / count;
+    }
+    std::sort(samples, samples + kNumSamples);
+
+    BenchResult result;
+    result.name = name;
+    result.param = param;
+    result.threads = threads;
+    result.itemsPerOp = itemsPerOp;
+    result.iterations = count;
+    result.nsPerOp = samples[kNumSamples / 2];
+    result.nsPerOpMin = samples[0];
+    result.nsPerOpMax = samples[kNumSamples - 1];
+    results.push_back(result);
+    fprintf(stderr, "%-36s %6d %3d thr %14.2f ns/op %12.3f ns/item\n", name, param, threads,
+        result.nsPerOp, result.nsPerOp / itemsPerOp);
+}
+
+// 1, 2, 4, ... up to options.maxThreads, which is included even if it is not a power of two
+static std::vector<int> GetThreadCounts() {
+    std::vector<int> counts;
+    for (int threads = 1; threads < options.maxThreads; threads *= 2)
+        counts.push_back(threads);
+    counts.push_back(options.maxThreads);
+    return counts;
+}
+
+// NULL for one thread, so that case measures the plain single-threaded path
+static JobSystem* CreateJobSystem(int threads) {
+    return threads > 1 ? new JobSystem(threads) : NULL;
+}
+
+// VECTOR3D ---------------------------------------------------------------
+
+// Inputs cycle through a small table so they stay in L1 and the loop measures the arithmetic
+static const int kNumVectors = 1024;
+
+struct VectorData {
+    VECTOR3D a[kNumVectors];
+    VECTOR3D b[kNumVectors];
+    VECTOR3D out[kNumVectors];
+    float t[kNumVectors];
+    float x[kNumVectors], y[kNumVectors], z[kNumVectors];
+    float bx[kNumVectors], by[kNumVectors], bz[kNumVectors];
+    float rx[kNumVectors], ry[kNumVectors], rz[kNumVectors];
+};
+
+static float RandomFloat(float lo, float hi) {
+    return lo + (hi - lo) * (rand() / (float)RAND_MAX);
+}
+
+static void InitVectorData(VectorData& data) {
+    for (int i = 0; i < kNumVectors; i++) {
+        data.a[i].Set(RandomFloat(-10.0f, 10.0f), RandomFloat(-10.0f, 10.0f), RandomFloat(-10.0f, 10.0f));
+        data.b[i].Set(RandomFloat(-10.0f, 10.0f), RandomFloat(-10.0f, 10.0f), RandomFloat(-10.0f, 10.0f));
+        data.t[i] = RandomFloat(0.0f, 1.0f);
+        data.x[i] = data.a[i].x;
+        data.y[i] = data.a[i].y;
+        data.z[i] = data.a[i].z;
+        data.bx[i] = data.b[i].x;
+        data.by[i] = data.b[i].y;
+        data.bz[i] = data.b[i].z;
+    }
+}
+
+static void CrossProductBench(void* p, long long count) {
+    VectorData* data = (VectorData*)p;
+    for (long long n = 0; n < count; n++) {
+        int i = (int)(n & (kNumVectors - 1));
+        data->out[i] = data->a[i].CrossProduct(data->b[i]);
+    }
+    benchSink = benchSink + data->out[0].x;
+}
+
+static void NormalizeBench(void* p, long long count) {
+    VectorData* data = (VectorData*)p;
+    for (long long n = 0; n < count; n++) {
+        int i = (int)(n & (kNumVectors - 1));
+        data->out[i] = data->a[i];
+        data->out[i].Normalize();
+    }
+    benchSink = benchSink + data->out[0].x;
+}
+
+static void LerpBench(void* p, long long count) {
+    VectorData* data = (VectorData*)p;
+    for (long long n = 0; n < count; n++) {
+        int i = (int)(n & (kNumVectors - 1));
+        data->out[i] = data->a[i].lerp(data->b[i], data->t[i]);
+    }
+    benchSink = benchSink + data->out[0].x;
+}
+
+// The structure-of-arrays versions QuadMesh uses, kNumVectors per operation
+static void BatchCrossBench(void* p, long long count) {
+    VectorData* data = (VectorData*)p;
+    for (long long n = 0; n < count; n++)
+        BatchCross(kNumVectors, data->x, data->y, data->z, data->bx, data->by, data->bz, data->rx, data->ry, data->rz);
+    benchSink = benchSink + data->rx[0];
+}
+
+static void BatchNormalizeBench(void* p, long long count) {
+    VectorData* data = (VectorData*)p;
+    for (long long n = 0; n < count; n++)
+        BatchNormalize(kNumVectors, data->x, data->y, data->z, data->rx, data->ry, data->rz);
+    benchSink = benchSink + data->rx[0];
+}
+
+static void RunVectorBenchmarks() {
+    VectorData* data = new VectorData;
+    InitVectorData(*data);
+    RunBenchmark("vector3d.cross_product", 0, 1, 1, CrossProductBench, data);
+    RunBenchmark("vector3d.normalize", 0, 1, 1, NormalizeBench, data);
+    RunBenchmark("vector3d.lerp", 0, 1, 1, LerpBench, data);
+    RunBenchmark("vector_batch.cross_product", kNumVectors, 1, kNumVectors, BatchCrossBench, data);
+    RunBenchmark("vector_batch.normalize", kNumVectors, 1, kNumVectors, BatchNormalizeBench, data);
+    delete data;
+}
+
+// QuadMesh ---------------------------------------------------------------
+
+struct MeshData {
+    QuadMesh* mesh;
+    int meshSize;
+    JobSystem* jobs;
+};
+
+static void InitMeshBench(void* p, long long count) {
+    MeshData* data = (MeshData*)p;
+    for (long long n = 0; n < count; n++)
+        data->mesh->InitMesh(data->meshSize, VECTOR3D(-8.0f, 0.0f, 8.0f), 16.0, 16.0,
+            VECTOR3D(1.0f, 0.0f, 0.0f), VECTOR3D(0.0f, 0.0f, -1.0f));
+    benchSink = benchSink + data->mesh->GetPosition(0).x;
+}
+
+static void ComputeNormalsBench(void* p, long long count) {
+    MeshData* data = (MeshData*)p;
+    for (long long n = 0; n < count; n++)
+        data->mesh->ComputeNormals(data->jobs);
+    benchSink = benchSink + data->mesh->GetNormal(0).y;
+}
+
+static void RunMeshBenchmarks() {
+    static const int gridSizes[] = { 16, 32, 64, 128, 256, 2048 };
+    std::vector<int> threadCounts = GetThreadCounts();
+
+    for (size_t g = 0; g < sizeof(gridSizes) / sizeof(gridSizes[0]); g++) {
+        MeshData data;
+        data.meshSize = gridSizes[g];
+        data.jobs = NULL;
+        data.mesh = new QuadMesh(data.meshSize, 16.0f);
+        int numVertices = (data.meshSize + 1) * (data.meshSize + 1);
+
+        RunBenchmark("quadmesh.init_mesh", data.meshSize, 1, numVertices, InitMeshBench, &data);
+
+        // Normals of a bumpy grid, a flat one would be a best case for nothing
+        InitMeshBench(&data, 1);
+        std::vector<float> heights(numVertices);
+        for (int v = 0; v < numVertices; v++)
+            heights[v] = RandomFloat(0.0f, 1.0f);
+        data.mesh->SetHeights(0, 0, data.meshSize + 1, data.meshSize + 1, &heights[0]);
+        for (size_t t = 0; t < threadCounts.size(); t++) {
+            data.jobs = CreateJobSystem(threadCounts[t]);
+            RunBenchmark("quadmesh.compute_normals", data.meshSize, threadCounts[t], numVertices, ComputeNormalsBench, &data);
+            delete data.jobs;
+            data.jobs = NULL;
+        }
+
+        delete data.mesh;
+    }
+}
+
+// Animation --------------------------------------------------------------
+
+struct AnimationData {
+    RobotPose pose;
+    std::vector<float> times;
+    std::vector<float> swings;
+    std::vector<RobotPose> crowd;
+};
+
+// One 10 ms simulation step of a walking robot: clip playback and blending
+static void AnimateRobotBench(void* p, long long count) {
+    AnimationData* data = (AnimationData*)p;
+    for (long long n = 0; n < count; n++)
+        AnimateRobot(data->pose, 0.01f);
+    benchSink = benchSink + data->pose.joints[JOINT_HIP_LEFT];
+}
+
+// The crowd's pose update: gait phases in one vectorized pass, then the joints of each robot
+static void CrowdGaitBench(void* p, long long count) {
+    AnimationData* data = (AnimationData*)p;
+    const GaitParams& gait = GetRobotGait();
+    int numRobots = (int)data->crowd.size();
+
+    for (long long n = 0; n < count; n++) {
+        for (int i = 0; i < numRobots; i++)
+            data->times[i] = n * 0.01f + data->crowd[i].walkOffset;
+        EvaluateGaitBatch(gait, numRobots, &data->times[0], &data->swings[0]);
+        for (int i = 0; i < numRobots; i++)
+            ApplyGaitSwing(gait, data->swings[i], 1.0f, data->crowd[i].joints);
+    }
+    benchSink = benchSink + data->crowd[0].joints[JOINT_HIP_LEFT];
+}
+
+static void RunAnimationBenchmarks() {
+    const int numRobots = 1024;
+    AnimationData data;
+
+    InitRobotPose(data.pose);
+    StartRobotWalk(data.pose, 0.25f);
+    RunBenchmark("animation.animate_robot", 0, 1, 1, AnimateRobotBench, &data);
+
+    data.crowd.resize(numRobots);
+    data.times.resize(numRobots);
+    data.swings.resize(numRobots);
+    for (int i = 0; i < numRobots; i++) {
+        InitRobotPose(data.crowd[i]);
+        data.crowd[i].walkOffset = (i % 50) * 0.01f;
+    }
+    RunBenchmark("animation.crowd_gait", numRobots, 1, numRobots, CrowdGaitBench, &data);
+}
+
+// Kinematics -------------------------------------------------------------
+
+struct KinematicsData {
+    SceneGraph graph;
+    JobSystem* jobs;
+    int socketNodes[NUM_ROBOT_SOCKETS];
+    std::vector<RobotPose> robots;
+    std::vector<MATRIX4X4> world;
+    SceneGraphInstance instance;
+    float jointAngles[NUM_ROBOT_JOINTS];
+};
+
+// Every node's world matrix for one robot
+static void SceneGraphBench(void* p, long long count) {
+    KinematicsData* data = (KinematicsData*)p;
+    MATRIX4X4 placement;
+    GetRobotPlacement(data->robots[0], placement);
+    for (long long n = 0; n < count; n++)
+        data->graph.ComputeWorldMatrices(data->robots[0].joints, placement, &data->world[0]);
+    benchSink = benchSink + data->world[data->socketNodes[SOCKET_CANNON_MUZZLE]].entries[13];
+}
+
+// The batched path the crowd and projectile code use, then each robot's
+// muzzle read the way projectile spawning would
+static void RobotBatchBench(void* p, long long count) {
+    KinematicsData* data = (KinematicsData*)p;
+    int numRobots = (int)data->robots.size();
+    int numNodes = data->graph.GetNumNodes();
+    float muzzleHeight = 0.0f;
+
+    for (long long n = 0; n < count; n++) {
+        ComputeRobotWorldMatrices(data->graph, &data->robots[0], numRobots, &data->world[0], data->jobs);
+        for (int i = 0; i < numRobots; i++)
+            muzzleHeight += GetRobotSocketPosition(&data->world[i * numNodes], data->socketNodes, SOCKET_CANNON_MUZZLE).y;
+    }
+    benchSink = benchSink + muzzleHeight;
+}
+
+// A cached instance where only the cannon turns between updates
+static void InstanceUpdateBench(void* p, long long count) {
+    KinematicsData* data = (KinematicsData*)p;
+    for (long long n = 0; n < count; n++) {
+        data->jointAngles[JOINT_CANNON] = (float)(n % 360);
+        data->instance.SetJointAngles(data->jointAngles);
+        data->instance.Update();
+    }
+    benchSink = benchSink + data->instance.GetWorldMatrix(data->socketNodes[SOCKET_CANNON_MUZZLE]).entries[13];
+}
+
+static void RunKinematicsBenchmarks() {
+    const int numRobots = 10000;
+    KinematicsData* data = new KinematicsData;
+    std::vector<int> threadCounts = GetThreadCounts();
+
+    BuildRobotGraph(data->graph, data->socketNodes);
+    data->robots.resize(numRobots);
+    for (int i = 0; i < numRobots; i++) {
+        InitRobotPose(data->robots[i]);
+        data->robots[i].position.Set((i % 100) * 30.0f, 0.0f, (i / 100) * 30.0f);
+        data->robots[i].heading = (float)(i * 37 % 360);
+        StartRobotWalk(data->robots[i], 0.0f);
+        AnimateRobot(data->robots[i], i * 0.01f);
+    }
+    int numNodes = data->graph.GetNumNodes();
+    data->world.resize(numRobots * numNodes);
+
+    RunBenchmark("kinematics.scene_graph", numNodes, 1, 1, SceneGraphBench, data);
+    for (size_t t = 0; t < threadCounts.size(); t++) {
+        data->jobs = CreateJobSystem(threadCounts[t]);
+        RunBenchmark("kinematics.robot_batch", numRobots, threadCounts[t], numRobots, RobotBatchBench, data);
+        delete data->jobs;
+    }
+    data->jobs = NULL;
+
+    data->instance.Init(&data->graph);
+    for (int j = 0; j < NUM_ROBOT_JOINTS; j++)
+        data->jointAngles[j] = data->robots[0].joints[j];
+    data->instance.SetJointAngles(data->jointAngles);
+    data->instance.Update();
+    RunBenchmark("kinematics.instance_update_cannon", numNodes, 1, 1, InstanceUpdateBench, data);
+
+    delete data;
+}
+
+// Crowd ------------------------------------------------------------------
+
+struct CrowdData {
+    SceneGraph graph;
+    int socketNodes[NUM_ROBOT_SOCKETS];
+    PrimitiveCache primitives;
+    RobotCrowd crowd;
+    JobSystem* jobs;
+    std::vector<RobotPose> robots;
+    std::vector<RobotPose> posed;
+};
+
+// One frame of crowd mode without drawing: the walk posed from the gait, then
+// culling bounds, posing and the vertex transforms of every robot
+static void CrowdUpdateBench(void* p, long long count) {
+    CrowdData* data = (CrowdData*)p;
+    int numRobots = (int)data->robots.size();
+
+    for (long long n = 0; n < count; n++) {
+        PoseRobotsFromGait(&data->robots[0], numRobots, n * 0.01, 1.0f, &data->posed[0], data->jobs);
+        data->crowd.Update(&data->posed[0], numRobots, NULL, data->jobs);
+    }
+    benchSink = benchSink + data->posed[0].joints[JOINT_HIP_LEFT];
+}
+
+static void RunCrowdBenchmarks() {
+    const int numRobots = 10000;
+    // Object space boxes of the unit cube and barrel, as Robot3D.cpp gives its crowd
+    static const BBox primitiveBounds[NUM_ROBOT_PRIMITIVES] = {
+        { VECTOR3D(-0.5f, -0.5f, -0.5f), VECTOR3D(0.5f, 0.5f, 0.5f) },
+        { VECTOR3D(-1.0f, -1.0f, 0.0f), VECTOR3D(1.0f, 1.0f, 1.0f) },
+    };
+    CrowdData* data = new CrowdData;
+    std::vector<int> threadCounts = GetThreadCounts();
+
+    // The crowd's coarser barrel, no materials since nothing is drawn
+    const PrimitiveMesh* meshes[NUM_ROBOT_PRIMITIVES];
+    meshes[PRIMITIVE_CUBE] = data->primitives.GetCube();
+    meshes[PRIMITIVE_BARREL] = data->primitives.GetCylinder(12, 1);
+    BuildRobotGraph(data->graph, data->socketNodes);
+    data->crowd.Init(&data->graph, NULL, NULL, meshes, primitiveBounds);
+
+    data->robots.resize(numRobots);
+    data->posed.resize(numRobots);
+    for (int i = 0; i < numRobots; i++) {
+        InitRobotPose(data->robots[i]);
+        data->robots[i].position.Set((i % 100) * 30.0f, 0.0f, (i / 100) * 30.0f);
+        data->robots[i].heading = (float)(i * 37 % 360);
+        data->robots[i].walkOffset = (i % 50) * 0.01f;
+    }
+
+    for (size_t t = 0; t < threadCounts.size(); t++) {
+        data->jobs = CreateJobSystem(threadCounts[t]);
+        RunBenchmark("crowd.update", numRobots, threadCounts[t], numRobots, CrowdUpdateBench, data);
+        delete data->jobs;
+    }
+    data->jobs = NULL;
+
+    delete data;
+}
+
+// Output -----------------------------------------------------------------
+
+static void WriteJSON(FILE* file) {
+    char date[32];
+    time_t now = time(NULL);
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+#ifdef VECTOR_SIMD_WIDTH
+    int simdWidth = VECTOR_SIMD_WIDTH;
+#else
+    int simdWidth = 1;
+#endif
+
+    fprintf(file, "{\n  \"context\": {\"date\": \"%s\", \"compiler\": \"%s\", \"simd_width\": %d, \"samples\": %d, \"min_time\": %g},\n",
+        date,
+#ifdef __VERSION__
+        __VERSION__,
+#else
+        "unknown",
+#endif
+        simdWidth, kNumSamples, options.minSeconds);
+    fprintf(file, "  \"benchmarks\": [");
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult& r = results[i];
+        fprintf(file, "%s\n    {\"name\": \"%s\", \"param\": %d, \"threads\": %d, \"items_per_op\": %d, \"iterations\": %lld, "
+            "\"ns_per_op\": %.3f, \"ns_per_op_min\": %.3f, \"ns_per_op_max\": %.3f, \"ns_per_item\": %.4f}",
+            i > 0 ? "," : "", r.name.c_str(), r.param, r.threads, r.itemsPerOp, r.iterations,
+            r.nsPerOp, r.nsPerOpMin, r.nsPerOpMax, r.nsPerOp / r.itemsPerOp);
+    }
+    fprintf(file, "\n  ]\n}\n");
+}
+
+static void WriteCSV(FILE* file) {
+    fprintf(file, "name,param,threads,items_per_op,iterations,ns_per_op,ns_per_op_min,ns_per_op_max,ns_per_item\n");
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult& r = results[i];
+        fprintf(file, "%s,%d,%d,%d,%lld,%.3f,%.3f,%.3f,%.4f\n", r.name.c_str(), r.param, r.threads, r.itemsPerOp, r.iterations,
+            r.nsPerOp, r.nsPerOpMin, r.nsPerOpMax, r.nsPerOp / r.itemsPerOp);
+    }
+}
+
+int main(int argc, char** argv) {
+    bool csv = false;
+    const char* outPath = NULL;
+
+    options.minSeconds = 0.5;
+    options.filter = NULL;
+    options.maxThreads = (int)std::thread::hardware_concurrency();
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--csv") == 0)
+            csv = true;
+        else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+            outPath = argv[++i];
+        else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+            options.filter = argv[++i];
+        else if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc)
+            options.minSeconds = atof(argv[++i]);
+        else if (strcmp(argv[i], "--max-threads") == 0 && i + 1 < argc)
+            options.maxThreads = atoi(argv[++i]);
+        else {
+            fprintf(stderr, "usage: %s [--csv] [--out FILE] [--filter TEXT] [--min-time SECONDS] [--max-threads N]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    if (options.maxThreads < 1)
+        options.maxThreads = 1;
+
+    // Fixed inputs, so every run measures the same work
+    srand(1);
+    RunVectorBenchmarks();
+    RunMeshBenchmarks();
+    RunAnimationBenchmarks();
+    RunKinematicsBenchmarks();
+    RunCrowdBenchmarks();
+
+    FILE* file = outPath ? fopen(outPath, "w") : stdout;
+    if (!file) {
+        fprintf(stderr, "could not write %s\n", outPath);
+        return 1;
+    }
+    if (csv)
+        WriteCSV(file);
+    else
+        WriteJSON(file);
+    bool ok = ferror(file) == 0;
+    if (outPath)
+        ok = fclose(file) == 0 && ok;
+    return ok ? 0 : 1;
+}
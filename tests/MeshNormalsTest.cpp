@@ -0,0 +1,135 @@
+// Checks the vectorized and threaded grid normal paths against the plain
+// scalar reference on odd and even grid sizes, so the SIMD row tails and the
+// grid border are both exercised. Prints one line per case and exits nonzero
+// if any normal differs by more than kTolerance.
+//
+// Build and run with "make test" from the repository root.
+#include <stdio.h>
+#include <math.h>
+#include <vector>
+#include "MeshNormals.h"
+#include "JobSystem.h"
+
+// The vector paths do the same operations in the same order as the scalar
+// one, so any difference is rounding in the square root at most
+static const float kTolerance = 1e-6f;
+
+// Marks normals a region call must leave alone
+static const float kUntouched = -7.0f;
+
+// Positions are x, y, z per vertex, row after row
+struct Grid {
+    int size;
+    std::vector<float> positions;
+
+    Grid(int size) : size(size) {
+        int rowLength = size + 1;
+        positions.resize(3 * rowLength * rowLength);
+
+        // A bumpy surface so neighbouring quads have different normals
+        for (int row = 0; row <= size; row++) {
+            for (int col = 0; col <= size; col++) {
+                float* p = &positions[3 * (row * rowLength + col)];
+                p[0] = col * 0.25f;
+                p[1] = 0.6f * sinf(col * 0.37f) * cosf(row * 0.23f) + 0.05f * (float)((row * 7 + col * 13) % 5);
+                p[2] = -row * 0.25f;
+            }
+        }
+    }
+};
+
+typedef std::vector<float> Normals;  // x, y, z per vertex
+
+static int numFailures = 0;
+
+// Largest component difference between a and the reference over rows
+// [row0, row1] and columns [col0, col1]; vertices outside must still hold
+// kUntouched, otherwise the difference reported is infinite
+static float MaxDifference(const Grid& grid, const Normals& normals, const Normals& reference,
+    int row0, int row1, int col0, int col1) {
+    int rowLength = grid.size + 1;
+    float maxDiff = 0.0f;
+
+    for (int row = 0; row <= grid.size; row++) {
+        for (int col = 0; col <= grid.size; col++) {
+            int v = 3 * (row * rowLength + col);
+            bool inside = row >= row0 && row <= row1 && col >= col0 && col <= col1;
+
+            for (int c = 0; c < 3; c++) {
+                if (!inside && normals[v + c] != kUntouched)
+                    return INFINITY;
+                if (inside)
+                    maxDiff = fmaxf(maxDiff, fabsf(normals[v + c] - reference[v + c]));
+            }
+        }
+    }
+    return maxDiff;
+}
+
+static void Report(const char* test, int gridSize, float maxDiff) {
+    bool ok = maxDiff <= kTolerance;
+    printf("%-4s %-36s grid %4d  max difference %g\n", ok ? "ok" : "FAIL", test, gridSize, maxDiff);
+    if (!ok)
+        numFailures++;
+}
+
+static void TestGridSize(int gridSize, JobSystem* jobs) {
+    Grid grid(gridSize);
+    int numFloats = 3 * (gridSize + 1) * (gridSize + 1);
+
+    Normals reference(numFloats, kUntouched);
+    ComputeGridNormalsScalar(gridSize, &grid.positions[0], &reference[0]);
+
+    {
+        Normals normals(numFloats, kUntouched);
+        ComputeGridNormals(gridSize, &grid.positions[0], &normals[0], NULL);
+        Report("ComputeGridNormals", gridSize, MaxDifference(grid, normals, reference, 0, gridSize, 0, gridSize));
+    }
+    {
+        Normals normals(numFloats, kUntouched);
+        ComputeGridNormals(gridSize, &grid.positions[0], &normals[0], jobs);
+        Report("ComputeGridNormals with jobs", gridSize, MaxDifference(grid, normals, reference, 0, gridSize, 0, gridSize));
+    }
+
+    // Regions starting and ending at odd columns leave a vector tail on both
+    // sides, the last one also runs past the grid and must be clamped
+    struct Region { int row0, row1, col0, col1; };
+    Region regions[] = {
+        { 0, gridSize, 0, gridSize },
+        { 1, gridSize - 1, 1, gridSize - 1 },
+        { gridSize / 3, gridSize / 2, 3, gridSize - 2 },
+        { gridSize / 2, gridSize + 4, gridSize / 2 + 1, gridSize + 4 },
+    };
+    for (size_t r = 0; r < sizeof(regions) / sizeof(regions[0]); r++) {
+        Region region = regions[r];
+        if (region.row0 > region.row1 || region.col0 > region.col1)
+            continue;
+
+        Normals normals(numFloats, kUntouched);
+        ComputeGridNormalsRegion(gridSize, region.row0, region.row1, region.col0, region.col1,
+            &grid.positions[0], &normals[0]);
+
+        int row1 = region.row1 < gridSize ? region.row1 : gridSize;
+        int col1 = region.col1 < gridSize ? region.col1 : gridSize;
+        char name[64];
+        snprintf(name, sizeof(name), "ComputeGridNormalsRegion %d", (int)r);
+        Report(name, gridSize, MaxDifference(grid, normals, reference, region.row0, row1, region.col0, col1));
+    }
+}
+
+int main() {
+    static const int gridSizes[] = { 1, 2, 3, 17, 255, 2048 };
+
+    // More threads than the machine has still splits the grid into bands
+    JobSystem jobs(4);
+
+    for (size_t i = 0; i < sizeof(gridSizes) / sizeof(gridSizes[0]); i++)
+        TestGridSize(gridSizes[i], &jobs);
+
+    if (numFailures > 0) {
+        printf("%d failed\n", numFailures);
+        return 1;
+    }
+    printf("all passed\n");
+    return 0;
+}
@@ -0,0 +1,95 @@
+// Checks that Terrain leaves no cracks between chunks of different detail.
+// A bumpy height function is sampled at every level, so an unstitched edge of
+// a fine chunk next to a coarse one sits visibly off the coarse chunk's edge.
+// The ground height is read just either side of every chunk border and the two
+// must agree. Prints one line per camera position and exits nonzero on a gap.
+//
+// Build and run with "make test" from the repository root.
+#include <GL/gl.h>
+#include <stdio.h>
+#include <math.h>
+#include "VECTOR3D.h"
+#include "Terrain.h"
+
+static const float kTerrainSize = 512.0f;
+static const int kChunkSize = 8;
+static const int kMaxDepth = 5;
+
+// Finest chunk side, every chunk border lies on a multiple of it
+static const float kCellSize = kTerrainSize / (1 << kMaxDepth);
+
+// How far either side of a border the height is read. The ground's slope
+// stays under 0.5, so reads on a crack-free border differ by less than this.
+static const float kNudge = 1e-3f;
+static const float kTolerance = 2e-3f;
+
+// Curves at every scale from the coarsest chunk spacing (64) to the finest (2)
+static float Bumps(float x, float z) {
+    return 6.0f * sinf(0.05f * x) * cosf(0.04f * z) + 0.5f * sinf(0.6f * x + 0.3f) * sinf(0.5f * z);
+}
+
+static int numFailures = 0;
+
+// Largest height difference across chunk borders, along with how many border
+// points have chunks of different depth on either side
+static float MaxSeamGap(const Terrain& terrain, int& numMixedPoints) {
+    float half = 0.5f * kTerrainSize;
+    int numCells = 1 << kMaxDepth;
+    float maxGap = 0.0f;
+    numMixedPoints = 0;
+
+    // Borders at x = const, then at z = const, sampled at a quarter of the
+    // finest vertex spacing so points between vertices are covered too
+    for (int axis = 0; axis < 2; axis++) {
+        for (int i = 1; i < numCells; i++) {
+            float border = -half + i * kCellSize;
+            for (float along = -half + 0.1f; along < half; along += 0.25f * kCellSize / kChunkSize) {
+                float xa = axis == 0 ? border - kNudge : along;
+                float za = axis == 0 ? along : border - kNudge;
+                float xb = axis == 0 ? border + kNudge : along;
+                float zb = axis == 0 ? along : border + kNudge;
+
+                float ha, hb;
+                if (!terrain.GetSurfaceHeight(xa, za, ha) || !terrain.GetSurfaceHeight(xb, zb, hb))
+                    return INFINITY;
+                maxGap = fmaxf(maxGap, fabsf(ha - hb));
+                if (terrain.LeafDepthAt(xa, za) != terrain.LeafDepthAt(xb, zb))
+                    numMixedPoints++;
+            }
+        }
+    }
+    return maxGap;
+}
+
+static void TestEye(Terrain& terrain, const char* name, VECTOR3D eye) {
+    terrain.Update(eye);
+
+    int numMixedPoints;
+    float maxGap = MaxSeamGap(terrain, numMixedPoints);
+
+    // A camera that leaves every chunk at one depth would not test stitching
+    bool ok = maxGap <= kTolerance && numMixedPoints > 0;
+    printf("%-4s %-12s %4d chunks  %6d mixed-depth border points  max gap %g\n",
+        ok ? "ok" : "FAIL", name, terrain.GetNumChunksSelected(), numMixedPoints, maxGap);
+    if (!ok)
+        numFailures++;
+}
+
+int main() {
+    Terrain terrain(VECTOR3D(0.0f, 0.0f, 0.0f), kTerrainSize, kChunkSize, kMaxDepth, 1.5f);
+    terrain.SetHeightFunction(Bumps);
+
+    // Moving the camera around reuses chunks built for earlier positions, whose
+    // edges must be restitched against their new neighbours
+    TestEye(terrain, "corner", VECTOR3D(-230.0f, 10.0f, -230.0f));
+    TestEye(terrain, "center", VECTOR3D(3.0f, 10.0f, -5.0f));
+    TestEye(terrain, "edge", VECTOR3D(250.0f, 40.0f, 20.0f));
+    TestEye(terrain, "corner again", VECTOR3D(-230.0f, 10.0f, -230.0f));
+
+    if (numFailures > 0) {
+        printf("%d failed\n", numFailures);
+        return 1;
+    }
+    printf("all passed\n");
+    return 0;
+}